@@ -13,9 +13,70 @@
 #include <unordered_set>
 #include <fstream>
 #include <iterator>
+#include <filesystem>
 #include "../common/utils.h"
 #include "../../3rd_party/ketopt.h"
 
+// *******************************************************************************************
+// Ids of long options (outside of the range of short options)
+enum long_option_id_t : int { lo_numa = 300, lo_huge_pages, lo_seekable_packs, lo_hot_samples, lo_hot_batch_size, lo_readahead, lo_mmap, lo_lengths, lo_digests, lo_part_checksums, lo_full, lo_checkpoint, lo_resume, lo_max_memory, lo_pansn, lo_autotune, lo_autotune_samples, lo_cpu };
+
+static ko_longopt_t long_options_compression[] = {
+	{ (char*) "numa", ko_no_argument, lo_numa },
+	{ (char*) "huge-pages", ko_no_argument, lo_huge_pages },
+	{ (char*) "hot-samples", ko_required_argument, lo_hot_samples },
+	{ (char*) "hot-batch-size", ko_required_argument, lo_hot_batch_size },
+	{ (char*) "part-checksums", ko_no_argument, lo_part_checksums },
+	{ (char*) "checkpoint", ko_required_argument, lo_checkpoint },
+	{ (char*) "resume", ko_no_argument, lo_resume },
+	{ (char*) "max-memory", ko_required_argument, lo_max_memory },
+	{ (char*) "pansn", ko_no_argument, lo_pansn },
+	{ nullptr, 0, 0 }
+};
+
+static ko_longopt_t long_options_info[] = {
+	{ (char*) "cpu", ko_no_argument, lo_cpu },
+	{ nullptr, 0, 0 }
+};
+
+static ko_longopt_t long_options_create[] = {
+	{ (char*) "autotune", ko_required_argument, lo_autotune },
+	{ (char*) "autotune-samples", ko_required_argument, lo_autotune_samples },
+	{ (char*) "numa", ko_no_argument, lo_numa },
+	{ (char*) "huge-pages", ko_no_argument, lo_huge_pages },
+	{ (char*) "seekable-packs", ko_no_argument, lo_seekable_packs },
+	{ (char*) "hot-samples", ko_required_argument, lo_hot_samples },
+	{ (char*) "hot-batch-size", ko_required_argument, lo_hot_batch_size },
+	{ (char*) "part-checksums", ko_no_argument, lo_part_checksums },
+	{ (char*) "checkpoint", ko_required_argument, lo_checkpoint },
+	{ (char*) "resume", ko_no_argument, lo_resume },
+	{ (char*) "max-memory", ko_required_argument, lo_max_memory },
+	{ (char*) "pansn", ko_no_argument, lo_pansn },
+	{ nullptr, 0, 0 }
+};
+
+static ko_longopt_t long_options_decompression[] = {
+	{ (char*) "readahead", ko_required_argument, lo_readahead },
+	{ (char*) "mmap", ko_no_argument, lo_mmap },
+	{ nullptr, 0, 0 }
+};
+
+static ko_longopt_t long_options_query[] = {
+	{ (char*) "mmap", ko_no_argument, lo_mmap },
+	{ nullptr, 0, 0 }
+};
+
+static ko_longopt_t long_options_listctg[] = {
+	{ (char*) "lengths", ko_no_argument, lo_lengths },
+	{ (char*) "digests", ko_no_argument, lo_digests },
+	{ nullptr, 0, 0 }
+};
+
+static ko_longopt_t long_options_verify[] = {
+	{ (char*) "full", ko_no_argument, lo_full },
+	{ nullptr, 0, 0 }
+};
+
 // *******************************************************************************************
 bool CApplication::parse_params(const int argc, const char** argv)
 {
@@ -33,6 +94,16 @@ bool CApplication::parse_params(const int argc, const char** argv)
             usage_create();
         else if (execution_params.mode == "append")
             usage_append();
+        else if (execution_params.mode == "merge")
+            usage_merge();
+        else if (execution_params.mode == "subset")
+            usage_subset();
+        else if (execution_params.mode == "remove")
+            usage_remove();
+        else if (execution_params.mode == "compact")
+            usage_compact();
+        else if (execution_params.mode == "optimize")
+            usage_optimize();
         else if (execution_params.mode == "getcol")
             usage_getcol();
         else if (execution_params.mode == "getset")	
@@ -45,8 +116,14 @@ bool CApplication::parse_params(const int argc, const char** argv)
             usage_listset();
         else if (execution_params.mode == "listctg")
             usage_listctg();
+        else if (execution_params.mode == "lookup")
+            usage_lookup();
         else if (execution_params.mode == "info")
             usage_info();
+        else if (execution_params.mode == "serve")
+            usage_serve();
+        else if (execution_params.mode == "verify")
+            usage_verify();
         else
         {
             cerr << "Unknown mode: " << execution_params.mode << endl;
@@ -59,6 +136,16 @@ bool CApplication::parse_params(const int argc, const char** argv)
             return parse_params_create(argc - 1, argv + 1);
         else if (execution_params.mode == "append")
             return parse_params_append(argc - 1, argv + 1);
+        else if (execution_params.mode == "merge")
+            return parse_params_merge(argc - 1, argv + 1);
+        else if (execution_params.mode == "subset")
+            return parse_params_subset(argc - 1, argv + 1);
+        else if (execution_params.mode == "remove")
+            return parse_params_remove(argc - 1, argv + 1);
+        else if (execution_params.mode == "compact")
+            return parse_params_compact(argc - 1, argv + 1);
+        else if (execution_params.mode == "optimize")
+            return parse_params_optimize(argc - 1, argv + 1);
         else if (execution_params.mode == "getcol")
             return parse_params_getcol(argc - 1, argv + 1);
         else if (execution_params.mode == "getset")
@@ -71,8 +158,14 @@ bool CApplication::parse_params(const int argc, const char** argv)
             return parse_params_listset(argc - 1, argv + 1);
         else if (execution_params.mode == "listctg")
             return parse_params_listctg(argc - 1, argv + 1);
+        else if (execution_params.mode == "lookup")
+            return parse_params_lookup(argc - 1, argv + 1);
         else if (execution_params.mode == "info")
             return parse_params_info(argc - 1, argv + 1);
+        else if (execution_params.mode == "serve")
+            return parse_params_serve(argc - 1, argv + 1);
+        else if (execution_params.mode == "verify")
+            return parse_params_verify(argc - 1, argv + 1);
         else
         {
             cerr << "Unknown mode: " << execution_params.mode << endl;
@@ -91,13 +184,21 @@ void CApplication::usage() const
     cerr << "Command:\n";
     cerr << "   create   - create archive from FASTA files\n";
     cerr << "   append   - add FASTA files to existing archive\n";
+    cerr << "   merge    - merge archives created with the same parameters (e.g., on separate machines)\n";
+    cerr << "   subset   - create archive with selected samples of archive\n";
+    cerr << "   remove   - mark samples as removed (archive is updated in place)\n";
+    cerr << "   compact  - create archive without removed samples and unused segments\n";
+    cerr << "   optimize - create archive with reselected references of segment groups\n";
     cerr << "   getcol   - extract all samples from archive\n";
     cerr << "   getset   - extract sample from archive\n";
     cerr << "   getctg   - extract contig from archive\n";
     cerr << "   listref  - list reference sample name in archive\n";
     cerr << "   listset  - list sample names in archive\n";
     cerr << "   listctg  - list sample and contig names in archive\n";
+    cerr << "   lookup   - find contigs by content digest (MD5 or refget SQ.)\n";
     cerr << "   info     - show some statistics of the compressed data\n";
+    cerr << "   serve    - answer queries over a local socket\n";
+    cerr << "   verify   - check integrity of archive\n";
     cerr << "Note: run agc <command> to see command-specific options\n";
 }
 
@@ -119,6 +220,18 @@ void CApplication::usage_create() const
 	cerr << "   -s <int>       - expected segment size " << execution_params.segment_size.info() << "\n";
     cerr << "   -t <int>       - no of threads " << execution_params.no_threads.info() << "\n";
     cerr << "   -v <int>       - verbosity level " << execution_params.verbosity.info() << "\n";
+	cerr << "   --numa         - spread threads over NUMA nodes and interleave shared data (default: " << boolalpha << execution_params.numa << noboolalpha << ")\n";
+	cerr << "   --huge-pages   - use (transparent) huge pages for large tables (default: " << boolalpha << execution_params.huge_pages << noboolalpha << ")\n";
+	cerr << "   --seekable-packs - compress members of packs independently for faster random access (default: " << boolalpha << execution_params.seekable_packs << noboolalpha << ")\n";
+	cerr << "   --hot-samples <file_name> - file with names of frequently accessed samples (stored in separate, small batches)\n";
+	cerr << "   --hot-batch-size <int> - batch size for hot samples " << execution_params.hot_pack_cardinality.info() << "\n";
+	cerr << "   --part-checksums - store checksums of archive parts for fast verification (default: " << boolalpha << execution_params.part_checksums << noboolalpha << ")\n";
+	cerr << "   --checkpoint <int> - make resumable checkpoint of output archive after every given no. of samples " << execution_params.checkpoint_interval.info() << "\n";
+	cerr << "   --resume       - continue from the last checkpoint of output archive (samples already stored are skipped)\n";
+	cerr << "   --max-memory <int> - memory budget in MB (0 - no limit) " << execution_params.max_memory.info() << "\n";
+	cerr << "   --pansn        - input files contain many samples of PanSN-named contigs (sample#haplotype#contig) (default: " << boolalpha << execution_params.pansn << noboolalpha << ")\n";
+	cerr << "   --autotune <str> - choose -k, -l, -s, -b by trial compressions of some samples; objective: size, speed, access (default: no tuning)\n";
+	cerr << "   --autotune-samples <int> - no. of randomly chosen samples (files) used in trials " << execution_params.autotune_samples.info() << "\n";
 }
 
 // *******************************************************************************************
@@ -127,7 +240,7 @@ bool CApplication::parse_params_create(const int argc, const char** argv)
 	ketopt_t o = KETOPT_INIT;
 	int i, c;
 
-	while ((c = ketopt(&o, argc, argv, 1, "t:b:s:k:f:l:acdfi:o:v:", 0)) >= 0) {
+	while ((c = ketopt(&o, argc, argv, 1, "t:b:s:k:f:l:acdfi:o:v:", long_options_create)) >= 0) {
 		if (c == 't') {
 			execution_params.no_threads.assign(atoi(o.arg));
 		} else if (c == 'b') {
@@ -154,6 +267,55 @@ bool CApplication::parse_params_create(const int argc, const char** argv)
 			execution_params.use_stdout = false;
 		} else if (c == 'v') {
 			execution_params.verbosity.assign(atoi(o.arg));
+		} else if (c == lo_numa) {
+			execution_params.numa = true;
+		} else if (c == lo_huge_pages) {
+			execution_params.huge_pages = true;
+		} else if (c == lo_seekable_packs) {
+			execution_params.seekable_packs = true;
+		} else if (c == lo_hot_samples) {
+			if (!load_file_names(o.arg, execution_params.hot_samples))
+				return false;
+		} else if (c == lo_hot_batch_size) {
+			execution_params.hot_pack_cardinality.assign(atoi(o.arg));
+		} else if (c == lo_part_checksums) {
+			execution_params.part_checksums = true;
+		} else if (c == lo_checkpoint) {
+			execution_params.checkpoint_interval.assign(atoi(o.arg));
+		} else if (c == lo_resume) {
+			execution_params.resume = true;
+		} else if (c == lo_max_memory) {
+			execution_params.max_memory.assign(atoi(o.arg));
+		} else if (c == lo_pansn) {
+			execution_params.pansn = true;
+		} else if (c == lo_autotune) {
+			execution_params.autotune_objective = o.arg;
+		} else if (c == lo_autotune_samples) {
+			execution_params.autotune_samples.assign(atoi(o.arg));
+		}
+	}
+
+	if ((execution_params.checkpoint_interval() || execution_params.resume) && (execution_params.use_stdout || execution_params.concatenated_genomes)) {
+		cerr << "Checkpoints need output file (-o) and are not supported for concatenated genomes\n";
+		return false;
+	}
+
+	if (execution_params.pansn && execution_params.concatenated_genomes) {
+		cerr << "Options -c and --pansn cannot be used together\n";
+		return false;
+	}
+
+	if (!execution_params.autotune_objective.empty()) {
+		auto& obj = execution_params.autotune_objective;
+
+		if (obj != "size" && obj != "speed" && obj != "access") {
+			cerr << "Unknown autotuning objective: " << obj << endl;
+			return false;
+		}
+
+		if (execution_params.resume) {
+			cerr << "Autotuning cannot be used when resuming\n";
+			return false;
 		}
 	}
 
@@ -162,6 +324,11 @@ bool CApplication::parse_params_create(const int argc, const char** argv)
 		return false;
 	}
 
+	if (!is_rereadable_file(argv[o.ind])) {
+		cerr << "Reference must be a regular file (it is read twice): " << argv[o.ind] << endl;
+		return false;
+	}
+
 	execution_params.input_names.insert(execution_params.input_names.begin(), string(argv[o.ind]));
 
 	for (i = o.ind + 1; i < argc; ++i)
@@ -184,6 +351,15 @@ void CApplication::usage_append() const
     cerr << "   -o <file_name> - output to file (default: output is sent to stdout)\n";
 	cerr << "   -t <int>       - no of threads " << execution_params.no_threads.info() << "\n";
     cerr << "   -v <int>       - verbosity level " << execution_params.verbosity.info() << "\n";
+	cerr << "   --numa         - spread threads over NUMA nodes and interleave shared data (default: " << boolalpha << execution_params.numa << noboolalpha << ")\n";
+	cerr << "   --huge-pages   - use (transparent) huge pages for large tables (default: " << boolalpha << execution_params.huge_pages << noboolalpha << ")\n";
+	cerr << "   --hot-samples <file_name> - file with names of frequently accessed samples (stored in separate, small batches)\n";
+	cerr << "   --hot-batch-size <int> - batch size for hot samples " << execution_params.hot_pack_cardinality.info() << "\n";
+	cerr << "   --part-checksums - store checksums of archive parts for fast verification (default: " << boolalpha << execution_params.part_checksums << noboolalpha << ")\n";
+	cerr << "   --checkpoint <int> - make resumable checkpoint of output archive after every given no. of samples " << execution_params.checkpoint_interval.info() << "\n";
+	cerr << "   --resume       - continue from the last checkpoint of output archive (samples already stored are skipped)\n";
+	cerr << "   --max-memory <int> - memory budget in MB (0 - no limit) " << execution_params.max_memory.info() << "\n";
+	cerr << "   --pansn        - input files contain many samples of PanSN-named contigs (sample#haplotype#contig) (default: " << boolalpha << execution_params.pansn << noboolalpha << ")\n";
 }
 
 // *******************************************************************************************
@@ -192,7 +368,7 @@ bool CApplication::parse_params_append(const int argc, const char** argv)
 	ketopt_t o = KETOPT_INIT;
 	int i, c;
 
-	while ((c = ketopt(&o, argc, argv, 1, "t:f:acdfi:o:v:", 0)) >= 0) {
+	while ((c = ketopt(&o, argc, argv, 1, "t:f:acdfi:o:v:", long_options_compression)) >= 0) {
 		if (c == 't') {
 			execution_params.no_threads.assign(atoi(o.arg));
 		}
@@ -214,9 +390,38 @@ bool CApplication::parse_params_append(const int argc, const char** argv)
 			execution_params.use_stdout = false;
 		} else if (c == 'v') {
 			execution_params.verbosity.assign(atoi(o.arg));
+		} else if (c == lo_numa) {
+			execution_params.numa = true;
+		} else if (c == lo_huge_pages) {
+			execution_params.huge_pages = true;
+		} else if (c == lo_hot_samples) {
+			if (!load_file_names(o.arg, execution_params.hot_samples))
+				return false;
+		} else if (c == lo_hot_batch_size) {
+			execution_params.hot_pack_cardinality.assign(atoi(o.arg));
+		} else if (c == lo_part_checksums) {
+			execution_params.part_checksums = true;
+		} else if (c == lo_checkpoint) {
+			execution_params.checkpoint_interval.assign(atoi(o.arg));
+		} else if (c == lo_resume) {
+			execution_params.resume = true;
+		} else if (c == lo_max_memory) {
+			execution_params.max_memory.assign(atoi(o.arg));
+		} else if (c == lo_pansn) {
+			execution_params.pansn = true;
 		}
 	}
 
+	if ((execution_params.checkpoint_interval() || execution_params.resume) && (execution_params.use_stdout || execution_params.concatenated_genomes)) {
+		cerr << "Checkpoints need output file (-o) and are not supported for concatenated genomes\n";
+		return false;
+	}
+
+	if (execution_params.pansn && execution_params.concatenated_genomes) {
+		cerr << "Options -c and --pansn cannot be used together\n";
+		return false;
+	}
+
 	if (o.ind >= argc) {
 		cerr << "No archive name\n";
 		return false;
@@ -230,6 +435,234 @@ bool CApplication::parse_params_append(const int argc, const char** argv)
 	return true;
 }
 
+// *******************************************************************************************
+void CApplication::usage_merge() const
+{
+	cerr << AGC_VERSION << endl;
+	cerr << "Usage: agc merge [options] <in1.agc> <in2.agc> [<in3.agc> ...] > <out.agc>\n";
+	cerr << "Options:\n";
+	cerr << "   -d             - do not store cmd-line (default: " << boolalpha << execution_params.store_cmd_line << noboolalpha << ")\n";
+	cerr << "   -o <file_name> - output to file (default: output is sent to stdout)\n";
+	cerr << "   -t <int>       - no of threads " << execution_params.no_threads.info() << "\n";
+	cerr << "   -v <int>       - verbosity level " << execution_params.verbosity.info() << "\n";
+}
+
+// *******************************************************************************************
+bool CApplication::parse_params_merge(const int argc, const char** argv)
+{
+	ketopt_t o = KETOPT_INIT;
+	int i, c;
+
+	while ((c = ketopt(&o, argc, argv, 1, "do:t:v:", 0)) >= 0) {
+		if (c == 'd') {
+			execution_params.store_cmd_line = false;
+		} else if (c == 'o') {
+			execution_params.out_archive_name = o.arg;
+			execution_params.use_stdout = false;
+		} else if (c == 't') {
+			execution_params.no_threads.assign(atoi(o.arg));
+		} else if (c == 'v') {
+			execution_params.verbosity.assign(atoi(o.arg));
+		}
+	}
+
+	if (o.ind + 1 >= argc) {
+		cerr << "At least two archive names are required\n";
+		return false;
+	}
+
+	execution_params.in_archive_name = argv[o.ind];
+
+	for (i = o.ind + 1; i < argc; ++i)
+		execution_params.input_names.emplace_back(argv[i]);
+
+	return true;
+}
+
+// *******************************************************************************************
+void CApplication::usage_subset() const
+{
+	cerr << AGC_VERSION << endl;
+	cerr << "Usage: agc subset [options] <in.agc> [<sample_name1> ...] > <out.agc>\n";
+	cerr << "Options:\n";
+	cerr << "   -d             - do not store cmd-line (default: " << boolalpha << execution_params.store_cmd_line << noboolalpha << ")\n";
+	cerr << "   -i <file_name> - file with sample names (alternative to listing sample names explicitly in command line)\n";
+	cerr << "   -o <file_name> - output to file (default: output is sent to stdout)\n";
+	cerr << "   -t <int>       - no of threads " << execution_params.no_threads.info() << "\n";
+	cerr << "   -v <int>       - verbosity level " << execution_params.verbosity.info() << "\n";
+}
+
+// *******************************************************************************************
+bool CApplication::parse_params_subset(const int argc, const char** argv)
+{
+	ketopt_t o = KETOPT_INIT;
+	int i, c;
+
+	while ((c = ketopt(&o, argc, argv, 1, "di:o:t:v:", 0)) >= 0) {
+		if (c == 'd') {
+			execution_params.store_cmd_line = false;
+		} else if (c == 'i') {
+			if (!load_file_names(o.arg, execution_params.sample_names))
+			{
+				cerr << "Cannot load sample names from " << o.arg << endl;
+				return false;
+			}
+		} else if (c == 'o') {
+			execution_params.out_archive_name = o.arg;
+			execution_params.use_stdout = false;
+		} else if (c == 't') {
+			execution_params.no_threads.assign(atoi(o.arg));
+		} else if (c == 'v') {
+			execution_params.verbosity.assign(atoi(o.arg));
+		}
+	}
+
+	if (o.ind >= argc) {
+		cerr << "No archive name\n";
+		return false;
+	}
+
+	execution_params.in_archive_name = argv[o.ind];
+
+	for (i = o.ind + 1; i < argc; ++i)
+		execution_params.sample_names.emplace_back(argv[i]);
+
+	if (execution_params.sample_names.empty()) {
+		cerr << "No sample name\n";
+		return false;
+	}
+
+	return true;
+}
+
+// *******************************************************************************************
+void CApplication::usage_remove() const
+{
+	cerr << AGC_VERSION << endl;
+	cerr << "Usage: agc remove [options] <in.agc> [<sample_name1> ...]\n";
+	cerr << "Options:\n";
+	cerr << "   -i <file_name> - file with sample names (alternative to listing sample names explicitly in command line)\n";
+	cerr << "   -v <int>       - verbosity level " << execution_params.verbosity.info() << "\n";
+}
+
+// *******************************************************************************************
+bool CApplication::parse_params_remove(const int argc, const char** argv)
+{
+	ketopt_t o = KETOPT_INIT;
+	int i, c;
+
+	while ((c = ketopt(&o, argc, argv, 1, "i:v:", 0)) >= 0) {
+		if (c == 'i') {
+			if (!load_file_names(o.arg, execution_params.sample_names))
+			{
+				cerr << "Cannot load sample names from " << o.arg << endl;
+				return false;
+			}
+		} else if (c == 'v') {
+			execution_params.verbosity.assign(atoi(o.arg));
+		}
+	}
+
+	if (o.ind >= argc) {
+		cerr << "No archive name\n";
+		return false;
+	}
+
+	execution_params.in_archive_name = argv[o.ind];
+
+	for (i = o.ind + 1; i < argc; ++i)
+		execution_params.sample_names.emplace_back(argv[i]);
+
+	if (execution_params.sample_names.empty()) {
+		cerr << "No sample name\n";
+		return false;
+	}
+
+	return true;
+}
+
+// *******************************************************************************************
+void CApplication::usage_compact() const
+{
+	cerr << AGC_VERSION << endl;
+	cerr << "Usage: agc compact [options] <in.agc> > <out.agc>\n";
+	cerr << "Options:\n";
+	cerr << "   -d             - do not store cmd-line (default: " << boolalpha << execution_params.store_cmd_line << noboolalpha << ")\n";
+	cerr << "   -o <file_name> - output to file (default: output is sent to stdout)\n";
+	cerr << "   -t <int>       - no of threads " << execution_params.no_threads.info() << "\n";
+	cerr << "   -v <int>       - verbosity level " << execution_params.verbosity.info() << "\n";
+}
+
+// *******************************************************************************************
+bool CApplication::parse_params_compact(const int argc, const char** argv)
+{
+	ketopt_t o = KETOPT_INIT;
+	int c;
+
+	while ((c = ketopt(&o, argc, argv, 1, "do:t:v:", 0)) >= 0) {
+		if (c == 'd') {
+			execution_params.store_cmd_line = false;
+		} else if (c == 'o') {
+			execution_params.out_archive_name = o.arg;
+			execution_params.use_stdout = false;
+		} else if (c == 't') {
+			execution_params.no_threads.assign(atoi(o.arg));
+		} else if (c == 'v') {
+			execution_params.verbosity.assign(atoi(o.arg));
+		}
+	}
+
+	if (o.ind >= argc) {
+		cerr << "No archive name\n";
+		return false;
+	}
+
+	execution_params.in_archive_name = argv[o.ind];
+
+	return true;
+}
+
+// *******************************************************************************************
+void CApplication::usage_optimize() const
+{
+	cerr << AGC_VERSION << endl;
+	cerr << "Usage: agc optimize [options] <in.agc> > <out.agc>\n";
+	cerr << "Options:\n";
+	cerr << "   -d             - do not store cmd-line (default: " << boolalpha << execution_params.store_cmd_line << noboolalpha << ")\n";
+	cerr << "   -o <file_name> - output to file (default: output is sent to stdout)\n";
+	cerr << "   -t <int>       - no of threads " << execution_params.no_threads.info() << "\n";
+	cerr << "   -v <int>       - verbosity level " << execution_params.verbosity.info() << "\n";
+}
+
+// *******************************************************************************************
+bool CApplication::parse_params_optimize(const int argc, const char** argv)
+{
+	ketopt_t o = KETOPT_INIT;
+	int c;
+
+	while ((c = ketopt(&o, argc, argv, 1, "do:t:v:", 0)) >= 0) {
+		if (c == 'd') {
+			execution_params.store_cmd_line = false;
+		} else if (c == 'o') {
+			execution_params.out_archive_name = o.arg;
+			execution_params.use_stdout = false;
+		} else if (c == 't') {
+			execution_params.no_threads.assign(atoi(o.arg));
+		} else if (c == 'v') {
+			execution_params.verbosity.assign(atoi(o.arg));
+		}
+	}
+
+	if (o.ind >= argc) {
+		cerr << "No archive name\n";
+		return false;
+	}
+
+	execution_params.in_archive_name = argv[o.ind];
+
+	return true;
+}
+
 // *******************************************************************************************
 void CApplication::usage_getcol() const
 {
@@ -240,9 +673,12 @@ void CApplication::usage_getcol() const
 	cerr << "   -f               - fast mode (needs more RAM) (default: " << boolalpha << execution_params.fast << ")\n";
 	cerr << "   -l <int>         - line length " << execution_params.line_length.info() << "\n";
     cerr << "   -o <output_path> - output to files at path (default: output is sent to stdout)\n";
+	cerr << "   -p               - disable file prefetching (useful for huge archives)" << "\n";
 	cerr << "   -r               - without reference (default: " << boolalpha << execution_params.no_ref << ")\n";
 	cerr << "   -t <int>         - no of threads " << execution_params.no_threads.info() << "\n";
     cerr << "   -v <int>         - verbosity level " << execution_params.verbosity.info() << "\n";
+	cerr << "   --readahead <int> - no. of contigs for which archive parts are read in advance when prefetching is disabled " << execution_params.readahead_depth.info() << "\n";
+	cerr << "   --mmap            - read archive through memory mapping (default: " << boolalpha << execution_params.use_mmap << ")\n";
 }
 
 // *******************************************************************************************
@@ -253,7 +689,7 @@ bool CApplication::parse_params_getcol(const int argc, const char** argv)
 
 	execution_params.prefetch = true;
 
-	while ((c = ketopt(&o, argc, argv, 1, "g:t:l:o:v:fr", 0)) >= 0) {
+	while ((c = ketopt(&o, argc, argv, 1, "g:t:l:o:v:fpr", long_options_decompression)) >= 0) {
 		if (c == 'g') {
 			execution_params.gzip_level.assign(atoi(o.arg));
 		}
@@ -270,12 +706,21 @@ bool CApplication::parse_params_getcol(const int argc, const char** argv)
 		else if (c == 'f') {
 			execution_params.fast = true;
 		}
+		else if (c == 'p') {
+			execution_params.prefetch = false;
+		}
 		else if (c == 'r') {
 			execution_params.no_ref = true;
 		}
 		else if (c == 'v') {
 			execution_params.verbosity.assign(atoi(o.arg));
 		}
+		else if (c == lo_readahead) {
+			execution_params.readahead_depth.assign(atoi(o.arg));
+		}
+		else if (c == lo_mmap) {
+			execution_params.use_mmap = true;
+		}
 	}
 
 	if (o.ind >= argc) {
@@ -301,6 +746,8 @@ void CApplication::usage_getset() const
 	cerr << "   -s             - enable streaming mode (slower but need less memory)" << "\n";
 	cerr << "   -t <int>       - no of threads " << execution_params.no_threads.info() << "\n";
     cerr << "   -v <int>       - verbosity level " << execution_params.verbosity.info() << "\n";
+	cerr << "   --readahead <int> - no. of contigs for which archive parts are read in advance when prefetching is disabled " << execution_params.readahead_depth.info() << "\n";
+	cerr << "   --mmap            - read archive through memory mapping (default: " << boolalpha << execution_params.use_mmap << ")\n";
 }
 
 // *******************************************************************************************
@@ -311,7 +758,7 @@ bool CApplication::parse_params_getset(const int argc, const char** argv)
 
 	execution_params.prefetch = true;
 
-	while ((c = ketopt(&o, argc, argv, 1, "g:t:l:o:psv:", 0)) >= 0) {
+	while ((c = ketopt(&o, argc, argv, 1, "g:t:l:o:psv:", long_options_decompression)) >= 0) {
 		if (c == 'g') {
 			execution_params.gzip_level.assign(atoi(o.arg));
 		}
@@ -332,6 +779,12 @@ bool CApplication::parse_params_getset(const int argc, const char** argv)
 		else if (c == 'v') {
 			execution_params.verbosity.assign(atoi(o.arg));
 		}
+		else if (c == lo_readahead) {
+			execution_params.readahead_depth.assign(atoi(o.arg));
+		}
+		else if (c == lo_mmap) {
+			execution_params.use_mmap = true;
+		}
 	}
 
 	if (o.ind >= argc) {
@@ -360,14 +813,17 @@ void CApplication::usage_getctg() const
     cerr << "       agc getctg [options] <in.agc> <contig1@sample1> [<contig2@sample2> ...] > <out.fa>\n";
     cerr << "       agc getctg [options] <in.agc> <contig1:from-to>[<contig2:from-to> ...] > <out.fa>\n";
     cerr << "       agc getctg [options] <in.agc> <contig1@sample1:from-to> [<contig2@sample2:from-to> ...] > <out.fa>\n";
+    cerr << "       agc getctg [options] -r <regions.bed> <in.agc> > <out.fa>\n";
     cerr << "Options:\n";
 	cerr << "   -g <int>       - optional gzip with given level " << execution_params.gzip_level.info() << "\n";
 	cerr << "   -l <int>       - line length " << execution_params.line_length.info() << "\n";
     cerr << "   -o <file_name> - output to file (default: output is sent to stdout)\n";
 	cerr << "   -p             - disable file prefetching (useful for short queries)" << "\n";
+	cerr << "   -r <file_name> - extract regions from BED file (contig, start, end, optional sample name)" << "\n";
 	cerr << "   -s             - enable streaming mode (slower but need less memory)" << "\n";
 	cerr << "   -t <int>       - no of threads " << execution_params.no_threads.info() << "\n";
     cerr << "   -v <int>       - verbosity level " << execution_params.verbosity.info() << "\n";
+	cerr << "   --mmap         - read archive through memory mapping (default: " << boolalpha << execution_params.use_mmap << ")\n";
 }
 
 // *******************************************************************************************
@@ -378,7 +834,7 @@ bool CApplication::parse_params_getctg(const int argc, const char** argv)
 
 	execution_params.prefetch = true;
 
-	while ((c = ketopt(&o, argc, argv, 1, "g:t:l:o:psv:", 0)) >= 0) {
+	while ((c = ketopt(&o, argc, argv, 1, "g:t:l:o:pr:sv:", long_options_query)) >= 0) {
 		if (c == 'g') {
 			execution_params.gzip_level.assign(atoi(o.arg));
 		}
@@ -392,12 +848,18 @@ bool CApplication::parse_params_getctg(const int argc, const char** argv)
 		} else if (c == 'p') {
 			execution_params.prefetch = false;
 		} 
+		else if (c == 'r') {
+			execution_params.regions_name = o.arg;
+		}
 		else if (c == 's') {
 			execution_params.streaming = true;
 		}
 		else if (c == 'v') {
 			execution_params.verbosity.assign(atoi(o.arg));
 		}
+		else if (c == lo_mmap) {
+			execution_params.use_mmap = true;
+		}
 	}
 
 	if (o.ind >= argc) {
@@ -407,6 +869,16 @@ bool CApplication::parse_params_getctg(const int argc, const char** argv)
 
 	execution_params.in_archive_name = argv[o.ind];
 
+	if (!execution_params.regions_name.empty())
+	{
+		if (o.ind + 1 < argc) {
+			cerr << "Contig names cannot be given together with regions file\n";
+			return false;
+		}
+
+		return true;
+	}
+
 	if (o.ind + 1 >= argc) {
 		cerr << "No contig name\n";
 		return false;
@@ -493,6 +965,8 @@ void CApplication::usage_listctg() const
 	cerr << "Usage: agc listctg [options] <in.agc> <sample1> [<sample2> ...] > <out.txt>\n";
     cerr << "Options:\n";
     cerr << "   -o <file_name> - output to file (default: output is sent to stdout)\n";
+	cerr << "   --lengths      - show contig lengths (default: " << boolalpha << execution_params.contig_lengths << ")\n";
+	cerr << "   --digests      - show contig MD5 and refget (SQ.) digests (default: " << boolalpha << execution_params.contig_digests << ")\n";
 }
 
 // *******************************************************************************************
@@ -503,11 +977,17 @@ bool CApplication::parse_params_listctg(const int argc, const char** argv)
 
 	execution_params.prefetch = false;
 
-	while ((c = ketopt(&o, argc, argv, 1, "o:", 0)) >= 0) {
+	while ((c = ketopt(&o, argc, argv, 1, "o:", long_options_listctg)) >= 0) {
 		if (c == 'o') {
 			execution_params.output_name = o.arg;
 			execution_params.use_stdout = false;
 		}
+		else if (c == lo_lengths) {
+			execution_params.contig_lengths = true;
+		}
+		else if (c == lo_digests) {
+			execution_params.contig_digests = true;
+		}
 	}
 
 	if (o.ind >= argc) {
@@ -528,13 +1008,60 @@ bool CApplication::parse_params_listctg(const int argc, const char** argv)
 	return true;
 }
 
+// *******************************************************************************************
+void CApplication::usage_lookup() const
+{
+	cerr << AGC_VERSION << endl;
+	cerr << "Usage: agc lookup [options] <in.agc> <digest1> [<digest2> ...] > <out.txt>\n";
+	cerr << "Digests:\n";
+	cerr << "   MD5 as 32 hex digits (optionally prefixed by md5:)\n";
+	cerr << "   SHA512t24u (optionally prefixed by SQ. or ga4gh:SQ.)\n";
+	cerr << "Options:\n";
+	cerr << "   -o <file_name> - output to file (default: output is sent to stdout)\n";
+}
+
+// *******************************************************************************************
+bool CApplication::parse_params_lookup(const int argc, const char** argv)
+{
+	ketopt_t o = KETOPT_INIT;
+	int c, i;
+
+	execution_params.prefetch = false;
+
+	while ((c = ketopt(&o, argc, argv, 1, "o:", 0)) >= 0) {
+		if (c == 'o') {
+			execution_params.output_name = o.arg;
+			execution_params.use_stdout = false;
+		}
+	}
+
+	if (o.ind >= argc) {
+		cerr << "No archive name\n";
+		return false;
+	}
+
+	execution_params.in_archive_name = argv[o.ind];
+
+	if (o.ind + 1 >= argc) {
+		cerr << "No digest\n";
+		return false;
+	}
+
+	for (i = o.ind + 1; i < argc; ++i)
+		execution_params.digests.emplace_back(argv[i]);
+
+	return true;
+}
+
 // *******************************************************************************************
 void CApplication::usage_info() const
 {
 	cerr << AGC_VERSION << endl;
 	cerr << "Usage: agc info [options] <in.agc> > <out.txt>\n";
+	cerr << "       agc info --cpu\n";
     cerr << "Options:\n";
     cerr << "   -o <file_name> - output to file (default: output is sent to stdout)\n";
+	cerr << "   --cpu          - show CPU features and selected variants of kernels (no archive needed)\n";
 //    cerr << "   -v <int>       - verbosity level " << execution_params.verbosity.info() << "\n";      // Valid but hidden option
 }
 
@@ -547,12 +1074,98 @@ bool CApplication::parse_params_info(const int argc, const char** argv)
 	execution_params.prefetch = false;
 	execution_params.verbosity.assign(0);
 
-	while ((c = ketopt(&o, argc, argv, 1, "o:v:", 0)) >= 0) {
+	while ((c = ketopt(&o, argc, argv, 1, "o:v:", long_options_info)) >= 0) {
 		if (c == 'o') {
 			execution_params.output_name = o.arg;
 			execution_params.use_stdout = false;
 		} else if (c == 'v') {
 			execution_params.verbosity.assign(atoi(o.arg));
+		} else if (c == lo_cpu) {
+			execution_params.cpu_info = true;
+		}
+	}
+
+	if (execution_params.cpu_info)
+		return true;
+
+	if (o.ind >= argc) {
+		cerr << "No archive name\n";
+		return false;
+	}
+
+	execution_params.in_archive_name = argv[o.ind];
+
+	return true;
+}
+
+// *******************************************************************************************
+void CApplication::usage_serve() const
+{
+	cerr << AGC_VERSION << endl;
+	cerr << "Usage: agc serve [options] <in.agc>\n";
+	cerr << "Options:\n";
+	cerr << "   -p             - disable file prefetching (useful for huge archives)" << "\n";
+	cerr << "   -s <file_name> - Unix domain socket (default: " << execution_params.socket_name << ")\n";
+	cerr << "   -t <int>       - no of threads (max. no. of clients served at once) " << execution_params.no_threads.info() << "\n";
+	cerr << "   -v <int>       - verbosity level " << execution_params.verbosity.info() << "\n";
+}
+
+// *******************************************************************************************
+bool CApplication::parse_params_serve(const int argc, const char** argv)
+{
+	ketopt_t o = KETOPT_INIT;
+	int c;
+
+	execution_params.prefetch = true;
+
+	while ((c = ketopt(&o, argc, argv, 1, "ps:t:v:", 0)) >= 0) {
+		if (c == 'p') {
+			execution_params.prefetch = false;
+		} else if (c == 's') {
+			execution_params.socket_name = o.arg;
+		} else if (c == 't') {
+			execution_params.no_threads.assign(atoi(o.arg));
+		} else if (c == 'v') {
+			execution_params.verbosity.assign(atoi(o.arg));
+		}
+	}
+
+	if (o.ind >= argc) {
+		cerr << "No archive name\n";
+		return false;
+	}
+
+	execution_params.in_archive_name = argv[o.ind];
+
+	return true;
+}
+
+// *******************************************************************************************
+void CApplication::usage_verify() const
+{
+	cerr << AGC_VERSION << endl;
+	cerr << "Usage: agc verify [options] <in.agc>\n";
+	cerr << "Options:\n";
+	cerr << "   -t <int>       - no of threads " << execution_params.no_threads.info() << "\n";
+	cerr << "   -v <int>       - verbosity level " << execution_params.verbosity.info() << "\n";
+	cerr << "   --full         - decode all segments even if part checksums are stored in archive (default: " << boolalpha << execution_params.full_verification << noboolalpha << ")\n";
+}
+
+// *******************************************************************************************
+bool CApplication::parse_params_verify(const int argc, const char** argv)
+{
+	ketopt_t o = KETOPT_INIT;
+	int c;
+
+	execution_params.prefetch = false;
+
+	while ((c = ketopt(&o, argc, argv, 1, "t:v:", long_options_verify)) >= 0) {
+		if (c == 't') {
+			execution_params.no_threads.assign(atoi(o.arg));
+		} else if (c == 'v') {
+			execution_params.verbosity.assign(atoi(o.arg));
+		} else if (c == lo_full) {
+			execution_params.full_verification = true;
 		}
 	}
 
@@ -629,5 +1242,31 @@ void CApplication::remove_common_suffixes(string& sample_name)
 	}
 }
 
+// *******************************************************************************************
+// Sample name is the file name without path and common suffixes ("stdin" for standard input)
+string CApplication::sample_name_of_file(const string& file_name)
+{
+	if (file_name == "-")
+		return "stdin";
+
+	string sample_name = std::filesystem::path(file_name).stem().string();
+	remove_common_suffixes(sample_name);
+
+	return sample_name;
+}
+
+// *******************************************************************************************
+// Standard input ("-") and named pipes can be read only once
+bool CApplication::is_rereadable_file(const string& file_name)
+{
+	if (file_name == "-")
+		return false;
+
+	error_code ec;
+	auto status = std::filesystem::status(file_name, ec);
+
+	return ec || !std::filesystem::is_fifo(status);
+}
+
 
 // EOF
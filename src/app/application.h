@@ -49,6 +49,7 @@ public:
 struct CParams
 {
 	vector<string> input_names;
+	vector<string> hot_samples;
 	string in_archive_name;
 	string out_archive_name;
 	string kmc_db_name;
@@ -57,17 +58,26 @@ struct CParams
 	string output_name;
 	vector<string> sample_names;
 	vector<string> contig_names;
+	vector<string> digests;
 	string contig_name;
+	string regions_name;
+	string socket_name = "agc.sock";
+	string autotune_objective;
 	string mode;
 
 	b_value<uint32_t> k{ 31, 17, 32 };
 	b_value<uint32_t> pack_cardinality{ 50, 1, 1'000'000'000 };
+	b_value<uint32_t> hot_pack_cardinality{ 1, 1, 1'000'000'000 };
 	b_value<uint32_t> segment_size{ 60'000, 100, 1'000'000 };
 	b_value<uint32_t> min_match_length{ 20, 15, 32 };
 	b_value<uint32_t> no_threads{ max<uint32_t>(1, thread::hardware_concurrency() / 2), 1, max<uint32_t>(16, thread::hardware_concurrency()) };
 	b_value<uint32_t> line_length{ 80, 40, 2'000'000'000 };
 	b_value<uint32_t> verbosity{ 0, 0, 2 };
 	b_value<uint32_t> gzip_level{ 0, 0, 9 };
+	b_value<uint32_t> readahead_depth{ 64, 0, 1'000'000 };
+	b_value<uint32_t> checkpoint_interval{ 0, 0, 1'000'000'000 };
+	b_value<uint32_t> max_memory{ 0, 0, 1'000'000'000 };
+	b_value<uint32_t> autotune_samples{ 2, 1, 1'000 };
 	b_value<double> fallback_frac{ 0, 0, 0.05 };
 
 	uint32_t no_segments = 0;
@@ -79,6 +89,17 @@ struct CParams
 	bool no_ref = false;
 	bool fast = false;
 	bool streaming = false;
+	bool numa = false;
+	bool huge_pages = false;
+	bool seekable_packs = false;
+	bool use_mmap = false;
+	bool contig_lengths = false;
+	bool contig_digests = false;
+	bool part_checksums = false;
+	bool full_verification = false;
+	bool resume = false;
+	bool pansn = false;
+	bool cpu_info = false;
 
 	CParams() = default;
 };
@@ -93,38 +114,66 @@ class CApplication
 	void usage() const;
 	void usage_create() const;
 	void usage_append() const;
+	void usage_merge() const;
+	void usage_subset() const;
+	void usage_remove() const;
+	void usage_compact() const;
+	void usage_optimize() const;
 	void usage_getcol() const;
 	void usage_getset() const;
 	void usage_getctg() const;
 	void usage_listref() const;
 	void usage_listset() const;
 	void usage_listctg() const;
+	void usage_lookup() const;
 	void usage_info() const;
+	void usage_serve() const;
+	void usage_verify() const;
 
 	bool load_file_names(const string & fn, vector<string>& v_file_names);
 
 	bool parse_params_create(const int argc, const char** argv);
 	bool parse_params_append(const int argc, const char** argv);
+	bool parse_params_merge(const int argc, const char** argv);
+	bool parse_params_subset(const int argc, const char** argv);
+	bool parse_params_remove(const int argc, const char** argv);
+	bool parse_params_compact(const int argc, const char** argv);
+	bool parse_params_optimize(const int argc, const char** argv);
 	bool parse_params_getcol(const int argc, const char** argv);
 	bool parse_params_getset(const int argc, const char** argv);
 	bool parse_params_getctg(const int argc, const char** argv);
 	bool parse_params_listref(const int argc, const char** argv);
 	bool parse_params_listset(const int argc, const char** argv);
 	bool parse_params_listctg(const int argc, const char** argv);
+	bool parse_params_lookup(const int argc, const char** argv);
 	bool parse_params_info(const int argc, const char** argv);
+	bool parse_params_serve(const int argc, const char** argv);
+	bool parse_params_verify(const int argc, const char** argv);
 
 	void sanitize_input_file_names(vector<string> &v_file_names);
 	void remove_common_suffixes(string& sample_name);
+	string sample_name_of_file(const string& file_name);
+	bool is_rereadable_file(const string& file_name);
 
+	bool autotune();
 	bool create();
 	bool append();
+	bool resume();
+	bool merge();
+	bool subset();
+	bool remove();
+	bool compact();
+	bool optimize();
 	bool getcol();
 	bool getset();
 	bool getctg();
 	bool listref();
 	bool listset();
 	bool listctg();
+	bool lookup();
 	bool info();
+	bool serve();
+	bool verify();
 
 public:
 	CApplication() = default;
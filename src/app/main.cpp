@@ -14,6 +14,10 @@
 #include <vector>
 #include <algorithm>
 #include <filesystem>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <iomanip>
 
 #ifdef _MSC_VER 
 #include <mimalloc.h>
@@ -23,6 +27,9 @@
 #include "../app/application.h"
 #include "../core/agc_compressor.h"
 #include "../core/agc_decompressor.h"
+#include "../core/agc_server.h"
+#include "../common/digest.h"
+#include "../common/cpu_dispatch.h"
 
 using namespace std;
 using namespace std::chrono;
@@ -39,11 +46,22 @@ int CApplication::Run(const int argc, const char** argv)
     cmd_line.pop_back();
 
     auto t1 = chrono::high_resolution_clock::now();
+    bool succeeded = true;
 
     if (execution_params.mode == "create")
         create();
     else if (execution_params.mode == "append")
         append();
+    else if (execution_params.mode == "merge")
+        succeeded = merge();
+    else if (execution_params.mode == "subset")
+        succeeded = subset();
+    else if (execution_params.mode == "remove")
+        succeeded = remove();
+    else if (execution_params.mode == "compact")
+        succeeded = compact();
+    else if (execution_params.mode == "optimize")
+        succeeded = optimize();
     else if (execution_params.mode == "getcol")
         getcol();
     else if (execution_params.mode == "getset")
@@ -56,8 +74,14 @@ int CApplication::Run(const int argc, const char** argv)
         listset();
     else if (execution_params.mode == "listctg")
         listctg();
+    else if (execution_params.mode == "lookup")
+        lookup();
     else if (execution_params.mode == "info")
         info();
+    else if (execution_params.mode == "serve")
+        serve();
+    else if (execution_params.mode == "verify")
+        succeeded = verify();
     else
     {
         cerr << "Unknown mode: " << execution_params.mode << endl;
@@ -69,16 +93,277 @@ int CApplication::Run(const int argc, const char** argv)
     if(execution_params.verbosity() > 0)
         cerr << "***\nCompleted in           : " << duration_cast<duration<double>>(t2 - t1).count() << " s" << endl;
 
-    return 0;
+    return succeeded ? 0 : 1;
+}
+
+// *******************************************************************************************
+// Trial compressions of a random subset of samples over a grid of parameters around the given ones.
+// The parameters of the best trial (according to the objective) replace the given ones.
+bool CApplication::autotune()
+{
+    struct trial_t {
+        uint32_t k, l, s, b;
+        size_t size = 0;
+        double compression_time = 0;
+        double access_time = 0;
+        bool ok = false;
+    };
+
+    const string& objective = execution_params.autotune_objective;
+    const string& ref_file_name = execution_params.input_names.front();
+
+    // Files read once (stdin, named pipes) cannot be used in trials
+    vector<string> v_cand_files;
+
+    for (size_t i = 1; i < execution_params.input_names.size(); ++i)
+        if (is_rereadable_file(execution_params.input_names[i]))
+            v_cand_files.emplace_back(execution_params.input_names[i]);
+
+    if (v_cand_files.empty())
+    {
+        cerr << "Autotuning needs sample files (other than reference) that can be read many times\n";
+        return false;
+    }
+
+    mt19937 mt;
+    shuffle(v_cand_files.begin(), v_cand_files.end(), mt);
+    v_cand_files.resize(min<size_t>(v_cand_files.size(), execution_params.autotune_samples()));
+
+    vector<pair<string, string>> v_sample_file_names;
+
+    for (auto& fn : v_cand_files)
+        v_sample_file_names.emplace_back(sample_name_of_file(fn), fn);
+
+    // Grid of parameters around the given ones
+    auto grid = [](const vector<int64_t>& v_values, const int64_t min_value, const int64_t max_value) {
+        vector<uint32_t> v_grid;
+
+        for (auto x : v_values)
+            v_grid.emplace_back((uint32_t) clamp(x, min_value, max_value));
+
+        sort(v_grid.begin(), v_grid.end());
+        v_grid.erase(unique(v_grid.begin(), v_grid.end()), v_grid.end());
+
+        return v_grid;
+    };
+
+    int64_t k = execution_params.k();
+    int64_t l = execution_params.min_match_length();
+    int64_t s = execution_params.segment_size();
+    int64_t b = execution_params.pack_cardinality();
+
+    auto v_k = grid({ k - 4, k }, 17, 32);
+    auto v_l = grid({ l - 4, l, l + 4 }, 15, 32);
+    auto v_s = grid({ s / 2, s, s * 2 }, 100, 1'000'000);
+
+    // Batch sizes exceeding the no. of trial samples (besides reference) are indistinguishable in trials
+    auto v_b = grid({ b / 5, b }, 1, 1'000'000'000);
+    erase_if(v_b, [&](uint32_t x) { return x != b && x > v_sample_file_names.size(); });
+
+    vector<trial_t> v_trials;
+
+    for (auto tk : v_k)
+        for (auto tl : v_l)
+            for (auto ts : v_s)
+                for (auto tb : v_b)
+                    v_trials.emplace_back(trial_t{ tk, tl, ts, tb });
+
+    // Compression times are comparable only if trials are not run in parallel
+    const uint32_t no_threads = execution_params.no_threads();
+    const uint32_t no_parallel_trials = objective == "speed" ? 1 : (uint32_t) min<size_t>(v_trials.size(), max<uint32_t>(1, no_threads / 2));
+    const uint32_t no_trial_threads = max<uint32_t>(1, no_threads / no_parallel_trials);
+
+    const uint32_t no_queries = 100;
+    const int64_t query_length = 10'000;
+
+    if (execution_params.verbosity() > 0)
+    {
+        cerr << "Autotuning (" << objective << ") on samples:";
+        for (auto& x : v_sample_file_names)
+            cerr << " " << x.first;
+        cerr << "\nNo. of trials: " << v_trials.size() << " (" << no_parallel_trials << " in parallel)\n";
+    }
+
+    error_code ec;
+    auto temp_dir = filesystem::temp_directory_path(ec);
+
+    if (ec)
+    {
+        cerr << "Cannot access temporary directory\n";
+        return false;
+    }
+
+    random_device rd;
+    string temp_prefix = "agc-tune-" + to_string(rd()) + to_string(rd()) + "-";
+
+    auto trial_archive_name = [&](const size_t id) {
+        return (temp_dir / (temp_prefix + to_string(id) + ".agc")).string();
+    };
+
+    auto compress_trial = [&](trial_t& trial, const string& archive_name) {
+        auto t1 = high_resolution_clock::now();
+
+        {
+            CAGCCompressor agc_c;
+
+            agc_c.SetSeekablePacks(execution_params.seekable_packs);
+            agc_c.SetPanSN(execution_params.pansn);
+
+            if (!agc_c.Create(archive_name, trial.b, trial.k, ref_file_name, trial.s, trial.l,
+                execution_params.concatenated_genomes, execution_params.adaptive_compression, 0, no_trial_threads, execution_params.fallback_frac()))
+                return;
+
+            bool r = agc_c.AddSampleFiles(v_sample_file_names, no_trial_threads);
+            r &= agc_c.Close(no_trial_threads);
+
+            if (!r)
+                return;
+        }
+
+        auto t2 = high_resolution_clock::now();
+
+        error_code f_ec;
+        trial.size = filesystem::file_size(archive_name, f_ec);
+        trial.compression_time = duration_cast<duration<double>>(t2 - t1).count();
+        trial.ok = true;
+    };
+
+    // Random-access latency: the same random ranges are extracted from all trial archives
+    auto measure_access = [&](trial_t& trial, const string& archive_name) {
+        CAGCDecompressor agc_d(false);
+
+        if (!agc_d.Open(archive_name, false))
+        {
+            trial.ok = false;
+            return;
+        }
+
+        vector<pair<string, string>> v_contigs;
+        vector<string> v_samples;
+        vector<string> v_sample_contigs;
+
+        agc_d.ListSamples(v_samples);
+
+        for (auto& sample : v_samples)
+        {
+            agc_d.ListContigs(sample, v_sample_contigs);
+
+            for (auto& ctg : v_sample_contigs)
+                v_contigs.emplace_back(sample, ctg);
+        }
+
+        mt19937_64 q_mt;
+        string ctg_data;
+        duration<double> access_time(0);
+
+        for (uint32_t i = 0; i < no_queries && !v_contigs.empty(); ++i)
+        {
+            auto& q = v_contigs[q_mt() % v_contigs.size()];
+            int64_t len = agc_d.GetContigLength(q.first, q.second);
+            int64_t from = len > query_length ? (int64_t) (q_mt() % (len - query_length)) : 0;
+            int64_t to = min(from + query_length, len) - 1;
+
+            auto q1 = high_resolution_clock::now();
+            agc_d.GetContigString(q.first, q.second, from, to, ctg_data);
+            access_time += high_resolution_clock::now() - q1;
+        }
+
+        agc_d.Close();
+
+        trial.access_time = access_time.count() * 1000.0 / no_queries;
+    };
+
+    atomic<size_t> trial_id = 0;
+    vector<thread> v_threads;
+
+    for (uint32_t i = 0; i < no_parallel_trials; ++i)
+        v_threads.emplace_back([&] {
+            for (size_t id = trial_id++; id < v_trials.size(); id = trial_id++)
+                compress_trial(v_trials[id], trial_archive_name(id));
+        });
+
+    for (auto& t : v_threads)
+        t.join();
+
+    // Latencies are measured with no other work in progress
+    for (size_t id = 0; id < v_trials.size(); ++id)
+    {
+        auto archive_name = trial_archive_name(id);
+
+        if (v_trials[id].ok)
+            measure_access(v_trials[id], archive_name);
+
+        error_code r_ec;
+        filesystem::remove(archive_name, r_ec);
+    }
+
+    // Objective value (smaller is better); ties are resolved by archive size
+    auto score = [&](const trial_t& trial) {
+        if (objective == "speed")
+            return make_pair(trial.compression_time, (double) trial.size);
+        if (objective == "access")
+            return make_pair(trial.access_time, (double) trial.size);
+        return make_pair((double) trial.size, trial.compression_time);
+    };
+
+    const trial_t* best = nullptr;
+
+    for (auto& trial : v_trials)
+        if (trial.ok && (!best || score(trial) < score(*best)))
+            best = &trial;
+
+    if (!best)
+    {
+        cerr << "All autotuning trials failed\n";
+        return false;
+    }
+
+    cerr << "Autotuning trials (objective: " << objective << "):\n";
+    cerr << "       k    l        s         b     size [B]  compr. [s]  access [ms]\n";
+
+    for (auto& trial : v_trials)
+    {
+        cerr << (&trial == best ? "   * " : "     ");
+        cerr << setw(3) << trial.k << setw(5) << trial.l << setw(9) << trial.s << setw(10) << trial.b;
+
+        if (trial.ok)
+            cerr << setw(13) << trial.size << fixed << setprecision(2) << setw(12) << trial.compression_time << setprecision(3) << setw(13) << trial.access_time << defaultfloat << "\n";
+        else
+            cerr << "  failed\n";
+    }
+
+    execution_params.k.assign(best->k);
+    execution_params.min_match_length.assign(best->l);
+    execution_params.segment_size.assign(best->s);
+    execution_params.pack_cardinality.assign(best->b);
+
+    cerr << "Chosen parameters: -k " << best->k << " -l " << best->l << " -s " << best->s << " -b " << best->b << "\n";
+
+    return true;
 }
 
 // *******************************************************************************************
 bool CApplication::create()
 {
+    if (execution_params.resume)
+        return resume();
+
+    if (!execution_params.autotune_objective.empty() && !autotune())
+        return false;
+
     CAGCCompressor agc_c;
 
     sanitize_input_file_names(execution_params.input_names);
 
+    agc_c.SetNumaAware(execution_params.numa);
+    agc_c.SetHugePages(execution_params.huge_pages);
+    agc_c.SetSeekablePacks(execution_params.seekable_packs);
+    agc_c.SetPartChecksums(execution_params.part_checksums);
+    agc_c.SetHotSamples(execution_params.hot_samples, execution_params.hot_pack_cardinality());
+    agc_c.SetCheckpoints(execution_params.checkpoint_interval());
+    agc_c.SetMaxMemory((size_t) execution_params.max_memory() << 20);
+    agc_c.SetPanSN(execution_params.pansn);
+
     bool r = agc_c.Create(
         execution_params.out_archive_name,
         execution_params.pack_cardinality(),
@@ -104,11 +389,7 @@ bool CApplication::create()
     vector<pair<string, string>> v_sample_file_names;
 
     for (auto& fn : execution_params.input_names)
-    {
-        string sample_name = std::filesystem::path(fn).stem().string();
-        remove_common_suffixes(sample_name);
-        v_sample_file_names.emplace_back(sample_name, fn);
-    }
+        v_sample_file_names.emplace_back(sample_name_of_file(fn), fn);
 
     if(r)
         r &= agc_c.AddSampleFiles(v_sample_file_names, execution_params.no_threads());
@@ -124,10 +405,21 @@ bool CApplication::create()
 // *******************************************************************************************
 bool CApplication::append()
 {
+    if (execution_params.resume)
+        return resume();
+
     CAGCCompressor agc_c;
 
     sanitize_input_file_names(execution_params.input_names);
 
+    agc_c.SetNumaAware(execution_params.numa);
+    agc_c.SetHugePages(execution_params.huge_pages);
+    agc_c.SetPartChecksums(execution_params.part_checksums);
+    agc_c.SetHotSamples(execution_params.hot_samples, execution_params.hot_pack_cardinality());
+    agc_c.SetCheckpoints(execution_params.checkpoint_interval());
+    agc_c.SetMaxMemory((size_t) execution_params.max_memory() << 20);
+    agc_c.SetPanSN(execution_params.pansn);
+
     bool r = agc_c.Append(
         execution_params.in_archive_name, 
         execution_params.out_archive_name, 
@@ -147,11 +439,7 @@ bool CApplication::append()
     vector<pair<string, string>> v_sample_file_names;
 
     for (auto& fn : execution_params.input_names)
-    {
-        string sample_name = std::filesystem::path(fn).stem().string();
-        remove_common_suffixes(sample_name);
-        v_sample_file_names.emplace_back(sample_name, fn);
-    }
+        v_sample_file_names.emplace_back(sample_name_of_file(fn), fn);
 
     if (execution_params.verbosity() > 0)
         cerr << "Start of compression\n";
@@ -167,11 +455,191 @@ bool CApplication::append()
     return r;
 }
 
+// *******************************************************************************************
+// Continuation of create/append from the last checkpoint of the output archive: the checkpoint is appended by the
+// samples that are not stored in it yet
+bool CApplication::resume()
+{
+    CAGCCompressor agc_c;
+
+    sanitize_input_file_names(execution_params.input_names);
+
+    agc_c.SetNumaAware(execution_params.numa);
+    agc_c.SetHugePages(execution_params.huge_pages);
+    agc_c.SetPartChecksums(execution_params.part_checksums);
+    agc_c.SetHotSamples(execution_params.hot_samples, execution_params.hot_pack_cardinality());
+    agc_c.SetCheckpoints(execution_params.checkpoint_interval());
+    agc_c.SetMaxMemory((size_t) execution_params.max_memory() << 20);
+
+    string resume_archive_name;
+
+    if (!agc_c.PrepareResume(execution_params.out_archive_name, resume_archive_name))
+        return false;
+
+    vector<string> v_stored_samples;
+
+    {
+        CAGCDecompressor agc_d(false);
+
+        if (!agc_d.Open(resume_archive_name, false) || !agc_d.ListSamples(v_stored_samples))
+        {
+            cerr << "Cannot open archive " << resume_archive_name << endl;
+            return false;
+        }
+    }
+
+    bool r = agc_c.Append(
+        resume_archive_name,
+        execution_params.out_archive_name,
+        execution_params.verbosity(),
+        true,
+        execution_params.concatenated_genomes,
+        execution_params.adaptive_compression,
+        execution_params.no_threads(),
+        execution_params.fallback_frac());
+
+    if (!r)
+    {
+        cerr << "Cannot open archive " << resume_archive_name << " or create archive " << execution_params.out_archive_name << endl;
+        return false;
+    }
+
+    set<string> s_stored_samples(v_stored_samples.begin(), v_stored_samples.end());
+    vector<pair<string, string>> v_sample_file_names;
+
+    // In the PanSN mode samples are not related to files, so they are skipped when read
+    if (execution_params.pansn)
+        agc_c.SetPanSN(true, v_stored_samples);
+
+    for (auto& fn : execution_params.input_names)
+    {
+        string sample_name = sample_name_of_file(fn);
+
+        if (execution_params.pansn || !s_stored_samples.count(sample_name))
+            v_sample_file_names.emplace_back(sample_name, fn);
+    }
+
+    if (execution_params.verbosity() > 0)
+        cerr << "Resumed after " << s_stored_samples.size() << " samples\n";
+
+    if (r)
+        r &= agc_c.AddSampleFiles(v_sample_file_names, execution_params.no_threads());
+
+    if (r && execution_params.store_cmd_line)
+        agc_c.AddCmdLine(cmd_line);
+
+    r &= agc_c.Close(execution_params.no_threads());
+
+    return r;
+}
+
+// *******************************************************************************************
+bool CApplication::merge()
+{
+    CAGCCompressor agc_c;
+
+    bool r = agc_c.Append(
+        execution_params.in_archive_name,
+        execution_params.out_archive_name,
+        execution_params.verbosity(),
+        true,
+        false,
+        false,
+        execution_params.no_threads(),
+        0);
+
+    if (!r)
+    {
+        cerr << "Cannot open archive " << execution_params.in_archive_name << " or create archive " << execution_params.out_archive_name << endl;
+        return false;
+    }
+
+    r &= agc_c.MergeArchives(execution_params.input_names, execution_params.no_threads());
+
+    if (r && execution_params.store_cmd_line)
+        agc_c.AddCmdLine(cmd_line);
+
+    r &= agc_c.Close(execution_params.no_threads());
+
+    return r;
+}
+
+// *******************************************************************************************
+bool CApplication::subset()
+{
+    CAGCCompressor agc_c;
+
+    bool r = agc_c.Subset(
+        execution_params.in_archive_name,
+        execution_params.out_archive_name,
+        execution_params.sample_names,
+        execution_params.verbosity(),
+        execution_params.no_threads());
+
+    if (r && execution_params.store_cmd_line)
+        agc_c.AddCmdLine(cmd_line);
+
+    r &= agc_c.Close(execution_params.no_threads());
+
+    return r;
+}
+
+// *******************************************************************************************
+bool CApplication::remove()
+{
+    CAGCCompressor agc_c;
+
+    return agc_c.RemoveSamples(execution_params.in_archive_name, execution_params.sample_names, execution_params.verbosity());
+}
+
+// *******************************************************************************************
+bool CApplication::compact()
+{
+    CAGCCompressor agc_c;
+
+    // All samples that are not removed
+    bool r = agc_c.Subset(
+        execution_params.in_archive_name,
+        execution_params.out_archive_name,
+        {},
+        execution_params.verbosity(),
+        execution_params.no_threads());
+
+    if (r && execution_params.store_cmd_line)
+        agc_c.AddCmdLine(cmd_line);
+
+    r &= agc_c.Close(execution_params.no_threads());
+
+    return r;
+}
+
+// *******************************************************************************************
+bool CApplication::optimize()
+{
+    CAGCCompressor agc_c;
+
+    bool r = agc_c.Optimize(
+        execution_params.in_archive_name,
+        execution_params.out_archive_name,
+        execution_params.verbosity(),
+        execution_params.no_threads());
+
+    if (r && execution_params.store_cmd_line)
+        agc_c.AddCmdLine(cmd_line);
+
+    r &= agc_c.Close(execution_params.no_threads());
+
+    return r;
+}
+
 // *******************************************************************************************
 bool CApplication::getcol()
 {
     CAGCDecompressor agc_d(true);
 
+    if (execution_params.use_mmap)
+        agc_d.SetArchiveBackend(archive_backend_t::mmap);
+
     bool r = agc_d.Open(execution_params.in_archive_name, execution_params.prefetch);
         
     if (!r)
@@ -180,6 +648,8 @@ bool CApplication::getcol()
         return false;
     }
 
+    agc_d.SetReadaheadDepth(execution_params.readahead_depth());
+
     r &= agc_d.GetCollectionFiles(
         execution_params.output_name,
         execution_params.line_length(), 
@@ -199,6 +669,9 @@ bool CApplication::getset()
 {
     CAGCDecompressor agc_d(true);
 
+    if (execution_params.use_mmap)
+        agc_d.SetArchiveBackend(archive_backend_t::mmap);
+
     bool r = agc_d.Open(execution_params.in_archive_name, execution_params.prefetch);
 
     if (!r)
@@ -207,6 +680,8 @@ bool CApplication::getset()
         return false;
     }
 
+    agc_d.SetReadaheadDepth(execution_params.readahead_depth());
+
     if(execution_params.streaming)
         r &= agc_d.GetSampleForStreaming(
             execution_params.output_name,
@@ -234,6 +709,9 @@ bool CApplication::getctg()
 {
     CAGCDecompressor agc_d(true);
 
+    if (execution_params.use_mmap)
+        agc_d.SetArchiveBackend(archive_backend_t::mmap);
+
     bool r = agc_d.Open(execution_params.in_archive_name, execution_params.prefetch);
 
     if (!r)
@@ -242,7 +720,15 @@ bool CApplication::getctg()
         return false;
     }
 
-    if (execution_params.streaming)
+    if (!execution_params.regions_name.empty())
+        r &= agc_d.GetRegionsFile(
+            execution_params.output_name,
+            execution_params.regions_name,
+            execution_params.line_length(),
+            execution_params.no_threads(),
+            execution_params.gzip_level(),
+            execution_params.verbosity());
+    else if (execution_params.streaming)
         r &= agc_d.GetContigForStreaming(
             execution_params.output_name, 
             execution_params.contig_names, 
@@ -355,6 +841,41 @@ bool CApplication::listctg()
     {
         outf.Write(sn + "\n");
 
+        if (execution_params.contig_lengths || execution_params.contig_digests)
+        {
+            vector<pair<string, contig_stats_t>> v_contig_stats;
+            vector<pair<string, contig_digest_t>> v_contig_digests;
+            bool has_composition;
+
+            agc_d.ListContigStats(sn, v_contig_stats, has_composition);
+
+            if (execution_params.contig_digests && !agc_d.ListContigDigests(sn, v_contig_digests))
+            {
+                cerr << "No contig digests in archive\n";
+                r = false;
+                break;
+            }
+
+            for (size_t i = 0; i < v_contig_stats.size(); ++i)
+            {
+                string line = "   " + v_contig_stats[i].first;
+
+                if (execution_params.contig_lengths)
+                    line += "\t" + to_string(v_contig_stats[i].second.length);
+
+                if (execution_params.contig_digests && i < v_contig_digests.size())
+                {
+                    auto& digest = v_contig_digests[i].second;
+                    line += "\t" + digest_to_hex(digest.md5.data(), digest.md5.size());
+                    line += "\tSQ." + digest_to_base64url(digest.sha512t24.data(), digest.sha512t24.size());
+                }
+
+                outf.Write(line + "\n");
+            }
+
+            continue;
+        }
+
         vector<string> v_contigs;
 
         agc_d.ListContigs(sn, v_contigs);
@@ -370,9 +891,67 @@ bool CApplication::listctg()
     return r;
 }
 
+// *******************************************************************************************
+bool CApplication::lookup()
+{
+    CAGCDecompressor agc_d(true);
+
+    bool r = agc_d.Open(execution_params.in_archive_name, execution_params.prefetch);
+
+    if (!r)
+        return false;
+
+    COutFile outf;
+    r &= outf.Open(execution_params.output_name);
+
+    if (!r)
+    {
+        cerr << "Cannot open output file " << execution_params.output_name << endl;
+        return false;
+    }
+
+    vector<pair<string, string>> v_sample_contig;
+
+    for (auto& digest : execution_params.digests)
+    {
+        if (!agc_d.FindContigsByDigest(digest, v_sample_contig))
+        {
+            cerr << "Cannot look up digest " << digest << " (malformed digest or no digests in archive)\n";
+            r = false;
+            continue;
+        }
+
+        for (auto& x : v_sample_contig)
+            outf.Write(digest + "\t" + x.first + "\t" + x.second + "\n");
+    }
+
+    outf.Close();
+
+    r &= agc_d.Close();
+
+    return r;
+}
+
 // *******************************************************************************************
 bool CApplication::info()
 {
+    if (execution_params.cpu_info)
+    {
+        auto& cpu = CCpuDispatch::Instance();
+
+        cerr << "CPU features     :";
+        for (auto& x : cpu.GetFeatures())
+            cerr << " " << x;
+        cerr << (cpu.GetFeatures().empty() ? " none\n" : "\n");
+        cerr << "Detected level   : " << CCpuDispatch::LevelName(cpu.GetDetectedLevel()) << endl;
+        cerr << "Selected level   : " << CCpuDispatch::LevelName(cpu.GetLevel()) << (getenv("AGC_CPU") ? " (AGC_CPU=" + string(getenv("AGC_CPU")) + ")" : "") << endl;
+        cerr << "Kernels:\n";
+        for (auto& x : cpu.GetKernels())
+            cerr << "   " << x.first << ": " << x.second << endl;
+
+        return true;
+    }
+
     CAGCDecompressor agc_d(true);
 
     if (!agc_d.Open(execution_params.in_archive_name, execution_params.prefetch))
@@ -395,6 +974,8 @@ bool CApplication::info()
     agc_d.GetReferenceSample(ref_name);
 
     cerr << "No. samples      : " << v_sample_names.size() << endl;
+    if (agc_d.GetNoRemovedSamples())
+        cerr << "Removed samples  : " << agc_d.GetNoRemovedSamples() << " (space can be reclaimed by agc compact)" << endl;
     cerr << "k-mer length     : " << kmer_length << endl;
     cerr << "Min. match length: " << min_match_len << endl;
     if(segment_size)
@@ -406,6 +987,72 @@ bool CApplication::info()
     for (auto& cmd : cmd_lines)
         cerr << cmd.second << " : " << cmd.first << endl;
 
+    // Summary from contig stats stored in metadata (no decompression of sequences)
+    vector<pair<string, contig_stats_t>> v_contig_stats;
+    bool has_composition = false;
+
+    if (!v_sample_names.empty())
+        agc_d.ListContigStats(v_sample_names.front(), v_contig_stats, has_composition);
+
+    if (has_composition)
+    {
+        uint64_t tot_length = 0;
+        uint64_t tot_gc = 0;
+        uint64_t tot_n = 0;
+        uint64_t tot_contigs = 0;
+
+        if (execution_params.verbosity() > 0)
+            cerr << "Samples (name, no. contigs, length, N50, GC content, no. Ns):" << endl;
+
+        for (auto& sn : v_sample_names)
+        {
+            agc_d.ListContigStats(sn, v_contig_stats, has_composition);
+
+            vector<uint64_t> v_lengths;
+            uint64_t length = 0;
+            uint64_t gc = 0;
+            uint64_t n = 0;
+
+            for (auto& x : v_contig_stats)
+            {
+                v_lengths.emplace_back(x.second.length);
+                length += x.second.length;
+                gc += x.second.no_gc;
+                n += x.second.no_n;
+            }
+
+            tot_length += length;
+            tot_gc += gc;
+            tot_n += n;
+            tot_contigs += v_contig_stats.size();
+
+            if (execution_params.verbosity() > 0)
+            {
+                sort(v_lengths.rbegin(), v_lengths.rend());
+
+                uint64_t n50 = 0;
+                uint64_t acc = 0;
+                for (auto x : v_lengths)
+                {
+                    acc += x;
+                    if (2 * acc >= length)
+                    {
+                        n50 = x;
+                        break;
+                    }
+                }
+
+                cerr << "  " << sn << " : " << v_contig_stats.size() << " : " << length << " : " << n50 << " : " 
+                    << (length > n ? 100.0 * gc / (length - n) : 0.0) << "% : " << n << endl;
+            }
+        }
+
+        cerr << "No. contigs      : " << tot_contigs << endl;
+        cerr << "Total length     : " << tot_length << endl;
+        cerr << "GC content       : " << (tot_length > tot_n ? 100.0 * tot_gc / (tot_length - tot_n) : 0.0) << "%" << endl;
+        cerr << "No. Ns           : " << tot_n << endl;
+    }
+
     if (execution_params.verbosity() > 0)
     {
         map<string, string> m_file_type_info;
@@ -422,6 +1069,40 @@ bool CApplication::info()
     return true;
 }
 
+// *******************************************************************************************
+bool CApplication::serve()
+{
+    CAGCServer agc_s(true);
+
+    bool r = agc_s.Open(execution_params.in_archive_name, execution_params.prefetch);
+
+    if (!r)
+        return false;
+
+    r &= agc_s.Run(execution_params.socket_name, execution_params.no_threads(), execution_params.verbosity());
+
+    r &= agc_s.Close();
+
+    return r;
+}
+
+// *******************************************************************************************
+bool CApplication::verify()
+{
+    CAGCDecompressor agc_d(true);
+
+    bool r = agc_d.Open(execution_params.in_archive_name, execution_params.prefetch);
+
+    if (!r)
+        return false;
+
+    r &= agc_d.Verify(execution_params.no_threads(), execution_params.full_verification, execution_params.verbosity());
+
+    agc_d.Close();
+
+    return r;
+}
+
 // *******************************************************************************************
 int main(int argc, char** argv)
 {
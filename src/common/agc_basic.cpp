@@ -41,6 +41,8 @@ CAGCBasic::CAGCBasic()
         collection_desc = static_pointer_cast<CCollection>(make_shared<CCollection_V3>());
 
     verbosity = 0;
+
+    thread_pool = make_shared<CThreadPool>();
 }
 
 // *******************************************************************************************
@@ -48,15 +50,63 @@ CAGCBasic::~CAGCBasic()
 {    
 }
 
+// *******************************************************************************************
+void CAGCBasic::SetMaxThreads(const uint32_t max_threads)
+{
+    thread_pool->SetMaxThreads(max_threads);
+}
+
+// *******************************************************************************************
+void CAGCBasic::SetThreadPinningHook(function<void(uint32_t)> hook)
+{
+    thread_pool->SetPinningHook(move(hook));
+}
+
+// *******************************************************************************************
+void CAGCBasic::SetNumaAware(const bool _numa_aware)
+{
+    auto& topology = CNumaTopology::Instance();
+
+    numa_aware = _numa_aware && topology.IsNuma();
+
+    if (!numa_aware)
+        return;
+
+    // Workers allocate their buffers themselves, so after pinning the buffers are placed at the local node (first-touch policy)
+    thread_pool->SetPinningHook([&topology](uint32_t worker_id) {
+        topology.PinCurrentThreadToNode(topology.NodeForWorker(worker_id));
+        });
+}
+
+// *******************************************************************************************
+void CAGCBasic::SetHugePages(const bool _huge_pages)
+{
+    CHugePages::SetEnabled(_huge_pages);
+}
+
+// *******************************************************************************************
+// Set placement policy for large memory block shared by all workers (must be called before the block is touched)
+void CAGCBasic::advise_memory(void* ptr, size_t size)
+{
+    if (numa_aware)
+        CNumaTopology::Instance().InterleaveMemory(ptr, size);
+
+    CHugePages::Advise(ptr, size);
+}
+
 // *******************************************************************************************
 bool CAGCBasic::load_file_type_info(const string& archive_name)
 {
     vector<uint8_t> v_data;
 
+    // Remote archives are never downloaded whole; only the needed parts are read (and cached)
+    if (prefetch_archive && CArchiveInput::IsRemote(archive_name))
+        prefetch_archive = false;
+
     if (prefetch_archive)
-        in_archive = make_shared<CArchive>(true, ~0ull, ss_prefix(archive_version));           // ~0ull - special value - buffers whole archive
+        in_archive = make_shared<CArchive>(true, ~0ull, ss_prefix(archive_version), archive_backend);           // ~0ull - special value - buffers whole archive
     else
-        in_archive = make_shared<CArchive>(true, 32 << 10, ss_prefix(archive_version));
+        in_archive = make_shared<CArchive>(true, 32 << 10, ss_prefix(archive_version), archive_backend);
 
     if (!in_archive->Open(archive_name))
     {
@@ -236,11 +286,71 @@ bool CAGCBasic::load_metadata()
     else
         compression_params.segment_size = 0;
 
+    uint32_t pack_flags = 0;
+
+    if (has_pack_ext() && v_params.end() - p >= 4)
+        read(p, pack_flags);
+
+    seekable_packs = (pack_flags & 1u) != 0;
+
     kmer_length = compression_params.kmer_length;
     pack_cardinality = compression_params.pack_cardinality;
     min_match_len = compression_params.min_match_len;
     segment_size = compression_params.segment_size;
 
+    if (has_pack_ext())
+        return load_pack_layouts();
+
+    m_pack_layouts.clear();
+
+    return true;
+}
+
+// *******************************************************************************************
+// Layout is stored (as ZSTD-compressed list of pack sizes) only for groups with non-uniform packs
+bool CAGCBasic::load_pack_layouts()
+{
+    m_pack_layouts.clear();
+
+    int s_id = in_archive->GetStreamId("pack-layout");
+
+    if (s_id < 0)
+        return true;
+
+    vector<uint8_t> v_packed;
+    uint64_t raw_size;
+
+    if (!in_archive->GetPart(s_id, v_packed, raw_size))
+        return false;
+
+    vector<uint8_t> v_data(raw_size);
+
+    if (ZSTD_isError(ZSTD_decompress(v_data.data(), v_data.size(), v_packed.data(), v_packed.size())))
+    {
+        if (is_app_mode)
+            cerr << "Corrupted pack layout\n";
+        return false;
+    }
+
+    auto p = v_data.begin();
+
+    while (p != v_data.end())
+    {
+        uint32_t group_id, no_packs, pack_size;
+
+        read(p, group_id);
+        read(p, no_packs);
+
+        auto& v_pack_ends = m_pack_layouts[group_id];
+        v_pack_ends.reserve(no_packs);
+
+        for (uint32_t i = 0; i < no_packs; ++i)
+        {
+            read(p, pack_size);
+            v_pack_ends.emplace_back((i ? v_pack_ends.back() : 0) + pack_size);
+        }
+    }
+
     return true;
 }
 
@@ -25,6 +25,9 @@
 #include "../common/collection_v2.h"
 #include "../common/collection_v3.h"
 #include "../common/queue.h"
+#include "../common/thread_pool.h"
+#include "../common/numa.h"
+#include "../common/huge_pages.h"
 
 using namespace std;
 
@@ -33,6 +36,7 @@ using namespace std;
 class CAGCBasic
 {
 	friend class CAGCDecompressor;
+	friend class CAGCCompressor;
 
 protected:
 	enum class working_mode_t { none, compression, decompression, appending, pre_appending };
@@ -66,8 +70,12 @@ protected:
 	uint32_t pack_cardinality;
 	uint32_t segment_size;
 
+	bool seekable_packs = false;
+	map<uint32_t, vector<uint32_t>> m_pack_layouts;												// groups with non-uniform packs only
+
 	string in_archive_name;
 	bool prefetch_archive = false;
+	archive_backend_t archive_backend = archive_backend_t::automatic;
 	uint32_t archive_version;
 
 	shared_ptr<CArchive> in_archive;															// internal mutexes
@@ -82,6 +90,10 @@ protected:
 
 	uint32_t verbosity;
 
+	shared_ptr<CThreadPool> thread_pool;														// persistent workers shared by all processing phases
+
+	bool numa_aware = false;
+
 	// *******************************************************************************************
 	void read(vector<uint8_t>::iterator& p, uint32_t& num)
 	{
@@ -121,14 +133,34 @@ protected:
 	bool load_metadata_impl_v3();
 
 	bool load_metadata();
+	bool load_pack_layouts();
 	bool load_file_type_info(const string& archive_name);
 
+	bool has_pack_ext() const
+	{
+		return archive_version >= AGC_FILE_MAJOR * 1000 + AGC_FILE_MINOR_PACK_EXT && archive_version < 4000;
+	}
+
+	void advise_memory(void* ptr, size_t size);
+
 	void reverse_complement(contig_t& contig);
 	void reverse_complement_copy(contig_t& src_contig, contig_t& dest_contig);
 
 public:
 	CAGCBasic();
 	~CAGCBasic();
+
+	// Limit the number of threads used in any processing phase (0 - no limit)
+	void SetMaxThreads(const uint32_t max_threads);
+
+	// Function called in each worker thread (with its id) before it starts processing tasks, e.g., to pin it to a core or NUMA node
+	void SetThreadPinningHook(function<void(uint32_t)> hook);
+
+	// Spread workers over NUMA nodes and interleave large shared structures over all nodes (no-op for single-node machines)
+	void SetNumaAware(const bool _numa_aware);
+
+	// Request (transparent) huge pages for large randomly accessed tables (setting is process-wide)
+	void SetHugePages(const bool _huge_pages);
 };
 
 // EOF
@@ -0,0 +1,347 @@
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include "agc_client.h"
+#include <cstring>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// *******************************************************************************************
+bool CSocketStream::fill_buffer()
+{
+#ifndef _WIN32
+	while (true)
+	{
+		auto n = recv(fd, buffer.data(), buffer.size(), 0);
+
+		if (n > 0)
+		{
+			buffer_pos = 0;
+			buffer_filled = (size_t)n;
+			return true;
+		}
+
+		if (n < 0 && errno == EINTR)
+			continue;
+
+		return false;
+	}
+#else
+	return false;
+#endif
+}
+
+// *******************************************************************************************
+bool CSocketStream::ReadLine(string& line)
+{
+	line.clear();
+
+	while (true)
+	{
+		if (buffer_pos == buffer_filled && !fill_buffer())
+			return !line.empty();
+
+		auto p = (const char*)memchr(buffer.data() + buffer_pos, '\n', buffer_filled - buffer_pos);
+
+		if (p)
+		{
+			size_t len = (size_t)(p - (buffer.data() + buffer_pos));
+
+			line.append(buffer.data() + buffer_pos, len);
+			buffer_pos += len + 1;
+
+			return true;
+		}
+
+		line.append(buffer.data() + buffer_pos, buffer_filled - buffer_pos);
+		buffer_pos = buffer_filled;
+	}
+}
+
+// *******************************************************************************************
+bool CSocketStream::Read(uint8_t* data, size_t size)
+{
+	while (size)
+	{
+		if (buffer_pos == buffer_filled && !fill_buffer())
+			return false;
+
+		size_t to_copy = min(size, buffer_filled - buffer_pos);
+
+		memcpy(data, buffer.data() + buffer_pos, to_copy);
+		buffer_pos += to_copy;
+		data += to_copy;
+		size -= to_copy;
+	}
+
+	return true;
+}
+
+// *******************************************************************************************
+bool CSocketStream::Write(const char* data, const size_t size)
+{
+#ifndef _WIN32
+	size_t pos = 0;
+
+	while (pos < size)
+	{
+		auto n = send(fd, data + pos, size - pos, 0);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+
+		pos += (size_t)n;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+// *******************************************************************************************
+void CSocketStream::SplitFields(const string& line, vector<string>& v_fields)
+{
+	v_fields.clear();
+
+	size_t pos = 0;
+
+	while (true)
+	{
+		size_t end = line.find('\t', pos);
+
+		if (end == string::npos)
+		{
+			v_fields.emplace_back(line.substr(pos));
+			break;
+		}
+
+		v_fields.emplace_back(line.substr(pos, end - pos));
+		pos = end + 1;
+	}
+}
+
+// *******************************************************************************************
+CAGCClient::~CAGCClient()
+{
+	Close();
+}
+
+// *******************************************************************************************
+bool CAGCClient::Connect(const string& socket_name)
+{
+#ifndef _WIN32
+	if (fd >= 0)
+		return false;
+
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+
+	if (socket_name.size() >= sizeof(addr.sun_path))
+	{
+		last_error = "Too long socket name";
+		return false;
+	}
+
+	strcpy(addr.sun_path, socket_name.c_str());
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		last_error = "Cannot create socket";
+		return false;
+	}
+
+	if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0)
+	{
+		last_error = "Cannot connect to " + socket_name;
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+
+	stream = make_unique<CSocketStream>(fd);
+
+	return true;
+#else
+	last_error = "Unix domain sockets are not supported";
+	return false;
+#endif
+}
+
+// *******************************************************************************************
+bool CAGCClient::Close()
+{
+	if (fd < 0)
+		return false;
+
+	stream.reset();
+#ifndef _WIN32
+	::close(fd);
+#endif
+	fd = -1;
+
+	return true;
+}
+
+// *******************************************************************************************
+// Return 0 for success or (negative) error code
+int CAGCClient::request(const string& req, vector<string>& v_lines)
+{
+	v_lines.clear();
+
+	if (fd < 0)
+	{
+		last_error = "Not connected";
+		return -1;
+	}
+
+	string line;
+	vector<string> v_fields;
+
+	if (!stream->Write(req + "\n") || !stream->ReadLine(line))
+	{
+		last_error = "Connection lost";
+		Close();
+		return -1;
+	}
+
+	CSocketStream::SplitFields(line, v_fields);
+
+	if (v_fields.size() >= 2 && v_fields[0] == "OK")
+	{
+		uint64_t no_lines = stoull(v_fields[1]);
+
+		v_lines.resize(no_lines);
+		for (auto& x : v_lines)
+			if (!stream->ReadLine(x))
+			{
+				last_error = "Connection lost";
+				Close();
+				return -1;
+			}
+
+		return 0;
+	}
+
+	if (v_fields.size() >= 3 && v_fields[0] == "ERR")
+	{
+		last_error = v_fields[2];
+		int code = stoi(v_fields[1]);
+
+		return code < 0 ? code : -1;
+	}
+
+	last_error = "Wrong response: " + line;
+
+	return -1;
+}
+
+// *******************************************************************************************
+bool CAGCClient::Ping()
+{
+	vector<string> v_lines;
+
+	return request("PING", v_lines) == 0;
+}
+
+// *******************************************************************************************
+int64_t CAGCClient::GetContigLength(const string& sample_name, const string& contig_name)
+{
+	vector<string> v_lines;
+
+	int r = request("LEN\t" + sample_name + "\t" + contig_name, v_lines);
+
+	if (r < 0)
+		return r;
+	if (v_lines.size() != 1)
+		return -1;
+
+	return stoll(v_lines.front());
+}
+
+// *******************************************************************************************
+int CAGCClient::GetContigString(const string& sample_name, const string& contig_name, const int64_t start, const int64_t end, string& contig_data)
+{
+	vector<string> v_lines;
+
+	contig_data.clear();
+
+	int r = request("SEQ\t" + sample_name + "\t" + contig_name + "\t" + to_string(start) + "\t" + to_string(end), v_lines);
+
+	if (r < 0)
+		return r;
+	if (v_lines.size() != 1)
+		return -1;
+
+	contig_data = move(v_lines.front());
+
+	return 0;
+}
+
+// *******************************************************************************************
+bool CAGCClient::GetSampleSequences(const string& sample_name, vector<pair<string, string>>& v_contig_seq)
+{
+	vector<string> v_lines;
+
+	v_contig_seq.clear();
+
+	if (request("SAMPLE\t" + sample_name, v_lines) < 0 || v_lines.size() % 2 != 0)
+		return false;
+
+	for (size_t i = 0; i < v_lines.size(); i += 2)
+		v_contig_seq.emplace_back(move(v_lines[i]), move(v_lines[i + 1]));
+
+	return true;
+}
+
+// *******************************************************************************************
+bool CAGCClient::ListSamples(vector<string>& v_sample_names)
+{
+	return request("SAMPLES", v_sample_names) == 0;
+}
+
+// *******************************************************************************************
+bool CAGCClient::ListContigs(const string& sample_name, vector<string>& v_contig_names)
+{
+	return request("CONTIGS\t" + sample_name, v_contig_names) == 0;
+}
+
+// *******************************************************************************************
+bool CAGCClient::GetReferenceSample(string& ref_name)
+{
+	vector<string> v_lines;
+
+	if (request("REF", v_lines) < 0 || v_lines.size() != 1)
+		return false;
+
+	ref_name = v_lines.front();
+
+	return true;
+}
+
+// *******************************************************************************************
+bool CAGCClient::Shutdown()
+{
+	vector<string> v_lines;
+
+	return request("SHUTDOWN", v_lines) == 0;
+}
+
+// EOF
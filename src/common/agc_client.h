@@ -0,0 +1,101 @@
+#ifndef _AGC_CLIENT_H
+#define _AGC_CLIENT_H
+
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+using namespace std;
+
+// *******************************************************************************************
+// Protocol of the query server (agc serve) working over a Unix domain socket.
+// Requests are single lines with fields separated by tabs:
+//   PING
+//   REF                                  - reference sample name
+//   SAMPLES                              - list of samples
+//   CONTIGS <sample>                     - list of contigs in a sample
+//   LEN <sample> <contig>                - contig length (sample can be empty if contig name is unique)
+//   SEQ <sample> <contig> <from> <to>    - contig range (0-based, inclusive; -1 -1 for whole contig)
+//   SAMPLE <sample>                      - all contigs of a sample (header line and sequence line for each)
+//   SHUTDOWN                             - stop the server
+// Responses are "OK <no_lines>" followed by no_lines lines or "ERR <code> <message>" (code < 0, fields separated by tabs)
+// *******************************************************************************************
+
+// *******************************************************************************************
+// Buffered line-oriented I/O over a socket
+class CSocketStream
+{
+	int fd;
+	vector<char> buffer;
+	size_t buffer_pos = 0;
+	size_t buffer_filled = 0;
+
+	bool fill_buffer();
+
+public:
+	CSocketStream(const int _fd) : fd(_fd), buffer(1 << 16) {}
+
+	bool ReadLine(string& line);
+	bool Read(uint8_t* data, size_t size);
+	bool Write(const char* data, const size_t size);
+	bool Write(const string& str)
+	{
+		return Write(str.data(), str.size());
+	}
+
+	static void SplitFields(const string& line, vector<string>& v_fields);
+};
+
+// *******************************************************************************************
+// Client of the query server
+class CAGCClient
+{
+	int fd = -1;
+	unique_ptr<CSocketStream> stream;
+
+	string last_error;
+
+	int request(const string& req, vector<string>& v_lines);
+
+public:
+	CAGCClient() = default;
+	~CAGCClient();
+
+	CAGCClient(const CAGCClient&) = delete;
+	CAGCClient& operator=(const CAGCClient&) = delete;
+
+	bool Connect(const string& socket_name);
+	bool Close();
+	bool IsConnected() const
+	{
+		return fd >= 0;
+	}
+
+	const string& GetLastError() const
+	{
+		return last_error;
+	}
+
+	bool Ping();
+	int64_t GetContigLength(const string& sample_name, const string& contig_name);
+	int GetContigString(const string& sample_name, const string& contig_name, const int64_t start, const int64_t end, string& contig_data);
+	bool GetSampleSequences(const string& sample_name, vector<pair<string, string>>& v_contig_seq);
+	bool ListSamples(vector<string>& v_sample_names);
+	bool ListContigs(const string& sample_name, vector<string>& v_contig_names);
+	bool GetReferenceSample(string& ref_name);
+	bool Shutdown();
+};
+
+// EOF
+#endif
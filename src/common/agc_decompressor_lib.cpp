@@ -9,7 +9,9 @@
 // *******************************************************************************************
 
 #include "agc_decompressor_lib.h"
+#include "cpu_dispatch.h"
 #include <cassert>
+#include <cstring>
 
 // *******************************************************************************************
 CAGCDecompressorLibrary::CAGCDecompressorLibrary(bool _is_app_mode) : CAGCBasic()
@@ -51,7 +53,13 @@ bool CAGCDecompressorLibrary::IsOpened()
 // *******************************************************************************************
 int32_t CAGCDecompressorLibrary::GetNoSamples()
 {
-	return static_cast<int32_t>(collection_desc->get_no_samples());
+	return static_cast<int32_t>(collection_desc->get_no_samples() - collection_desc->get_no_removed_samples());
+}
+
+// *******************************************************************************************
+int32_t CAGCDecompressorLibrary::GetNoRemovedSamples()
+{
+	return static_cast<int32_t>(collection_desc->get_no_removed_samples());
 }
 
 // *******************************************************************************************
@@ -101,7 +109,8 @@ bool CAGCDecompressorLibrary::analyze_contig_query(const string& query, string&
 }
 
 // *******************************************************************************************
-int CAGCDecompressorLibrary::GetContigString(const string& sample_name, const string& contig_name, const int start, const int end, string& contig_data)
+// In fast mode decompressed references and packs are cached in memory (useful for series of queries)
+int CAGCDecompressorLibrary::GetContigString(const string& sample_name, const string& contig_name, const int64_t start, const int64_t end, string& contig_data, const bool fast)
 {
 	if (working_mode != working_mode_t::decompression)
 		return -1;
@@ -129,7 +138,7 @@ int CAGCDecompressorLibrary::GetContigString(const string& sample_name, const st
 	contig_task_t task{ id++, "", name_range_t(full_contig_name, start, end), contig_desc };
 	contig_t ctg;
 
-	decompress_contig(task, nullptr, ctg);
+	decompress_contig(task, nullptr, ctg, fast);
 
 	contig_data.clear();
 	contig_data.reserve(ctg.size());
@@ -156,6 +165,11 @@ int64_t CAGCDecompressorLibrary::GetContigLength(const string& sample_name, cons
 		det_sample_name = v_cand_samples.front();
 	}
 
+	contig_stats_t stats;
+
+	if (collection_desc->get_contig_stats(det_sample_name, contig_name, stats))
+		return (int64_t) stats.length;
+
 	string full_contig_name = contig_name;
 
 	if (!collection_desc->get_contig_desc(det_sample_name, full_contig_name, contig_desc))
@@ -172,7 +186,7 @@ int64_t CAGCDecompressorLibrary::GetContigLength(const string& sample_name, cons
 bool CAGCDecompressorLibrary::decompress_contig(contig_task_t& contig_desc, ZSTD_DCtx* zstd_ctx, contig_t& ctg, bool fast)
 {
 	name_range_t &contig_name_range = contig_desc.name_range;
-	vector<contig_t> v_segments_loc;
+	contig_t overlap;
 
 	bool need_free_zstd = false;
 
@@ -219,7 +233,8 @@ bool CAGCDecompressorLibrary::decompress_contig(contig_task_t& contig_desc, ZSTD
 		}
 	}
 
-	v_segments_loc.reserve(contig_desc.segments.size());
+	ctg.clear();
+	bool first_processed = false;
 
 	for (auto seg : contig_desc.segments)
 	{
@@ -234,42 +249,41 @@ bool CAGCDecompressorLibrary::decompress_contig(contig_task_t& contig_desc, ZSTD
 		else if (curr_pos > to)
 			break;
 
-		if(!fast)
-			decompress_segment(seg.group_id, seg.in_group_id, ctg, zstd_ctx);
-		else
-			decompress_segment_fast(seg.group_id, seg.in_group_id, ctg, zstd_ctx);
-
-		if (seg.is_rev_comp)
-			reverse_complement(ctg);
+		// Each segment is decoded directly at its final position in the contig (reverse-complemented on the fly if necessary).
+		// Consecutive segments overlap by kmer_length symbols, which are kept from the previous segment.
+		size_t ctg_pos = 0;
 
-		v_segments_loc.emplace_back(move(ctg));
-
-		curr_pos += seg_len - kmer_length;
-	}
-
-	if (!v_segments_loc.empty())
-	{
-		size_t req_size = 0;
-		for (uint32_t j = 0; j < v_segments_loc.size(); ++j)
-			req_size += v_segments_loc[j].size();
+		if (first_processed)
+		{
+			ctg_pos = ctg.size() > kmer_length ? ctg.size() - kmer_length : 0;
+			overlap.assign(ctg.begin() + ctg_pos, ctg.end());
+		}
 
-		ctg.clear();
-		ctg.reserve(req_size);
-		ctg.insert(ctg.end(), v_segments_loc.front().begin(), v_segments_loc.front().end());
+		if(!fast)
+			decompress_segment(seg.group_id, seg.in_group_id, ctg, zstd_ctx, ctg_pos, seg.is_rev_comp);
+		else
+			decompress_segment_fast(seg.group_id, seg.in_group_id, ctg, zstd_ctx, ctg_pos, seg.is_rev_comp);
 
-		for (uint32_t j = 1; j < v_segments_loc.size(); ++j)
-			if (v_segments_loc[j].size() < compression_params.kmer_length)
+		if (first_processed)
+		{
+			if (ctg.size() < ctg_pos + kmer_length)
 			{
 				if (is_app_mode)
 					cerr << "Corrupted archive!" << endl;
+
+				ctg.resize(ctg_pos);
+				ctg.insert(ctg.end(), overlap.begin(), overlap.end());
 			}
 			else
-			{
-				ctg.insert(ctg.end(), v_segments_loc[j].begin() + compression_params.kmer_length, v_segments_loc[j].end());
-				v_segments_loc[j].clear();
-				v_segments_loc[j].shrink_to_fit();
-			}
+				copy(overlap.begin(), overlap.end(), ctg.begin() + ctg_pos);
+		}
 
+		curr_pos += seg_len - kmer_length;
+		first_processed = true;
+	}
+
+	if (first_processed)
+	{
 		if (ctg.size() > (uint64_t)to + 1)
 			ctg.resize((uint64_t)to + 1);
 
@@ -289,7 +303,6 @@ bool CAGCDecompressorLibrary::decompress_contig(contig_task_t& contig_desc, ZSTD
 bool CAGCDecompressorLibrary::decompress_contig_streaming(contig_task_t& contig_desc, ZSTD_DCtx* zstd_ctx, CStreamWrapper& stream_wrapper, bool fast)
 {
 	name_range_t &contig_name_range = contig_desc.name_range;
-//	vector<contig_t> v_segments_loc;
 
 	bool need_free_zstd = false;
 
@@ -301,7 +314,7 @@ bool CAGCDecompressorLibrary::decompress_contig_streaming(contig_task_t& contig_
 
 	int64_t from = contig_name_range.from;
 	int64_t to = contig_name_range.to;
-	int64_t curr_pos = 0;
+	int64_t curr_pos = 0;			// position of the current segment in the contig
 
 	if (from < 0 && to < 0)
 	{
@@ -336,55 +349,45 @@ bool CAGCDecompressorLibrary::decompress_contig_streaming(contig_task_t& contig_
 		}
 	}
 
-//	v_segments_loc.reserve(contig_desc.segments.size());
 	contig_t ctg;
-	bool first_processed = false;
-
-	contig_t local_ctg;
+	bool first_segment = true;
 
 	for (auto seg : contig_desc.segments)
 	{
-		int32_t seg_len = seg.raw_length;
+		int64_t seg_len = seg.raw_length;
 
-		if (curr_pos + seg_len < from)
+		// The first kmer_length symbols of each segment (except the first one) were already sent with the previous segment
+		int64_t new_part_pos = first_segment ? curr_pos : curr_pos + kmer_length;
+		first_segment = false;
+
+		if (curr_pos + seg_len <= from)
 		{
-			from -= seg_len - kmer_length;
-			to -= seg_len - kmer_length;
+			curr_pos += seg_len - kmer_length;
 			continue;
 		}
-		else if (curr_pos > to)
+		else if (new_part_pos > to)
 			break;
 
+		// Reverse-complemented segments are decoded directly in the proper orientation
 		if(!fast)
-			decompress_segment(seg.group_id, seg.in_group_id, ctg, zstd_ctx);
+			decompress_segment(seg.group_id, seg.in_group_id, ctg, zstd_ctx, 0, seg.is_rev_comp);
 		else
-			decompress_segment_fast(seg.group_id, seg.in_group_id, ctg, zstd_ctx);
-
-		if (seg.is_rev_comp)
-			reverse_complement(ctg);
+			decompress_segment_fast(seg.group_id, seg.in_group_id, ctg, zstd_ctx, 0, seg.is_rev_comp);
 
-		if (first_processed)
+		if (new_part_pos > curr_pos && ctg.size() < kmer_length)
 		{
-			if (ctg.size() < compression_params.kmer_length)
-			{
-				if (is_app_mode)
-					cerr << "Corrupted archive!" << endl;
-			}
-			else
-				local_ctg.assign(ctg.begin() + compression_params.kmer_length, ctg.end());
-//				stream_wrapper.append(ctg.begin() + compression_params.kmer_length, ctg.end());
+			if (is_app_mode)
+				cerr << "Corrupted archive!" << endl;
+			continue;
 		}
-		else
-//			stream_wrapper.append(ctg.begin() + from, ctg.end());
-			local_ctg.assign(ctg.begin(), ctg.end());
 
-		if (local_ctg.size() > (uint64_t)to + 1)
-			local_ctg.resize((uint64_t)to + 1);
+		int64_t b_pos = max(new_part_pos, from);
+		int64_t e_pos = min(curr_pos + (int64_t)ctg.size() - 1, to) + 1;
 
-		stream_wrapper.append(local_ctg.begin() + from, local_ctg.end());
+		if (b_pos < e_pos)
+			stream_wrapper.append(ctg.begin() + (b_pos - curr_pos), ctg.begin() + (e_pos - curr_pos));
 
-		curr_pos += seg_len - kmer_length;
-		first_processed = true;
+		curr_pos += (int64_t)ctg.size() - kmer_length;
 	}
 
 	if (need_free_zstd)
@@ -395,6 +398,81 @@ bool CAGCDecompressorLibrary::decompress_contig_streaming(contig_task_t& contig_
 	return true;
 }
 
+// *******************************************************************************************
+// Lengths (and composition if stored in the archive) of all contigs in the sample
+// Return false if there is no such sample
+bool CAGCDecompressorLibrary::ListContigStats(const string& sample_name, vector<pair<string, contig_stats_t>>& v_contig_stats, bool& has_composition)
+{
+	has_composition = collection_desc->has_contig_stats();
+
+	if (has_composition)
+		return collection_desc->get_sample_stats(sample_name, v_contig_stats);
+
+	// Older archives: lengths are computed from segment descriptions
+	vector<pair<string, vector<segment_desc_t>>> sample_desc;
+
+	v_contig_stats.clear();
+
+	if (!collection_desc->get_sample_desc(sample_name, sample_desc))
+		return false;
+
+	for (auto& ctg : sample_desc)
+	{
+		uint64_t len = 0;
+		for (auto& x : ctg.second)
+			len += x.raw_length;
+
+		if (!ctg.second.empty())
+			len -= (ctg.second.size() - 1) * kmer_length;
+
+		v_contig_stats.emplace_back(ctg.first, contig_stats_t(len, 0, 0));
+	}
+
+	return true;
+}
+
+// *******************************************************************************************
+// Return false if there is no such sample or the archive contains no digests
+bool CAGCDecompressorLibrary::ListContigDigests(const string& sample_name, vector<pair<string, contig_digest_t>>& v_contig_digests)
+{
+	v_contig_digests.clear();
+
+	return collection_desc->get_sample_digests(sample_name, v_contig_digests);
+}
+
+// *******************************************************************************************
+// Sample name can be empty if contig name is unique
+bool CAGCDecompressorLibrary::GetContigDigest(const string& sample_name, const string& contig_name, contig_digest_t& digest)
+{
+	string det_sample_name = sample_name;
+
+	if (sample_name.empty())
+	{
+		auto v_cand_samples = collection_desc->get_samples_for_contig(contig_name);
+
+		if (v_cand_samples.size() != 1)
+			return false;
+
+		det_sample_name = v_cand_samples.front();
+	}
+
+	return collection_desc->get_contig_digest(det_sample_name, contig_name, digest);
+}
+
+// *******************************************************************************************
+// Find contigs of given content (MD5 or SHA512t24u digest) without decompression
+// Return false if the digest is malformed or the archive contains no digests
+bool CAGCDecompressorLibrary::FindContigsByDigest(const string& digest, vector<pair<string, string>>& v_sample_contig)
+{
+	return collection_desc->find_contigs_by_digest(digest, v_sample_contig);
+}
+
+// *******************************************************************************************
+void CAGCDecompressorLibrary::SetArchiveBackend(const archive_backend_t _archive_backend)
+{
+	archive_backend = _archive_backend;
+}
+
 // *******************************************************************************************
 bool CAGCDecompressorLibrary::Open(const string& _archive_fn, const bool _prefetch_archive)
 {
@@ -434,18 +512,22 @@ bool CAGCDecompressorLibrary::close_decompression()
 }
 
 // *******************************************************************************************
-bool CAGCDecompressorLibrary::decompress_segment(const uint32_t group_id, const uint32_t in_group_id, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
+bool CAGCDecompressorLibrary::decompress_segment(const uint32_t group_id, const uint32_t in_group_id, contig_t& ctg, ZSTD_DCtx* zstd_ctx, const size_t ctg_pos, const bool rev_comp)
 {
-	CSegment segment(ss_base(archive_version, group_id), in_archive, nullptr, compression_params.pack_cardinality, compression_params.min_match_len, false, archive_version);
+	CSegment segment(ss_base(archive_version, group_id), in_archive, nullptr, compression_params.pack_cardinality, compression_params.min_match_len, false, archive_version, seekable_packs);
+
+	auto p_layout = m_pack_layouts.find(group_id);
+	if (p_layout != m_pack_layouts.end())
+		segment.set_pack_layout(p_layout->second);
 
 	if (group_id < no_raw_groups)
-		return segment.get_raw(in_group_id, ctg, zstd_ctx);
+		return segment.get_raw(in_group_id, ctg, zstd_ctx, ctg_pos, rev_comp);
 	else
-		return segment.get(in_group_id, ctg, zstd_ctx);
+		return segment.get(in_group_id, ctg, zstd_ctx, ctg_pos, rev_comp);
 }
 
 // *******************************************************************************************
-bool CAGCDecompressorLibrary::decompress_segment_fast(const uint32_t group_id, const uint32_t in_group_id, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
+bool CAGCDecompressorLibrary::decompress_segment_fast(const uint32_t group_id, const uint32_t in_group_id, contig_t& ctg, ZSTD_DCtx* zstd_ctx, const size_t ctg_pos, const bool rev_comp)
 {
 	shared_ptr<CSegment> segment;
 
@@ -468,15 +550,20 @@ bool CAGCDecompressorLibrary::decompress_segment_fast(const uint32_t group_id, c
 			segment = p->second;
 		else
 		{
-			segment = make_shared<CSegment>(ss_base(archive_version, group_id), in_archive, nullptr, compression_params.pack_cardinality, compression_params.min_match_len, false, archive_version, true);
+			segment = make_shared<CSegment>(ss_base(archive_version, group_id), in_archive, nullptr, compression_params.pack_cardinality, compression_params.min_match_len, false, archive_version, seekable_packs, true);
+
+			auto p_layout = m_pack_layouts.find(group_id);
+			if (p_layout != m_pack_layouts.end())
+				segment->set_pack_layout(p_layout->second);
+
 			v_segment[group_id] = segment;
 		}
 	}
 
 	if (group_id < no_raw_groups)
-		return segment->get_raw_locked(in_group_id, ctg, zstd_ctx);
+		return segment->get_raw_locked(in_group_id, ctg, zstd_ctx, ctg_pos, rev_comp);
 	else
-		return segment->get_locked(in_group_id, ctg, zstd_ctx);
+		return segment->get_locked(in_group_id, ctg, zstd_ctx, ctg_pos, rev_comp);
 }
 
 // *******************************************************************************************
@@ -531,31 +618,7 @@ bool CAGCDecompressorLibrary::Close()
 // *******************************************************************************************
 void CAGCDecompressorLibrary::CNumAlphaConverter::convert_to_alpha(contig_t& ctg)
 {
-	size_t size = ctg.size();
-	size_t i = size % 8;
-
-	switch (i)
-	{
-	case 7: ctg[6] = cnv_num[ctg[6]];
-	case 6: ctg[5] = cnv_num[ctg[5]];
-	case 5: ctg[4] = cnv_num[ctg[4]];
-	case 4: ctg[3] = cnv_num[ctg[3]];
-	case 3: ctg[2] = cnv_num[ctg[2]];
-	case 2: ctg[1] = cnv_num[ctg[1]];
-	case 1: ctg[0] = cnv_num[ctg[0]];
-	}
-
-	for (; i < size; i += 8)
-	{
-		ctg[i] = cnv_num[ctg[i]];
-		ctg[i + 1] = cnv_num[ctg[i + 1]];
-		ctg[i + 2] = cnv_num[ctg[i + 2]];
-		ctg[i + 3] = cnv_num[ctg[i + 3]];
-		ctg[i + 4] = cnv_num[ctg[i + 4]];
-		ctg[i + 5] = cnv_num[ctg[i + 5]];
-		ctg[i + 6] = cnv_num[ctg[i + 6]];
-		ctg[i + 7] = cnv_num[ctg[i + 7]];
-	}
+	CCpuDispatch::Instance().num_to_alpha(ctg.data(), ctg.data(), ctg.size(), cnv_num);
 }
 
 // *******************************************************************************************
@@ -564,6 +627,9 @@ size_t CAGCDecompressorLibrary::CNumAlphaConverter::convert_and_split_into_lines
 	if (ctg.empty())
 		return 0;
 
+	// Symbols are converted at once (vector kernel), so lines are only copied
+	convert_to_alpha(ctg);
+
 	size_t dest_size = ctg.size() + (ctg.size() + line_len - 1) / line_len + 2;
 	working_space.resize(dest_size);
 
@@ -576,7 +642,7 @@ size_t CAGCDecompressorLibrary::CNumAlphaConverter::convert_and_split_into_lines
 	{
 		while (to_save && no_symbols_in_non_complete_line++ < line_len)
 		{
-			*q++ = cnv_num[*p++];
+			*q++ = *p++;
 			to_save--;
 		}
 		*q++ = '\n';
@@ -596,30 +662,9 @@ size_t CAGCDecompressorLibrary::CNumAlphaConverter::convert_and_split_into_lines
 
 	for (; to_save > line_len; to_save -= line_len)
 	{
-		uint32_t i;
-
-		switch (i = line_len % 8)
-		{
-		case 7:	*q++ = cnv_num[*p++]; [[fallthrough]];
-		case 6:	*q++ = cnv_num[*p++]; [[fallthrough]];
-		case 5:	*q++ = cnv_num[*p++]; [[fallthrough]];
-		case 4:	*q++ = cnv_num[*p++]; [[fallthrough]];
-		case 3:	*q++ = cnv_num[*p++]; [[fallthrough]];
-		case 2:	*q++ = cnv_num[*p++]; [[fallthrough]];
-		case 1:	*q++ = cnv_num[*p++];
-		}
-
-		for (; i < line_len; i += 8)
-		{
-			*q++ = cnv_num[*p++];
-			*q++ = cnv_num[*p++];
-			*q++ = cnv_num[*p++];
-			*q++ = cnv_num[*p++];
-			*q++ = cnv_num[*p++];
-			*q++ = cnv_num[*p++];
-			*q++ = cnv_num[*p++];
-			*q++ = cnv_num[*p++];
-		}
+		memcpy(q, p, line_len);
+		p += line_len;
+		q += line_len;
 
 		*q++ = '\n';
 	}
@@ -629,7 +674,7 @@ size_t CAGCDecompressorLibrary::CNumAlphaConverter::convert_and_split_into_lines
 	if (to_save)
 	{
 		while (to_save--)
-			*q++ = cnv_num[*p++];
+			*q++ = *p++;
 		*q++ = '\n';
 	}
 
@@ -168,8 +168,8 @@ protected:
 	map<uint32_t, shared_ptr<CSegment>> v_segment;
 
 	bool analyze_contig_query(const string& query, string& sample, name_range_t& name_range);
-	bool decompress_segment(const uint32_t group_id, const uint32_t in_group_id, contig_t& ctg, ZSTD_DCtx* zstd_ctx);
-	bool decompress_segment_fast(const uint32_t group_id, const uint32_t in_group_id, contig_t& ctg, ZSTD_DCtx* zstd_ctx);
+	bool decompress_segment(const uint32_t group_id, const uint32_t in_group_id, contig_t& ctg, ZSTD_DCtx* zstd_ctx, const size_t ctg_pos = 0, const bool rev_comp = false);
+	bool decompress_segment_fast(const uint32_t group_id, const uint32_t in_group_id, contig_t& ctg, ZSTD_DCtx* zstd_ctx, const size_t ctg_pos = 0, const bool rev_comp = false);
 
 	bool decompress_contig(contig_task_t& task, ZSTD_DCtx *zstd_ctx, contig_t& ctg, bool fast = false);
 	bool decompress_contig_streaming(contig_task_t& task, ZSTD_DCtx *zstd_ctx, CStreamWrapper& stream_wrapper, bool fast = false);
@@ -182,18 +182,26 @@ public:
 
 	bool Open(const string& _archive_fn, const bool _prefetch_archive = false);
 
+	// Must be called before Open()
+	void SetArchiveBackend(const archive_backend_t _archive_backend);
+
 	void GetCmdLines(vector<pair<string, string>>& _cmd_lines);
 	void GetParams(uint32_t& kmer_length, uint32_t& min_match_len, uint32_t& pack_cardinality, uint32_t& _segment_size);
 	void GetReferenceSample(string& ref_name);
 
 	bool Close();
 
-	int GetContigString(const string& sample_name, const string& contig_name, const int start, const int end, string& contig_data);
+	int GetContigString(const string& sample_name, const string& contig_name, const int64_t start, const int64_t end, string& contig_data, const bool fast = false);
 	int64_t GetContigLength(const string& sample_name, const string& contig_name);
+	bool ListContigStats(const string& sample_name, vector<pair<string, contig_stats_t>>& v_contig_stats, bool& has_composition);
+	bool ListContigDigests(const string& sample_name, vector<pair<string, contig_digest_t>>& v_contig_digests);
+	bool GetContigDigest(const string& sample_name, const string& contig_name, contig_digest_t& digest);
+	bool FindContigsByDigest(const string& digest, vector<pair<string, string>>& v_sample_contig);
 
 	bool ListSamples(vector<string>& v_sample_names);
 	bool ListContigs(const string& sample_name, vector<string>& v_contig_names);
 	int32_t GetNoSamples();
+	int32_t GetNoRemovedSamples();
 	int32_t GetNoContigs(const string& sample_name);
 
 	void GetFileTypeInfo(map<string, string>& _m_file_type_info);
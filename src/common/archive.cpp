@@ -10,6 +10,7 @@
 
 #include "archive.h"
 #include "defs.h"
+#include "digest.h"
 
 #include <iostream>
 #include <algorithm>
@@ -23,9 +24,17 @@
 #endif
 
 // *******************************************************************************************
-CArchive::CArchive(const bool _input_mode, const size_t _io_buffer_size, const string& _lazy_prefix)
+// Metadata of empty parts is not read back, so it is not covered by the checksum
+static uint64_t part_checksum(const vector<uint8_t>& v_data, const uint64_t metadata)
+{
+	return xxh64(v_data.data(), v_data.size(), v_data.empty() ? 0 : metadata);
+}
+
+// *******************************************************************************************
+CArchive::CArchive(const bool _input_mode, const size_t _io_buffer_size, const string& _lazy_prefix, const archive_backend_t _backend)
 {
 	input_mode = _input_mode;
+	backend = _backend;
 	io_buffer_size = _io_buffer_size;
 
 	if(input_mode)			// Ignore lazy_prefix in output mode
@@ -43,37 +52,87 @@ bool CArchive::Open(const string &file_name)
 {
 	lock_guard<mutex> lck(mtx);
 
-	if (f_in.IsOpened())
-		f_in.Close();
+	if (f_in && f_in->IsOpened())
+		f_in->Close();
 	if (f_out.IsOpened())
 		f_out.Close();
 
 	if (input_mode)
-		f_in.Open(file_name, io_buffer_size);
+	{
+		f_in = CArchiveInput::Create(file_name, backend);
+		f_in->Open(file_name, io_buffer_size);
+	}
 	else
 		f_out.Open(file_name);
 
-	if (!f_in.IsOpened() && !f_out.IsOpened())
+	if (!(f_in && f_in->IsOpened()) && !f_out.IsOpened())
 		return false;
 
-	if (input_mode)
-		deserialize();
+	if (input_mode && !deserialize())
+	{
+		cerr << "Corrupted archive footer: " << file_name << endl;
+		f_in->Close();
+		return false;
+	}
 
 	f_offset = 0;
 
 	return true;
 }
 
+// *******************************************************************************************
+bool CArchive::OpenForUpdate(const string& file_name)
+{
+	lock_guard<mutex> lck(mtx);
+
+	if (input_mode || f_out.IsOpened())
+		return false;
+
+	f_in = CArchiveInput::Create(file_name, archive_backend_t::file);
+
+	if (!f_in->Open(file_name, io_buffer_size))
+		return false;
+
+	if (!deserialize())
+	{
+		cerr << "Corrupted archive footer: " << file_name << endl;
+		f_in->Close();
+		return false;
+	}
+
+	f_offset = f_in->FileSize();
+
+	for (auto& stream : v_streams)
+		stream.checksums.clear();
+
+	// Checksums are continued (the table of the new footer covers the parts of the existing archive as well)
+	int checksums_stream_id = get_stream_id(checksums_stream_name);
+	bool checksums_loaded = checksums_stream_id >= 0 && load_part_checksums();
+
+	f_in->Close();
+	f_in.reset();
+
+	if (checksums_stream_id >= 0 && !checksums_loaded)
+	{
+		cerr << "Corrupted table of part checksums: " << file_name << endl;
+		return false;
+	}
+
+	part_checksums = checksums_loaded;
+
+	return f_out.Open(file_name, 8 << 20, true);
+}
+
 // *******************************************************************************************
 bool CArchive::Close()
 {
 	lock_guard<mutex> lck(mtx);
 
-	if (!f_in.IsOpened() && !f_out.IsOpened())
+	if (!(f_in && f_in->IsOpened()) && !f_out.IsOpened())
 		return false;
 
 	if (input_mode)
-		f_in.Close();
+		f_in->Close();
 	else
 	{
 		flush_out_buffers();
@@ -125,7 +184,7 @@ size_t CArchive::read(string& s)
 
 	while (true)
 	{
-		int c = f_in.Get();
+		int c = f_in->Get();
 		if (c == EOF)
 			return 0;
 
@@ -143,6 +202,9 @@ bool CArchive::serialize()
 {
 	size_t footer_size = 0;
 
+	if (part_checksums)
+		store_part_checksums();
+
 	// Store stram part offsets
 	footer_size += write(v_streams.size());
 
@@ -163,7 +225,7 @@ bool CArchive::serialize()
 		stream.packed_size += footer_size - p;
 	}
 
-	write_fixed(footer_size);
+	f_offset += footer_size + write_fixed(footer_size);
 
 	return true;
 }
@@ -172,17 +234,27 @@ bool CArchive::serialize()
 bool CArchive::deserialize()
 {
 	size_t footer_size;
-	size_t file_size = f_in.FileSize();
+	size_t file_size = f_in->FileSize();
+
+	if (file_size < 8)
+		return false;
 
-	f_in.Seek(file_size - 8ull);
+	f_in->Seek(file_size - 8ull);
 	read_fixed(footer_size);
 
-	f_in.Seek(file_size -(size_t)(8 + footer_size));
+	if (footer_size > file_size - 8)
+		return false;
+
+	footer_offset = file_size - (size_t)(8 + footer_size);
+	f_in->Seek(footer_offset);
 
-	// Read stream part offsets
+	// Read stream part offsets (each item of the footer takes at least 1 byte)
 	size_t n_streams;
 	read(n_streams);
 
+	if (n_streams > footer_size)
+		return false;
+
 	v_streams.resize(n_streams, stream_t());
 
 	rm_streams.reserve(2 * n_streams);
@@ -195,6 +267,9 @@ bool CArchive::deserialize()
 		read(stream_second.cur_id);
 		read(stream_second.raw_size);
 
+		if (stream_second.cur_id > footer_size)
+			return false;
+
 		stream_second.parts.resize(stream_second.cur_id);
 		for (size_t j = 0; j < stream_second.cur_id; ++j)
 		{
@@ -208,11 +283,71 @@ bool CArchive::deserialize()
 			rm_streams[stream_second.stream_name] = i;
 	}
 	
-	f_in.Seek(0);
+	f_in->Seek(0);
+
+	return true;
+}
+
+// *******************************************************************************************
+bool CArchive::BeginCheckpoint()
+{
+	lock_guard<mutex> lck(mtx);
+
+	if (input_mode || !f_out.IsOpened() || checkpoint_started)
+		return false;
+
+	flush_out_buffers();
+
+	v_checkpoint_marks.clear();
+	v_checkpoint_marks.reserve(v_streams.size());
+
+	for (auto& stream : v_streams)
+		v_checkpoint_marks.push_back(stream_mark_t{ stream.parts.size(), stream.raw_size, stream.packed_size, stream.packed_data_size });
+
+	checkpoint_started = true;
 
 	return true;
 }
 
+// *******************************************************************************************
+bool CArchive::EndCheckpoint(size_t& file_size)
+{
+	lock_guard<mutex> lck(mtx);
+
+	if (!checkpoint_started)
+		return false;
+
+	flush_out_buffers();
+	serialize();
+
+	bool r = f_out.Flush();
+	file_size = f_offset;
+
+	// Streams registered during checkpoint are removed
+	for (size_t i = v_checkpoint_marks.size(); i < v_streams.size(); ++i)
+		rm_streams.erase(v_streams[i].stream_name);
+
+	v_streams.resize(v_checkpoint_marks.size());
+
+	for (size_t i = 0; i < v_streams.size(); ++i)
+	{
+		auto& stream = v_streams[i];
+		auto& mark = v_checkpoint_marks[i];
+
+		stream.parts.resize(mark.no_parts);
+		if (part_checksums)
+			stream.checksums.resize(mark.no_parts);
+		stream.raw_size = mark.raw_size;
+		stream.packed_size = mark.packed_size;
+		stream.packed_data_size = mark.packed_data_size;
+	}
+
+	v_checkpoint_marks.clear();
+	checkpoint_started = false;
+
+	return r;
+}
+
 // *******************************************************************************************
 int CArchive::register_stream(const string& stream_name)
 {
@@ -281,6 +416,9 @@ bool CArchive::add_part(const int stream_id, const vector<uint8_t>& v_data, cons
 {
 	v_streams[stream_id].parts.push_back(part_t(f_offset, v_data.size()));
 
+	if (part_checksums)
+		v_streams[stream_id].checksums.push_back(part_checksum(v_data, metadata));
+
 	f_offset += write(metadata);
 	f_out.Write(v_data.data(), v_data.size());
 
@@ -307,16 +445,25 @@ int CArchive::AddPartPrepare(const int stream_id)
 	
 	v_streams[stream_id].parts.push_back(part_t(0, 0));
 
+	if (part_checksums)
+		v_streams[stream_id].checksums.push_back(0);
+
 	return static_cast<int>(v_streams[stream_id].parts.size()) - 1;
 }
 
 // *******************************************************************************************
 bool CArchive::AddPartComplete(const int stream_id, const int part_id, const vector<uint8_t>& v_data, const uint64_t metadata)
 {
+	// Checksum is computed before locking, so parts of many threads can be processed in parallel
+	uint64_t checksum = part_checksums ? part_checksum(v_data, metadata) : 0;
+
 	lock_guard<mutex> lck(mtx);
 	
 	v_streams[stream_id].parts[part_id] = part_t(f_offset, v_data.size());
 
+	if (part_checksums)
+		v_streams[stream_id].checksums[part_id] = checksum;
+
 	f_offset += write(metadata);
 	f_out.Write(v_data.data(), v_data.size());
 
@@ -384,7 +531,7 @@ bool CArchive::get_part(const int stream_id, vector<uint8_t>& v_data, uint64_t&
 
 	v_data.resize(p.parts[p.cur_id].size);
 
-	f_in.Seek(p.parts[p.cur_id].offset);
+	f_in->Seek(p.parts[p.cur_id].offset);
 
 	if (p.parts[p.cur_id].size != 0)
 		read(metadata);
@@ -395,7 +542,7 @@ bool CArchive::get_part(const int stream_id, vector<uint8_t>& v_data, uint64_t&
 		return true;
 	}
 
-	f_in.Read(v_data.data(), p.parts[p.cur_id].size);
+	f_in->Read(v_data.data(), p.parts[p.cur_id].size);
 
 	p.cur_id++;
 
@@ -455,7 +602,7 @@ bool CArchive::get_part(const int stream_id, const int part_id, vector<uint8_t>&
 
 	v_data.resize(p.parts[part_id].size);
 
-	f_in.Seek(p.parts[part_id].offset);
+	f_in->Seek(p.parts[part_id].offset);
 
 	if (p.parts[part_id].size != 0)
 		read(metadata);
@@ -465,7 +612,7 @@ bool CArchive::get_part(const int stream_id, const int part_id, vector<uint8_t>&
 		return true;
 	}
 
-	f_in.Read(v_data.data(), p.parts[part_id].size);
+	f_in->Read(v_data.data(), p.parts[part_id].size);
 
 	return true;
 }
@@ -554,4 +701,242 @@ size_t CArchive::GetStreamPackedDataSize(const int stream_id)
 	return v_streams[stream_id].packed_data_size;
 }
 
+// *******************************************************************************************
+// Hint for the OS that the parts will be read soon; parts placed close to each other are coalesced into single requests
+// Return no. of bytes requested
+size_t CArchive::Readahead(const vector<pair<string, int>>& v_stream_parts)
+{
+	lock_guard<mutex> lck(mtx);
+
+	if (!input_mode || !f_in)
+		return 0;
+
+	vector<pair<size_t, size_t>> v_ranges;
+
+	for (const auto& sp : v_stream_parts)
+	{
+		int stream_id = get_stream_id(sp.first);
+
+		if (stream_id < 0 || sp.second < 0 || (size_t)sp.second >= v_streams[stream_id].parts.size())
+			continue;
+
+		auto& part = v_streams[stream_id].parts[sp.second];
+
+		if (part.size)
+			v_ranges.emplace_back(part.offset, part.offset + part.size + 9);		// metadata (up to 9 bytes) precedes the data
+	}
+
+	if (v_ranges.empty())
+		return 0;
+
+	sort(v_ranges.begin(), v_ranges.end());
+
+	const size_t max_gap = 64 << 10;
+	size_t total = 0;
+	auto cur = v_ranges.front();
+
+	for (size_t i = 1; i <= v_ranges.size(); ++i)
+	{
+		if (i < v_ranges.size() && v_ranges[i].first <= cur.second + max_gap)
+		{
+			cur.second = max(cur.second, v_ranges[i].second);
+			continue;
+		}
+
+		if (f_in->Advise(cur.first, cur.second - cur.first))
+			total += cur.second - cur.first;
+
+		if (i < v_ranges.size())
+			cur = v_ranges[i];
+	}
+
+	return total;
+}
+
+// *******************************************************************************************
+// Checksums of all parts (of all streams registered so far) are stored as a single part just before the footer
+void CArchive::store_part_checksums()
+{
+	vector<uint8_t> v_data;
+
+	auto append64 = [&](uint64_t x) {
+		for (int i = 0; i < 8; ++i)
+			v_data.emplace_back((uint8_t)(x >> (8 * i)));
+	};
+
+	append64(v_streams.size());
+
+	for (auto& stream : v_streams)
+	{
+		append64(stream.checksums.size());
+
+		for (auto x : stream.checksums)
+			append64(x);
+	}
+
+	int stream_id = register_stream(checksums_stream_name);
+	add_part(stream_id, v_data, 0);
+}
+
+// *******************************************************************************************
+void CArchive::SetPartChecksums(const bool _part_checksums)
+{
+	lock_guard<mutex> lck(mtx);
+
+	if (input_mode)
+		return;
+
+	part_checksums = _part_checksums;
+
+	// Parts added before the call get no checksum, so the table would be incomplete
+	for (auto& stream : v_streams)
+		stream.checksums.resize(stream.parts.size(), 0);
+}
+
+// *******************************************************************************************
+bool CArchive::HasPartChecksums()
+{
+	lock_guard<mutex> lck(mtx);
+
+	return part_checksums || (input_mode && get_stream_id(checksums_stream_name) >= 0);
+}
+
+// *******************************************************************************************
+// Return false if the archive contains no (or inconsistent) checksums
+bool CArchive::LoadPartChecksums()
+{
+	lock_guard<mutex> lck(mtx);
+
+	return load_part_checksums();
+}
+
+// *******************************************************************************************
+// Table is the last part of the checksums stream (archives updated in place contain more tables)
+bool CArchive::load_part_checksums()
+{
+	int stream_id = get_stream_id(checksums_stream_name);
+
+	if (stream_id < 0 || v_streams[stream_id].parts.empty())
+		return false;
+
+	vector<uint8_t> v_data;
+	uint64_t metadata;
+
+	if (!get_part(stream_id, (int) v_streams[stream_id].parts.size() - 1, v_data, metadata))
+		return false;
+
+	size_t pos = 0;
+
+	auto read64 = [&](uint64_t& x) {
+		if (pos + 8 > v_data.size())
+			return false;
+
+		x = 0;
+		for (int i = 7; i >= 0; --i)
+			x = (x << 8) + v_data[pos + i];
+		pos += 8;
+
+		return true;
+	};
+
+	uint64_t no_streams;
+
+	if (!read64(no_streams) || no_streams > v_streams.size())
+		return false;
+
+	for (size_t i = 0; i < no_streams; ++i)
+	{
+		uint64_t no_parts;
+
+		// Parts of the checksums stream itself (tables of previous updates) have no checksums
+		if (!read64(no_parts) || no_parts > v_streams[i].parts.size() || (no_parts != v_streams[i].parts.size() && (int) i != stream_id))
+			return false;
+
+		v_streams[i].checksums.resize(no_parts);
+
+		for (auto& x : v_streams[i].checksums)
+			if (!read64(x))
+				return false;
+	}
+
+	part_checksums = true;
+
+	return true;
+}
+
+// *******************************************************************************************
+// Check that all parts lie within the data area (before the footer) and do not overlap
+bool CArchive::VerifyLayout(vector<string>& v_issues)
+{
+	lock_guard<mutex> lck(mtx);
+
+	if (!input_mode || !f_in)
+		return false;
+
+	vector<tuple<size_t, size_t, size_t>> v_ranges;		// begin, end, stream id
+	bool ok = true;
+
+	for (size_t i = 0; i < v_streams.size(); ++i)
+		for (size_t j = 0; j < v_streams[i].parts.size(); ++j)
+		{
+			auto& part = v_streams[i].parts[j];
+
+			// metadata takes at least 1 byte
+			if (part.offset > footer_offset || part.size + 1 > footer_offset - part.offset)
+			{
+				v_issues.emplace_back("Part " + to_string(j) + " of stream " + v_streams[i].stream_name + " lies outside the data area (offset: "
+					+ to_string(part.offset) + ", size: " + to_string(part.size) + ")");
+				ok = false;
+			}
+			else if (part.size)
+				v_ranges.emplace_back(part.offset, part.offset + part.size + 1, i);
+		}
+
+	sort(v_ranges.begin(), v_ranges.end());
+
+	for (size_t i = 1; i < v_ranges.size(); ++i)
+		if (get<0>(v_ranges[i]) < get<1>(v_ranges[i - 1]))
+		{
+			v_issues.emplace_back("Parts of streams " + v_streams[get<2>(v_ranges[i - 1])].stream_name + " and " + v_streams[get<2>(v_ranges[i])].stream_name
+				+ " overlap at offset " + to_string(get<0>(v_ranges[i])));
+			ok = false;
+		}
+
+	return ok;
+}
+
+// *******************************************************************************************
+// Return 1 if part matches its checksum, 0 if it does not (or cannot be read), -1 if there is no checksum
+int CArchive::VerifyPart(const int stream_id, const int part_id)
+{
+	vector<uint8_t> v_data;
+	uint64_t metadata;
+	uint64_t checksum;
+
+	{
+		lock_guard<mutex> lck(mtx);
+
+		if (stream_id < 0 || (size_t)stream_id >= v_streams.size() || part_id < 0 || (size_t)part_id >= v_streams[stream_id].checksums.size())
+			return -1;
+
+		checksum = v_streams[stream_id].checksums[part_id];
+
+		if (!get_part(stream_id, part_id, v_data, metadata))
+			return 0;
+	}
+
+	return part_checksum(v_data, metadata) == checksum ? 1 : 0;
+}
+
+// *******************************************************************************************
+string CArchive::GetStreamName(const int stream_id)
+{
+	lock_guard<mutex> lck(mtx);
+
+	if (stream_id < 0 || (size_t)stream_id >= v_streams.size())
+		return "";
+
+	return v_streams[stream_id].stream_name;
+}
+
 // EOF
@@ -20,6 +20,7 @@
 #include <thread>
 #include <mutex>
 #include "../common/io.h"
+#include "../common/archive_input.h"
 #include "../common/utils.h"
 
 using namespace std;
@@ -27,7 +28,8 @@ using namespace std;
 class CArchive
 {
 	bool input_mode;
-	CInFile f_in;
+	archive_backend_t backend;
+	unique_ptr<CArchiveInput> f_in;
 	COutFile f_out;
 	size_t io_buffer_size;
 
@@ -51,6 +53,7 @@ class CArchive
 		size_t packed_size;
 		size_t packed_data_size;
 		vector<part_t> parts;
+		vector<uint64_t> checksums;
 	} stream_t;
 
 	map<int, vector<pair<vector<uint8_t>, uint64_t>>> m_buffer;
@@ -61,8 +64,26 @@ class CArchive
 
 	mutex mtx;
 
+	// Per-part checksums (XXH64 of data seeded with metadata) stored as a single part of a separate stream
+	const string checksums_stream_name = "archive-checksums";
+	bool part_checksums = false;
+	size_t footer_offset = 0;
+
+	// State of streams at the beginning of checkpoint
+	struct stream_mark_t {
+		size_t no_parts;
+		size_t raw_size;
+		size_t packed_size;
+		size_t packed_data_size;
+	};
+
+	vector<stream_mark_t> v_checkpoint_marks;
+	bool checkpoint_started = false;
+
 	bool serialize();
 	bool deserialize();
+	void store_part_checksums();
+	bool load_part_checksums();
 
 	// *******************************************************************************************
 	inline bool is_lazy_str(const string& str)
@@ -131,7 +152,7 @@ class CArchive
 	template<typename T>
 	size_t read_fixed(T& x)
 	{
-		x = static_cast<T>(f_in.ReadUInt(8));
+		x = static_cast<T>(f_in->ReadUInt(8));
 
 		return 8;
 	}
@@ -143,14 +164,14 @@ class CArchive
 	template<typename T>
 	size_t read(T& x)
 	{
-		int no_bytes = f_in.Get();
+		int no_bytes = f_in->Get();
 
 		x = 0;
 
 		for (int i = 0; i < no_bytes; ++i)
 		{
 			x <<= 8;
-			x += static_cast<T>(f_in.Get());
+			x += static_cast<T>(f_in->Get());
 		}
 
 		return no_bytes + 1;
@@ -165,12 +186,21 @@ class CArchive
 	int register_stream(const string& stream_name);
 
 public:
-	CArchive(const bool _input_mode, const size_t _io_buffer_size = 64 << 20, const string& _lazy_prefix = "");
+	CArchive(const bool _input_mode, const size_t _io_buffer_size = 64 << 20, const string& _lazy_prefix = "", const archive_backend_t _backend = archive_backend_t::automatic);
 	~CArchive();
 
 	bool Open(const string &file_name);
+
+	// Existing archive (output mode only): new streams and parts are written after its end, followed by the new footer.
+	// Space of the old footer is not reclaimed
+	bool OpenForUpdate(const string& file_name);
 	bool Close();
 
+	// Checkpoint (output mode only): parts added after BeginCheckpoint() are written to the file followed by the footer,
+	// so the file of size file_size is a complete archive. Then the parts are forgotten and the archive is extended as usual
+	bool BeginCheckpoint();
+	bool EndCheckpoint(size_t& file_size);
+
 	int RegisterStream(const string &stream_name);
 	pair<int, int> RegisterStreams(const string &stream_name1, const string& stream_name2);
 	int GetStreamId(const string &stream_name);
@@ -203,6 +233,17 @@ public:
 
 	size_t GetNoStreams();
 	size_t GetNoParts(const int stream_id);
+
+	size_t Readahead(const vector<pair<string, int>>& v_stream_parts);
+
+	// Integrity checking
+	// In output mode checksums are computed for parts added after the call
+	void SetPartChecksums(const bool _part_checksums);
+	bool HasPartChecksums();
+	bool LoadPartChecksums();
+	bool VerifyLayout(vector<string>& v_issues);
+	int VerifyPart(const int stream_id, const int part_id);
+	string GetStreamName(const int stream_id);
 };
 
 // EOF
@@ -0,0 +1,572 @@
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include "archive_input.h"
+#include "agc_client.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+
+// *******************************************************************************************
+bool CArchiveInput::IsRemote(const string& file_name)
+{
+	return file_name.compare(0, 7, "http://") == 0 || file_name.compare(0, 8, "https://") == 0;
+}
+
+// *******************************************************************************************
+unique_ptr<CArchiveInput> CArchiveInput::Create(const string& file_name, const archive_backend_t backend)
+{
+	switch (backend)
+	{
+	case archive_backend_t::file:
+		return make_unique<CFileArchiveInput>();
+	case archive_backend_t::mmap:
+		return make_unique<CMmapArchiveInput>();
+	case archive_backend_t::http:
+		return make_unique<CHttpArchiveInput>();
+	default:
+		if (IsRemote(file_name))
+			return make_unique<CHttpArchiveInput>();
+		return make_unique<CFileArchiveInput>();
+	}
+}
+
+// *******************************************************************************************
+// CMmapArchiveInput
+// *******************************************************************************************
+
+// *******************************************************************************************
+CMmapArchiveInput::~CMmapArchiveInput()
+{
+	Close();
+}
+
+// *******************************************************************************************
+bool CMmapArchiveInput::Open(const string& file_name, const size_t _BUFFER_SIZE)
+{
+#ifndef _WIN32
+	if (data)
+		return false;
+
+	fd = open(file_name.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		fd = -1;
+		return false;
+	}
+
+	file_size = (size_t)st.st_size;
+
+	void* p = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED)
+	{
+		close(fd);
+		fd = -1;
+		return false;
+	}
+
+	data = (uint8_t*)p;
+	pos = 0;
+
+	madvise(data, file_size, _BUFFER_SIZE == ~0ull ? MADV_WILLNEED : MADV_RANDOM);
+
+	return true;
+#else
+	cerr << "Memory-mapped archives are not supported on this platform\n";
+	return false;
+#endif
+}
+
+// *******************************************************************************************
+bool CMmapArchiveInput::Close()
+{
+#ifndef _WIN32
+	if (!data)
+		return false;
+
+	munmap(data, file_size);
+	close(fd);
+
+	data = nullptr;
+	fd = -1;
+	file_size = 0;
+#endif
+
+	return true;
+}
+
+// *******************************************************************************************
+bool CMmapArchiveInput::Advise(const size_t offset, const size_t size)
+{
+#ifndef _WIN32
+	if (!data || offset >= file_size)
+		return false;
+
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	size_t begin = offset / page_size * page_size;
+	size_t end = min(offset + size, file_size);
+
+	return madvise(data + begin, end - begin, MADV_WILLNEED) == 0;
+#else
+	return false;
+#endif
+}
+
+// *******************************************************************************************
+// CHttpArchiveInput
+// *******************************************************************************************
+
+// *******************************************************************************************
+CHttpArchiveInput::~CHttpArchiveInput()
+{
+	Close();
+}
+
+// *******************************************************************************************
+// http://host[:port]/path
+bool CHttpArchiveInput::parse_url(const string& url)
+{
+	if (url.compare(0, 8, "https://") == 0)
+	{
+		cerr << "HTTPS is not supported (no TLS library), use http:// or a local proxy: " << url << endl;
+		return false;
+	}
+
+	if (url.compare(0, 7, "http://") != 0)
+		return false;
+
+	size_t host_begin = 7;
+	size_t path_begin = url.find('/', host_begin);
+
+	string authority = url.substr(host_begin, path_begin == string::npos ? string::npos : path_begin - host_begin);
+	path = path_begin == string::npos ? "/" : url.substr(path_begin);
+
+	size_t colon = authority.rfind(':');
+
+	if (colon != string::npos && authority.find(']', colon) == string::npos)
+	{
+		host = authority.substr(0, colon);
+		port = authority.substr(colon + 1);
+	}
+	else
+	{
+		host = authority;
+		port = "80";
+	}
+
+	if (!host.empty() && host.front() == '[' && host.back() == ']')
+		host = host.substr(1, host.size() - 2);
+
+	return !host.empty() && !port.empty();
+}
+
+// *******************************************************************************************
+bool CHttpArchiveInput::connect_server()
+{
+#ifndef _WIN32
+	if (fd >= 0)
+		return true;
+
+	addrinfo hints;
+	addrinfo* res = nullptr;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0)
+	{
+		cerr << "Cannot resolve host: " << host << endl;
+		return false;
+	}
+
+	for (auto p = res; p; p = p->ai_next)
+	{
+		fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+		if (fd < 0)
+			continue;
+
+		if (connect(fd, p->ai_addr, p->ai_addrlen) == 0)
+			break;
+
+		close(fd);
+		fd = -1;
+	}
+
+	freeaddrinfo(res);
+
+	if (fd < 0)
+	{
+		cerr << "Cannot connect to: " << host << ":" << port << endl;
+		return false;
+	}
+
+	stream = make_unique<CSocketStream>(fd);
+
+	return true;
+#else
+	cerr << "HTTP archives are not supported on this platform\n";
+	return false;
+#endif
+}
+
+// *******************************************************************************************
+void CHttpArchiveInput::disconnect_server()
+{
+#ifndef _WIN32
+	stream.reset();
+
+	if (fd >= 0)
+		close(fd);
+	fd = -1;
+#endif
+}
+
+// *******************************************************************************************
+// Get bytes [from, to] of the file; total_size is the file size reported by the server
+bool CHttpArchiveInput::request_range(const size_t from, const size_t to, vector<uint8_t>& v_data, size_t& total_size)
+{
+	string req = "GET " + path + " HTTP/1.1\r\n"
+		"Host: " + host + (port == "80" ? "" : ":" + port) + "\r\n"
+		"Range: bytes=" + to_string(from) + "-" + to_string(to) + "\r\n"
+		"Connection: keep-alive\r\n\r\n";
+
+	// The server could close idle keep-alive connection, so the request is repeated once over a new one
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		if (!connect_server())
+			return false;
+
+		string line;
+		int status = 0;
+		bool has_length = false;
+		bool keep_alive = true;
+		size_t content_length = 0;
+		size_t range_from = ~0ull;
+
+		total_size = 0;
+
+		if (!stream->Write(req) || !stream->ReadLine(line))
+		{
+			disconnect_server();
+			continue;
+		}
+
+		// Status line: HTTP/1.x <code> <reason>
+		auto p = line.find(' ');
+		if (p != string::npos)
+			status = atoi(line.c_str() + p + 1);
+
+		if (line.compare(0, 8, "HTTP/1.0") == 0)
+			keep_alive = false;
+
+		while (stream->ReadLine(line))
+		{
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			if (line.empty())
+				break;
+
+			auto colon = line.find(':');
+			if (colon == string::npos)
+				continue;
+
+			string key = line.substr(0, colon);
+			string val = line.substr(colon + 1);
+
+			transform(key.begin(), key.end(), key.begin(), [](unsigned char c) {return (char) tolower(c); });
+			val.erase(0, val.find_first_not_of(" \t"));
+
+			if (key == "content-length")
+			{
+				content_length = strtoull(val.c_str(), nullptr, 10);
+				has_length = true;
+			}
+			else if (key == "content-range")
+			{
+				// bytes <from>-<to>/<total>
+				auto dash = val.find('-');
+				auto slash = val.find('/');
+
+				if (dash != string::npos && slash != string::npos && val.compare(0, 6, "bytes ") == 0)
+				{
+					range_from = strtoull(val.c_str() + 6, nullptr, 10);
+					total_size = strtoull(val.c_str() + slash + 1, nullptr, 10);
+				}
+			}
+			else if (key == "connection")
+			{
+				transform(val.begin(), val.end(), val.begin(), [](unsigned char c) {return (char) tolower(c); });
+				keep_alive = val.find("close") == string::npos;
+			}
+			else if (key == "transfer-encoding")
+				has_length = false;
+		}
+
+		if (status != 206 || range_from != from || !has_length)
+		{
+			if (status == 200)
+				cerr << "Server does not support range requests: " << host << endl;
+			else
+				cerr << "Wrong response (status " << status << ") for range " << from << "-" << to << " of " << path << endl;
+			disconnect_server();
+			return false;
+		}
+
+		v_data.resize(content_length);
+
+		if (!stream->Read(v_data.data(), content_length))
+		{
+			disconnect_server();
+			continue;
+		}
+
+		if (!keep_alive)
+			disconnect_server();
+
+		++no_requests;
+		no_fetched_bytes += content_length;
+
+		return true;
+	}
+
+	cerr << "Connection lost: " << host << ":" << port << endl;
+
+	return false;
+}
+
+// *******************************************************************************************
+bool CHttpArchiveInput::Open(const string& file_name, const size_t _BUFFER_SIZE)
+{
+	if (opened)
+		return false;
+
+	if (!parse_url(file_name))
+		return false;
+
+	vector<uint8_t> v_data;
+
+	if (!request_range(0, 0, v_data, file_size) || file_size == 0)
+	{
+		disconnect_server();
+		return false;
+	}
+
+	// Whole archive requested - no eviction of blocks
+	if (_BUFFER_SIZE == ~0ull)
+		max_cached_blocks = ~0ull;
+
+	pos = 0;
+	cur_block = nullptr;
+	opened = true;
+
+	return true;
+}
+
+// *******************************************************************************************
+bool CHttpArchiveInput::Close()
+{
+	if (!opened)
+		return false;
+
+	disconnect_server();
+
+	m_blocks.clear();
+	l_lru.clear();
+	cur_block = nullptr;
+	opened = false;
+
+	return true;
+}
+
+// *******************************************************************************************
+bool CHttpArchiveInput::fetch_blocks(const size_t first_block, const size_t last_block)
+{
+	size_t from = first_block * block_size;
+	size_t to = min((last_block + 1) * block_size, file_size) - 1;
+	size_t total_size;
+	vector<uint8_t> v_data;
+
+	if (!request_range(from, to, v_data, total_size) || v_data.size() != to - from + 1)
+		return false;
+
+	for (size_t i = first_block; i <= last_block; ++i)
+	{
+		auto begin = v_data.begin() + (i - first_block) * block_size;
+		auto end = v_data.begin() + min((i - first_block + 1) * block_size, v_data.size());
+
+		l_lru.push_front(i);
+
+		auto& block = m_blocks[i];
+		block.data.assign(begin, end);
+		block.lru_pos = l_lru.begin();
+	}
+
+	return true;
+}
+
+// *******************************************************************************************
+// Blocks used recently (incl. the current one) are at the front of the LRU list, so they are evicted last
+void CHttpArchiveInput::evict_blocks()
+{
+	while (m_blocks.size() > max_cached_blocks && !l_lru.empty())
+	{
+		size_t block_id = l_lru.back();
+
+		if (cur_block && block_id == cur_block_start / block_size)
+			break;
+
+		l_lru.pop_back();
+		m_blocks.erase(block_id);
+	}
+}
+
+// *******************************************************************************************
+// Make sure all blocks overlapping the range are in the cache; runs of missing blocks are fetched by single requests
+bool CHttpArchiveInput::ensure_range(const size_t offset, const size_t size)
+{
+	if (size == 0 || offset >= file_size)
+		return true;
+
+	size_t first_block = offset / block_size;
+	size_t last_block = (min(offset + size, file_size) - 1) / block_size;
+	size_t max_run = max<size_t>(1, max_request_size / block_size);
+	bool res = true;
+
+	for (size_t i = first_block; i <= last_block && res; )
+	{
+		auto p = m_blocks.find(i);
+
+		if (p != m_blocks.end())
+		{
+			l_lru.splice(l_lru.begin(), l_lru, p->second.lru_pos);
+			++i;
+			continue;
+		}
+
+		size_t j = i;
+		while (j + 1 <= last_block && j + 1 - i < max_run && m_blocks.find(j + 1) == m_blocks.end())
+			++j;
+
+		res = fetch_blocks(i, j);
+		i = j + 1;
+	}
+
+	return res;
+}
+
+// *******************************************************************************************
+const uint8_t* CHttpArchiveInput::get_block(const size_t block_id)
+{
+	auto p = m_blocks.find(block_id);
+
+	if (p == m_blocks.end())
+	{
+		cur_block = nullptr;
+
+		if (!ensure_range(block_id * block_size, 1))
+			return nullptr;
+		p = m_blocks.find(block_id);
+		if (p == m_blocks.end())
+			return nullptr;
+	}
+	else
+		l_lru.splice(l_lru.begin(), l_lru, p->second.lru_pos);
+
+	cur_block = p->second.data.data();
+	cur_block_start = block_id * block_size;
+	cur_block_end = cur_block_start + p->second.data.size();
+
+	evict_blocks();
+
+	return cur_block;
+}
+
+// *******************************************************************************************
+int CHttpArchiveInput::Get()
+{
+	if (pos >= file_size)
+		return EOF;
+
+	if (!cur_block || pos < cur_block_start || pos >= cur_block_end)
+		if (!get_block(pos / block_size))
+			return EOF;
+
+	return cur_block[pos++ - cur_block_start];
+}
+
+// *******************************************************************************************
+void CHttpArchiveInput::Read(uint8_t* ptr, size_t size)
+{
+	if (pos + size > file_size)
+		size = file_size - min(pos, file_size);
+
+	cur_block = nullptr;
+
+	// Blocks are evicted after copying, as the range can be larger than the cache
+	if (!ensure_range(pos, size))
+	{
+		evict_blocks();
+		return;
+	}
+
+	while (size)
+	{
+		auto p = m_blocks.find(pos / block_size);
+		if (p == m_blocks.end())
+			break;
+
+		size_t in_block_pos = pos % block_size;
+		size_t to_copy = min(size, p->second.data.size() - in_block_pos);
+
+		memcpy(ptr, p->second.data.data() + in_block_pos, to_copy);
+		ptr += to_copy;
+		pos += to_copy;
+		size -= to_copy;
+	}
+
+	evict_blocks();
+}
+
+// *******************************************************************************************
+// Nothing is read here, so seeking to the beginning after loading metadata costs no request
+bool CHttpArchiveInput::Seek(const size_t requested_pos)
+{
+	pos = requested_pos;
+
+	return true;
+}
+
+// *******************************************************************************************
+bool CHttpArchiveInput::Advise(const size_t offset, const size_t size)
+{
+	if (!opened)
+		return false;
+
+	cur_block = nullptr;
+
+	bool res = ensure_range(offset, size);
+	evict_blocks();
+
+	return res;
+}
+
+// EOF
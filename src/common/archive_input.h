@@ -0,0 +1,255 @@
+#ifndef _ARCHIVE_INPUT_H
+#define _ARCHIVE_INPUT_H
+
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include "../common/io.h"
+
+using namespace std;
+
+// *******************************************************************************************
+// Storage backends of archives opened for reading
+//   automatic - http:// (and https://) names are read remotely, other names as local files
+//   file      - buffered local file (CInFile)
+//   mmap      - memory-mapped local file
+//   http      - HTTP range requests
+enum class archive_backend_t { automatic, file, mmap, http };
+
+// *******************************************************************************************
+// Random-access input of CArchive
+// Methods are called under the lock of CArchive, so implementations need no synchronization
+class CArchiveInput
+{
+public:
+	virtual ~CArchiveInput() {}
+
+	// _BUFFER_SIZE == ~0ull - archive will be read whole (prefetching)
+	virtual bool Open(const string& file_name, const size_t _BUFFER_SIZE) = 0;
+	virtual bool Close() = 0;
+	virtual bool IsOpened() = 0;
+
+	virtual size_t FileSize() const = 0;
+	virtual int Get() = 0;
+	virtual void Read(uint8_t* ptr, size_t size) = 0;
+	virtual bool Seek(const size_t requested_pos) = 0;
+
+	// Hint that the range will be read soon
+	virtual bool Advise(const size_t offset, const size_t size)
+	{
+		return false;
+	}
+
+	// *******************************************************************************************
+	uint64_t ReadUInt(const int no_bytes)
+	{
+		uint64_t x = 0;
+		uint64_t shift = 0;
+
+		for (int i = 0; i < no_bytes; ++i)
+		{
+			uint64_t c = Get();
+			x += c << shift;
+			shift += 8;
+		}
+
+		return x;
+	}
+
+	static bool IsRemote(const string& file_name);
+	static unique_ptr<CArchiveInput> Create(const string& file_name, const archive_backend_t backend);
+};
+
+// *******************************************************************************************
+class CFileArchiveInput : public CArchiveInput
+{
+	CInFile f;
+
+public:
+	bool Open(const string& file_name, const size_t _BUFFER_SIZE) override
+	{
+		return f.Open(file_name, _BUFFER_SIZE);
+	}
+
+	bool Close() override
+	{
+		return f.Close();
+	}
+
+	bool IsOpened() override
+	{
+		return f.IsOpened();
+	}
+
+	size_t FileSize() const override
+	{
+		return f.FileSize();
+	}
+
+	int Get() override
+	{
+		return f.Get();
+	}
+
+	void Read(uint8_t* ptr, size_t size) override
+	{
+		f.Read(ptr, size);
+	}
+
+	bool Seek(const size_t requested_pos) override
+	{
+		return f.Seek(requested_pos);
+	}
+
+	bool Advise(const size_t offset, const size_t size) override
+	{
+		return f.Advise(offset, size);
+	}
+};
+
+// *******************************************************************************************
+// Whole file is mapped, so the pages are loaded (and kept in the page cache) on demand
+class CMmapArchiveInput : public CArchiveInput
+{
+	int fd = -1;
+	uint8_t* data = nullptr;
+	size_t file_size = 0;
+	size_t pos = 0;
+
+public:
+	~CMmapArchiveInput();
+
+	bool Open(const string& file_name, const size_t _BUFFER_SIZE) override;
+	bool Close() override;
+
+	bool IsOpened() override
+	{
+		return data != nullptr;
+	}
+
+	size_t FileSize() const override
+	{
+		return file_size;
+	}
+
+	int Get() override
+	{
+		if (pos < file_size)
+			return data[pos++];
+
+		return EOF;
+	}
+
+	void Read(uint8_t* ptr, size_t size) override
+	{
+		if (pos + size > file_size)
+			size = file_size - min(pos, file_size);
+
+		memcpy(ptr, data + pos, size);
+		pos += size;
+	}
+
+	bool Seek(const size_t requested_pos) override
+	{
+		pos = requested_pos;
+
+		return true;
+	}
+
+	bool Advise(const size_t offset, const size_t size) override;
+};
+
+// *******************************************************************************************
+// Archive read by HTTP range requests (HTTP/1.1 over a single keep-alive connection).
+// The file is split into blocks kept in LRU cache. Missing blocks needed by a single read
+// (or readahead hint) are fetched by a single request.
+class CSocketStream;
+
+class CHttpArchiveInput : public CArchiveInput
+{
+	const size_t block_size = 256 << 10;
+	const size_t max_request_size = 64 << 20;
+	size_t max_cached_blocks = 1024;
+
+	string host;
+	string port;
+	string path;
+
+	int fd = -1;
+	unique_ptr<CSocketStream> stream;
+
+	bool opened = false;
+	size_t file_size = 0;
+	size_t pos = 0;
+
+	struct block_t {
+		vector<uint8_t> data;
+		list<size_t>::iterator lru_pos;
+	};
+
+	unordered_map<size_t, block_t> m_blocks;
+	list<size_t> l_lru;						// most recently used blocks at front
+
+	const uint8_t* cur_block = nullptr;
+	size_t cur_block_start = 0;
+	size_t cur_block_end = 0;
+
+	size_t no_requests = 0;
+	size_t no_fetched_bytes = 0;
+
+	bool parse_url(const string& url);
+	bool connect_server();
+	void disconnect_server();
+	bool request_range(const size_t from, const size_t to, vector<uint8_t>& v_data, size_t& total_size);
+	bool fetch_blocks(const size_t first_block, const size_t last_block);
+	bool ensure_range(const size_t offset, const size_t size);
+	void evict_blocks();
+	const uint8_t* get_block(const size_t block_id);
+
+public:
+	~CHttpArchiveInput();
+
+	bool Open(const string& file_name, const size_t _BUFFER_SIZE) override;
+	bool Close() override;
+
+	bool IsOpened() override
+	{
+		return opened;
+	}
+
+	size_t FileSize() const override
+	{
+		return file_size;
+	}
+
+	int Get() override;
+	void Read(uint8_t* ptr, size_t size) override;
+	bool Seek(const size_t requested_pos) override;
+	bool Advise(const size_t offset, const size_t size) override;
+
+	size_t GetNoRequests() const
+	{
+		return no_requests;
+	}
+
+	size_t GetNoFetchedBytes() const
+	{
+		return no_fetched_bytes;
+	}
+};
+
+// EOF
+#endif
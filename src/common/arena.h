@@ -0,0 +1,130 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// *******************************************************************************************
+// Bump allocator for short-lived temporary structures owned by a single thread
+//   * memory is taken from (large) blocks and never returned individually (except the most recent allocation,
+//     which makes growing of vectors cheap)
+//   * Reset() releases everything at once; if more than one block was used, they are merged into a single one,
+//     so in the steady state the arena does not touch the global allocator at all
+//   * not thread-safe: each thread must use its own arena
+class CArena : public pmr::memory_resource
+{
+	struct block_t
+	{
+		unique_ptr<uint8_t[]> data;
+		size_t size;
+	};
+
+	vector<block_t> v_blocks;
+	size_t cur_block = 0;
+	size_t cur_pos = 0;
+	size_t total_size = 0;
+
+	uint8_t* last_alloc = nullptr;
+
+	static constexpr size_t min_block_size = 1ull << 16;
+
+	// *******************************************************************************************
+	void add_block(size_t min_size)
+	{
+		size_t size = max(min_block_size, v_blocks.empty() ? 0 : 2 * v_blocks.back().size);
+		while (size < min_size)
+			size *= 2;
+
+		v_blocks.emplace_back(block_t{ make_unique_for_overwrite<uint8_t[]>(size), size });
+		total_size += size;
+	}
+
+	// *******************************************************************************************
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		if (v_blocks.empty())
+			add_block(bytes + alignment);
+
+		while (true)
+		{
+			auto& block = v_blocks[cur_block];
+			uint64_t base = (uint64_t)block.data.get();
+			uint64_t pos = (base + cur_pos + alignment - 1) / alignment * alignment - base;
+
+			if (pos + bytes <= block.size)
+			{
+				last_alloc = block.data.get() + pos;
+				cur_pos = pos + bytes;
+
+				return last_alloc;
+			}
+
+			if (cur_block + 1 == v_blocks.size())
+				add_block(bytes + alignment);
+
+			++cur_block;
+			cur_pos = 0;
+		}
+	}
+
+	// *******************************************************************************************
+	void do_deallocate(void* ptr, size_t bytes, size_t /*alignment*/) override
+	{
+		// Only the most recent allocation can be given back
+		if (ptr == last_alloc && last_alloc + bytes == v_blocks[cur_block].data.get() + cur_pos)
+		{
+			cur_pos -= bytes;
+			last_alloc = nullptr;
+		}
+	}
+
+	// *******************************************************************************************
+	bool do_is_equal(const pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+
+public:
+	CArena() = default;
+	CArena(const CArena&) = delete;
+	CArena& operator=(const CArena&) = delete;
+
+	// *******************************************************************************************
+	// All objects allocated in the arena must be destroyed before
+	void Reset()
+	{
+		if (v_blocks.size() > 1)
+		{
+			v_blocks.clear();
+			v_blocks.emplace_back(block_t{ make_unique_for_overwrite<uint8_t[]>(total_size), total_size });
+		}
+
+		cur_block = 0;
+		cur_pos = 0;
+		last_alloc = nullptr;
+	}
+
+	// *******************************************************************************************
+	size_t GetSize() const
+	{
+		return total_size;
+	}
+};
+
+// EOF
+#endif
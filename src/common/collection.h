@@ -88,6 +88,38 @@ struct segments_to_place_t {
 	segments_to_place_t(const segments_to_place_t&) = default;
 };
 
+// *******************************************************************************************
+// Summary of contig sequence stored in metadata (so it is available without decompression)
+struct contig_stats_t
+{
+	uint64_t length;
+	uint64_t no_gc;			// C, G, S
+	uint64_t no_n;
+
+	contig_stats_t() : length(0), no_gc(0), no_n(0)
+	{}
+
+	contig_stats_t(const uint64_t _length, const uint64_t _no_gc, const uint64_t _no_n) :
+		length(_length), no_gc(_no_gc), no_n(_no_n)
+	{}
+};
+
+// *******************************************************************************************
+// Content digests of contig (as decompressed, i.e., uppercase) for refget-style identification
+//   md5       - MD5 of the sequence
+//   sha512t24 - first 24 bytes of SHA-512 of the sequence (SQ. identifier is its base64url form)
+struct contig_digest_t
+{
+	array<uint8_t, 16> md5;
+	array<uint8_t, 24> sha512t24;
+
+	contig_digest_t()
+	{
+		md5.fill(0);
+		sha512t24.fill(0);
+	}
+};
+
 // *******************************************************************************************
 using sample_desc_t = vector<pair<string, vector<segment_desc_t>>>;
 
@@ -245,6 +277,23 @@ public:
 
 	virtual size_t get_no_samples() = 0;
 	virtual int32_t get_no_contigs(const string& sample_name) = 0;
+
+	// Contig stats are stored only in archives of version 3 (created by recent releases)
+	virtual bool has_contig_stats() { return false; }
+	virtual void set_contig_stats(const string& sample_name, const string& contig_name, const contig_stats_t& stats) {}
+	virtual bool get_contig_stats(const string& sample_name, const string& contig_name, contig_stats_t& stats) { return false; }
+	virtual bool get_sample_stats(const string& sample_name, vector<pair<string, contig_stats_t>>& v_stats) { return false; }
+
+	// Contig digests are stored only in archives of version 3 (created by recent releases)
+	virtual bool has_contig_digests() { return false; }
+	virtual void set_contig_digest(const string& sample_name, const string& contig_name, const contig_digest_t& digest) {}
+	virtual bool get_contig_digest(const string& sample_name, const string& contig_name, contig_digest_t& digest) { return false; }
+	virtual bool get_sample_digests(const string& sample_name, vector<pair<string, contig_digest_t>>& v_digests) { return false; }
+	virtual bool find_contigs_by_digest(const string& digest, vector<pair<string, string>>& v_sample_contig) { return false; }
+
+	// Removed samples (tombstones) are supported only in archives of version 3
+	virtual bool remove_sample(const string& sample_name) { return false; }
+	virtual size_t get_no_removed_samples() { return 0; }
 };
 
 // EOF
@@ -9,8 +9,9 @@
 // *******************************************************************************************
 
 #include "collection_v3.h"
+#include "digest.h"
 #include <cassert>
-#include <future>
+#include <cstring>
 
 // *******************************************************************************************
 bool CCollection_V3::set_archives(shared_ptr<CArchive> _in_archive, shared_ptr<CArchive> _out_archive,
@@ -34,12 +35,24 @@ bool CCollection_V3::set_archives(shared_ptr<CArchive> _in_archive, shared_ptr<C
 		return prepare_for_appending_copy();
 }
 
+// *******************************************************************************************
+void CCollection_V3::set_thread_pool(shared_ptr<CThreadPool> _thread_pool)
+{
+	lock_guard<mutex> lck(mtx);
+
+	thread_pool = _thread_pool;
+}
+
 // *******************************************************************************************
 bool CCollection_V3::prepare_for_compression()
 {
 	collection_samples_id = out_archive->RegisterStream("collection-samples");
 	collection_contig_id = out_archive->RegisterStream("collection-contigs");
 	collection_details_id = out_archive->RegisterStream("collection-details");	
+	collection_stats_id = out_archive->RegisterStream("collection-stats");
+	stats_enabled = true;
+	collection_digests_id = out_archive->RegisterStream("collection-digests");
+	digests_enabled = true;
 
 	return true;
 }
@@ -55,7 +68,21 @@ bool CCollection_V3::prepare_for_appending_copy()
 	collection_contig_id = out_archive->RegisterStream("collection-contigs");
 	collection_details_id = out_archive->RegisterStream("collection-details");
 
+	// Stats are continued only if the input archive contains them for all samples
+	auto in_collection_stats_id = in_archive->GetStreamId("collection-stats");
+	stats_enabled = in_collection_stats_id >= 0;
+
+	if (stats_enabled)
+		collection_stats_id = out_archive->RegisterStream("collection-stats");
+
+	auto in_collection_digests_id = in_archive->GetStreamId("collection-digests");
+	digests_enabled = in_collection_digests_id >= 0;
+
+	if (digests_enabled)
+		collection_digests_id = out_archive->RegisterStream("collection-digests");
+
 	load_batch_sample_names();
+	load_removed_samples();
 
 	// in and out ids for collection-* must be the same!
 
@@ -71,6 +98,18 @@ bool CCollection_V3::prepare_for_appending_copy()
 		out_archive->AddPart(collection_contig_id, data, meta);
 		in_archive->GetPart(in_collection_details_id, i, data, meta);
 		out_archive->AddPart(collection_details_id, data, meta);
+
+		if (stats_enabled)
+		{
+			in_archive->GetPart(in_collection_stats_id, i, data, meta);
+			out_archive->AddPart(collection_stats_id, data, meta);
+		}
+
+		if (digests_enabled)
+		{
+			in_archive->GetPart(in_collection_digests_id, i, data, meta);
+			out_archive->AddPart(collection_digests_id, data, meta);
+		}
 	}
 
 	return true;
@@ -93,6 +132,10 @@ bool CCollection_V3::prepare_for_appending_load_last_batch()
 	// Load last batch
 	load_batch_contig_names(no_contig_batches - 1);
 	load_batch_contig_details(no_contig_batches - 1);
+	if (stats_enabled)
+		load_batch_contig_stats(no_contig_batches - 1);
+	if (digests_enabled)
+		load_batch_contig_digests(no_contig_batches - 1);
 
 	if (no_samples_in_last_batch == batch_size)
 	{
@@ -101,6 +144,18 @@ bool CCollection_V3::prepare_for_appending_load_last_batch()
 		in_archive->GetPart(in_collection_details_id, no_contig_batches - 1, data, meta);
 		out_archive->AddPart(collection_details_id, data, meta);
 
+		if (stats_enabled)
+		{
+			in_archive->GetPart(in_archive->GetStreamId("collection-stats"), no_contig_batches - 1, data, meta);
+			out_archive->AddPart(collection_stats_id, data, meta);
+		}
+
+		if (digests_enabled)
+		{
+			in_archive->GetPart(in_archive->GetStreamId("collection-digests"), no_contig_batches - 1, data, meta);
+			out_archive->AddPart(collection_digests_id, data, meta);
+		}
+
 		clear_batch_contig(no_contig_batches - 1);
 	}
 
@@ -113,8 +168,13 @@ bool CCollection_V3::prepare_for_decompression()
 	collection_samples_id = in_archive->GetStreamId("collection-samples");
 	collection_contig_id = in_archive->GetStreamId("collection-contigs");
 	collection_details_id = in_archive->GetStreamId("collection-details");
+	collection_stats_id = in_archive->GetStreamId("collection-stats");
+	stats_enabled = collection_stats_id >= 0;
+	collection_digests_id = in_archive->GetStreamId("collection-digests");
+	digests_enabled = collection_digests_id >= 0;
 
 	load_batch_sample_names();
+	load_removed_samples();
 
 	return true;
 }
@@ -125,6 +185,49 @@ void CCollection_V3::complete_serialization()
 	lock_guard<mutex> lck(mtx);
 
 	store_batch_sample_names();
+
+	if (!removed_sample_ids.empty())
+	{
+		vector<uint8_t> v_data;
+
+		serialize_removed_samples(v_data);
+		out_archive->AddPartBuffered(out_archive->RegisterStream("collection-removed"), v_data, 0);
+	}
+}
+
+// *******************************************************************************************
+void CCollection_V3::store_checkpoint(const uint32_t no_samples)
+{
+	lock_guard<mutex> lck(mtx);
+
+	uint32_t id_from = no_samples / (uint32_t) batch_size * (uint32_t) batch_size;
+
+	if (id_from < no_samples)
+	{
+		store_batch_contig_names(id_from, no_samples);
+		store_batch_contig_details(id_from, no_samples);
+
+		if (stats_enabled)
+			store_batch_contig_stats(id_from, no_samples);
+
+		if (digests_enabled)
+			store_batch_contig_digests(id_from, no_samples);
+	}
+
+	vector<uint8_t> v_data, v_tmp;
+
+	determine_collection_samples_id();
+
+	serialize_sample_names(v_tmp, no_samples);
+	zstd_compress(zstd_cctx_samples, v_tmp, v_data, 19);
+	out_archive->AddPartBuffered(collection_samples_id, v_data, v_tmp.size());
+
+	if (!removed_sample_ids.empty())
+	{
+		v_data.clear();
+		serialize_removed_samples(v_data);
+		out_archive->AddPartBuffered(out_archive->RegisterStream("collection-removed"), v_data, 0);
+	}
 }
 
 // *******************************************************************************************
@@ -158,7 +261,7 @@ void CCollection_V3::store_batch_sample_names()
 
 	determine_collection_samples_id();
 
-	serialize_sample_names(v_tmp);
+	serialize_sample_names(v_tmp, sample_desc.size());
 
 	zstd_compress(zstd_cctx_samples, v_tmp, v_data, 19);
 
@@ -180,6 +283,92 @@ void CCollection_V3::load_batch_sample_names()
 	deserialize_sample_names(v_data);
 }
 
+// *******************************************************************************************
+// Last part of the stream contains ids of all removed samples
+void CCollection_V3::load_removed_samples()
+{
+	removed_sample_ids.clear();
+
+	int stream_id = in_archive->GetStreamId("collection-removed");
+
+	if (stream_id < 0)
+		return;
+
+	auto no_parts = in_archive->GetNoParts(stream_id);
+
+	if (no_parts == 0)
+		return;
+
+	vector<uint8_t> v_data;
+	uint64_t meta;
+
+	if (!in_archive->GetPart(stream_id, (int) no_parts - 1, v_data, meta) || v_data.empty())
+		return;
+
+	uint8_t* p = v_data.data();
+	uint32_t no_removed, id;
+
+	read(p, no_removed);
+
+	for (uint32_t i = 0; i < no_removed; ++i)
+	{
+		read(p, id);
+
+		if (id >= sample_desc.size())
+			continue;
+
+		removed_sample_ids.insert(id);
+
+		// Sample of the same name could be added after removal
+		auto q = sample_ids.find(sample_desc[id].name);
+		if (q != sample_ids.end() && q->second == id)
+			sample_ids.erase(q);
+	}
+}
+
+// *******************************************************************************************
+void CCollection_V3::serialize_removed_samples(vector<uint8_t>& v_data)
+{
+	vector<uint32_t> v_ids(removed_sample_ids.begin(), removed_sample_ids.end());
+	sort(v_ids.begin(), v_ids.end());
+
+	v_data.clear();
+	append(v_data, (uint32_t) v_ids.size());
+
+	for (auto id : v_ids)
+		append(v_data, id);
+}
+
+// *******************************************************************************************
+bool CCollection_V3::remove_sample(const string& sample_name)
+{
+	lock_guard<mutex> lck(mtx);
+
+	auto p = sample_ids.find(sample_name);
+
+	if (p == sample_ids.end())
+		return false;
+
+	removed_sample_ids.insert(p->second);
+	sample_ids.erase(p);
+
+	if (digest_index_built)
+	{
+		digest_index.clear();
+		digest_index_built = false;
+	}
+
+	return true;
+}
+
+// *******************************************************************************************
+size_t CCollection_V3::get_no_removed_samples()
+{
+	lock_guard<mutex> lck(mtx);
+
+	return removed_sample_ids.size();
+}
+
 // *******************************************************************************************
 void CCollection_V3::store_batch_contig_names(uint32_t id_from, uint32_t id_to)
 {
@@ -224,6 +413,11 @@ void CCollection_V3::clear_batch_contig(size_t id_batch)
 		sample_desc[i].contigs.clear();
 		sample_desc[i].contigs.shrink_to_fit();
 	}
+
+	if (unpacked_contig_stats_batch_id == (int) id_batch)
+		unpacked_contig_stats_batch_id = -1;
+	if (unpacked_contig_digests_batch_id == (int) id_batch)
+		unpacked_contig_digests_batch_id = -1;
 }
 
 // *******************************************************************************************
@@ -237,16 +431,16 @@ void CCollection_V3::store_batch_contig_details(uint32_t id_from, uint32_t id_to
 
 	serialize_contig_details(v_data, id_from, id_to);
 
-	if (no_threads >= 4)
+	if (no_threads >= 4 && thread_pool)
 	{
-		vector<future<void>> v_fut;
-		v_fut.reserve(5);
+		CTaskGroup task_group;
 
-		for (int i = 0; i < 5; ++i)
-			v_fut.emplace_back(async([&, i]() {zstd_compress(zstd_cctx_details[i], v_data[i], v_packed[i], 19); }));
+		for (int i = 1; i < 5; ++i)
+			thread_pool->Launch(task_group, [&, i]() {zstd_compress(zstd_cctx_details[i], v_data[i], v_packed[i], 19); });
 
-		for (int i = 0; i < 5; ++i)
-			v_fut[i].wait();
+		zstd_compress(zstd_cctx_details[0], v_data[0], v_packed[0], 19);
+
+		thread_pool->Wait(task_group);
 	}
 	else
 	{
@@ -297,16 +491,16 @@ void CCollection_V3::load_batch_contig_details(size_t id_batch)
 		ptr += a_sizes[i].second;
 	}
 
-	if (no_threads >= 4)
+	if (no_threads >= 4 && thread_pool)
 	{
-		vector<future<void>> v_fut;
-		v_fut.reserve(5);
+		CTaskGroup task_group;
 
-		for (int i = 0; i < 5; ++i)
-			v_fut.emplace_back(async([&, i]() {zstd_decompress(zstd_dctx_details[i], v_packed[i], v_data[i], a_sizes[i].first); }));
+		for (int i = 1; i < 5; ++i)
+			thread_pool->Launch(task_group, [&, i]() {zstd_decompress(zstd_dctx_details[i], v_packed[i], v_data[i], a_sizes[i].first); });
 
-		for (int i = 0; i < 5; ++i)
-			v_fut[i].wait();
+		zstd_decompress(zstd_dctx_details[0], v_packed[0], v_data[0], a_sizes[0].first);
+
+		thread_pool->Wait(task_group);
 	}
 	else
 	{
@@ -320,12 +514,122 @@ void CCollection_V3::load_batch_contig_details(size_t id_batch)
 }
 
 // *******************************************************************************************
-void CCollection_V3::serialize_sample_names(vector<uint8_t>& v_data)
+void CCollection_V3::store_batch_contig_stats(uint32_t id_from, uint32_t id_to)
 {
-	append(v_data, (uint32_t) sample_desc.size());
+	vector<uint8_t> v_data, v_tmp;
+
+	serialize_contig_stats(v_tmp, id_from, id_to);
 
-	for (auto& x: sample_desc)
-		append(v_data, x.name);
+	zstd_compress(zstd_cctx_stats, v_tmp, v_data, 19);
+
+	out_archive->AddPartBuffered(collection_stats_id, v_data, v_tmp.size());
+}
+
+// *******************************************************************************************
+// Contig names of the batch must be already loaded
+void CCollection_V3::load_batch_contig_stats(size_t id_batch)
+{
+	vector<uint8_t> v_data, v_tmp;
+	uint64_t raw_size;
+
+	unpacked_contig_stats_batch_id = (int) id_batch;
+
+	if (!in_archive->GetPart(in_archive->GetStreamId("collection-stats"), id_batch, v_tmp, raw_size))
+		return;
+
+	zstd_decompress(zstd_dctx_stats, v_tmp, v_data, raw_size);
+
+	deserialize_contig_stats(v_data, id_batch * batch_size);
+}
+
+// *******************************************************************************************
+bool CCollection_V3::ensure_sample_stats(const size_t sample_id)
+{
+	if (!stats_enabled)
+		return false;
+
+	size_t id_batch = sample_id / batch_size;
+
+	if (sample_desc[sample_id].contigs.empty())
+		load_batch_contig_names(id_batch);
+
+	if (unpacked_contig_stats_batch_id != (int) id_batch)
+		load_batch_contig_stats(id_batch);
+
+	return true;
+}
+
+// *******************************************************************************************
+// Digests are (almost) random, so they are stored without compression
+void CCollection_V3::store_batch_contig_digests(uint32_t id_from, uint32_t id_to)
+{
+	vector<uint8_t> v_data;
+
+	serialize_contig_digests(v_data, id_from, id_to);
+
+	out_archive->AddPartBuffered(collection_digests_id, v_data, v_data.size());
+}
+
+// *******************************************************************************************
+// Contig names of the batch must be already loaded
+void CCollection_V3::load_batch_contig_digests(size_t id_batch)
+{
+	vector<uint8_t> v_data;
+	uint64_t raw_size;
+
+	unpacked_contig_digests_batch_id = (int) id_batch;
+
+	if (!in_archive->GetPart(in_archive->GetStreamId("collection-digests"), id_batch, v_data, raw_size))
+		return;
+
+	deserialize_contig_digests(v_data, id_batch * batch_size);
+}
+
+// *******************************************************************************************
+bool CCollection_V3::ensure_sample_digests(const size_t sample_id)
+{
+	if (!digests_enabled)
+		return false;
+
+	size_t id_batch = sample_id / batch_size;
+
+	if (sample_desc[sample_id].contigs.empty())
+		load_batch_contig_names(id_batch);
+
+	if (unpacked_contig_digests_batch_id != (int) id_batch)
+		load_batch_contig_digests(id_batch);
+
+	return true;
+}
+
+// *******************************************************************************************
+void CCollection_V3::build_digest_index()
+{
+	digest_index_built = true;
+
+	for (uint32_t i = 0; i < (uint32_t) sample_desc.size(); ++i)
+	{
+		if (removed_sample_ids.count(i))
+			continue;
+
+		if (!ensure_sample_digests(i))
+			return;
+
+		for (auto& x : sample_desc[i].contigs)
+		{
+			digest_index.emplace(string(x.digest.md5.begin(), x.digest.md5.end()), make_pair(i, x.name));
+			digest_index.emplace(string(x.digest.sha512t24.begin(), x.digest.sha512t24.end()), make_pair(i, x.name));
+		}
+	}
+}
+
+// *******************************************************************************************
+void CCollection_V3::serialize_sample_names(vector<uint8_t>& v_data, const size_t no_samples)
+{
+	append(v_data, (uint32_t) no_samples);
+
+	for (size_t i = 0; i < no_samples; ++i)
+		append(v_data, sample_desc[i].name);
 }
 
 // *******************************************************************************************
@@ -678,16 +982,121 @@ void CCollection_V3::deserialize_contig_details(array<vector<uint8_t>, 5>& v_dat
 	}
 }
 
+// *******************************************************************************************
+// Stats are stored as pairs of 32-bit values, as contigs can be longer than 4G
+void CCollection_V3::serialize_contig_stats(vector<uint8_t>& v_data, uint32_t id_from, uint32_t id_to)
+{
+	auto append64 = [&](uint64_t x) {
+		append(v_data, (uint32_t) (x & 0xffffffffull));
+		append(v_data, (uint32_t) (x >> 32));
+	};
+
+	append(v_data, id_to - id_from);
+
+	for (auto p = sample_desc.begin() + id_from; p != sample_desc.begin() + id_to; ++p)
+	{
+		append(v_data, p->contigs.size());
+
+		for (auto& x : p->contigs)
+		{
+			append64(x.stats.length);
+			append64(x.stats.no_gc);
+			append64(x.stats.no_n);
+		}
+	}
+}
+
+// *******************************************************************************************
+void CCollection_V3::deserialize_contig_stats(vector<uint8_t>& v_data, size_t i_sample)
+{
+	uint8_t* p = v_data.data();
+
+	auto read64 = [&](uint64_t& x) {
+		uint32_t lo, hi;
+		read(p, lo);
+		read(p, hi);
+		x = ((uint64_t)hi << 32) + lo;
+	};
+
+	uint32_t no_samples_in_curr_batch;
+	uint32_t no_contigs_in_curr_sample;
+
+	read(p, no_samples_in_curr_batch);
+
+	for (size_t i = 0; i < no_samples_in_curr_batch; ++i)
+	{
+		read(p, no_contigs_in_curr_sample);
+
+		auto& curr_sample = sample_desc[i_sample + i];
+
+		curr_sample.contigs.resize(no_contigs_in_curr_sample);
+
+		for (auto& x : curr_sample.contigs)
+		{
+			read64(x.stats.length);
+			read64(x.stats.no_gc);
+			read64(x.stats.no_n);
+		}
+	}
+}
+
+// *******************************************************************************************
+void CCollection_V3::serialize_contig_digests(vector<uint8_t>& v_data, uint32_t id_from, uint32_t id_to)
+{
+	append(v_data, id_to - id_from);
+
+	for (auto p = sample_desc.begin() + id_from; p != sample_desc.begin() + id_to; ++p)
+	{
+		append(v_data, p->contigs.size());
+
+		for (auto& x : p->contigs)
+		{
+			v_data.insert(v_data.end(), x.digest.md5.begin(), x.digest.md5.end());
+			v_data.insert(v_data.end(), x.digest.sha512t24.begin(), x.digest.sha512t24.end());
+		}
+	}
+}
+
+// *******************************************************************************************
+void CCollection_V3::deserialize_contig_digests(vector<uint8_t>& v_data, size_t i_sample)
+{
+	uint8_t* p = v_data.data();
+
+	uint32_t no_samples_in_curr_batch;
+	uint32_t no_contigs_in_curr_sample;
+
+	read(p, no_samples_in_curr_batch);
+
+	for (size_t i = 0; i < no_samples_in_curr_batch; ++i)
+	{
+		read(p, no_contigs_in_curr_sample);
+
+		auto& curr_sample = sample_desc[i_sample + i];
+
+		curr_sample.contigs.resize(no_contigs_in_curr_sample);
+
+		for (auto& x : curr_sample.contigs)
+		{
+			memcpy(x.digest.md5.data(), p, x.digest.md5.size());
+			p += x.digest.md5.size();
+			memcpy(x.digest.sha512t24.data(), p, x.digest.sha512t24.size());
+			p += x.digest.sha512t24.size();
+		}
+	}
+}
+
 // *******************************************************************************************
 void CCollection_V3::store_contig_batch(uint32_t id_from, uint32_t id_to)
 {
 	lock_guard<mutex> lck(mtx);
 
-	if (no_threads > 1)
+	if (no_threads > 1 && thread_pool)
 	{
-		future<void> fut_contigs = async([&]() {this->store_batch_contig_names(id_from, id_to); });
+		CTaskGroup task_group;
+
+		thread_pool->Launch(task_group, [&]() {this->store_batch_contig_names(id_from, id_to); });
 		store_batch_contig_details(id_from, id_to);
-		fut_contigs.wait();
+		thread_pool->Wait(task_group);
 	}
 	else
 	{
@@ -695,6 +1104,12 @@ void CCollection_V3::store_contig_batch(uint32_t id_from, uint32_t id_to)
 		store_batch_contig_details(id_from, id_to);
 	}
 
+	if (stats_enabled)
+		store_batch_contig_stats(id_from, id_to);
+
+	if (digests_enabled)
+		store_batch_contig_digests(id_from, id_to);
+
 	for (auto p = sample_desc.begin() + id_from; p != sample_desc.begin() + id_to; ++p)
 	{
 		p->contigs.clear();
@@ -825,8 +1240,9 @@ bool CCollection_V3::get_samples_list(vector<string>& v_samples, bool sorted)
 	v_samples.clear();
 	v_samples.reserve(sample_desc.size());
 
-	for (auto& x : sample_desc)
-		v_samples.emplace_back(x.name);
+	for (uint32_t i = 0; i < (uint32_t) sample_desc.size(); ++i)
+		if (!removed_sample_ids.count(i))
+			v_samples.emplace_back(sample_desc[i].name);
 
 	if(sorted)
 		sort(v_samples.begin(), v_samples.end());
@@ -958,6 +1374,9 @@ vector<string> CCollection_V3::get_samples_for_contig(const string& contig_name)
 
 		for (size_t j = i * batch_size; j < to_batch_id; ++j)
 		{
+			if (removed_sample_ids.count((uint32_t) j))
+				continue;
+
 			for (auto& x : sample_desc[j].contigs)
 				if(extract_contig_name(x.name) == short_contig_name)
 					v_samples.emplace_back(sample_desc[j].name);
@@ -993,4 +1412,203 @@ int32_t CCollection_V3::get_no_contigs(const string& sample_name)
 	return (int32_t) sample_desc[p->second].contigs.size();
 }
 
+// *******************************************************************************************
+bool CCollection_V3::has_contig_stats()
+{
+	lock_guard<mutex> lck(mtx);
+
+	return stats_enabled;
+}
+
+// *******************************************************************************************
+void CCollection_V3::set_contig_stats(const string& sample_name, const string& contig_name, const contig_stats_t& stats)
+{
+	lock_guard<mutex> lck(mtx);
+
+	string stored_sample_name = sample_name;
+
+	if (sample_name.empty())
+		stored_sample_name = extract_contig_name(contig_name);
+
+	auto p = sample_ids.find(stored_sample_name);
+
+	if (p == sample_ids.end())
+		return;
+
+	for (auto& x : sample_desc[p->second].contigs)
+		if (x.name == contig_name)
+		{
+			x.stats = stats;
+			return;
+		}
+}
+
+// *******************************************************************************************
+bool CCollection_V3::get_contig_stats(const string& sample_name, const string& contig_name, contig_stats_t& stats)
+{
+	lock_guard<mutex> lck(mtx);
+
+	string short_contig_name = extract_contig_name(contig_name);
+
+	auto p = sample_ids.find(sample_name);
+
+	if (p == sample_ids.end() || !ensure_sample_stats(p->second))
+		return false;
+
+	for (auto& x : sample_desc[p->second].contigs)
+		if (extract_contig_name(x.name) == short_contig_name)
+		{
+			stats = x.stats;
+			return true;
+		}
+
+	return false;
+}
+
+// *******************************************************************************************
+bool CCollection_V3::get_sample_stats(const string& sample_name, vector<pair<string, contig_stats_t>>& v_stats)
+{
+	lock_guard<mutex> lck(mtx);
+
+	v_stats.clear();
+
+	auto p = sample_ids.find(sample_name);
+
+	if (p == sample_ids.end() || !ensure_sample_stats(p->second))
+		return false;
+
+	v_stats.reserve(sample_desc[p->second].contigs.size());
+
+	for (auto& x : sample_desc[p->second].contigs)
+		v_stats.emplace_back(x.name, x.stats);
+
+	return true;
+}
+
+// *******************************************************************************************
+bool CCollection_V3::has_contig_digests()
+{
+	lock_guard<mutex> lck(mtx);
+
+	return digests_enabled;
+}
+
+// *******************************************************************************************
+void CCollection_V3::set_contig_digest(const string& sample_name, const string& contig_name, const contig_digest_t& digest)
+{
+	lock_guard<mutex> lck(mtx);
+
+	string stored_sample_name = sample_name;
+
+	if (sample_name.empty())
+		stored_sample_name = extract_contig_name(contig_name);
+
+	auto p = sample_ids.find(stored_sample_name);
+
+	if (p == sample_ids.end())
+		return;
+
+	for (auto& x : sample_desc[p->second].contigs)
+		if (x.name == contig_name)
+		{
+			x.digest = digest;
+			return;
+		}
+}
+
+// *******************************************************************************************
+bool CCollection_V3::get_contig_digest(const string& sample_name, const string& contig_name, contig_digest_t& digest)
+{
+	lock_guard<mutex> lck(mtx);
+
+	string short_contig_name = extract_contig_name(contig_name);
+
+	auto p = sample_ids.find(sample_name);
+
+	if (p == sample_ids.end() || !ensure_sample_digests(p->second))
+		return false;
+
+	for (auto& x : sample_desc[p->second].contigs)
+		if (extract_contig_name(x.name) == short_contig_name)
+		{
+			digest = x.digest;
+			return true;
+		}
+
+	return false;
+}
+
+// *******************************************************************************************
+bool CCollection_V3::get_sample_digests(const string& sample_name, vector<pair<string, contig_digest_t>>& v_digests)
+{
+	lock_guard<mutex> lck(mtx);
+
+	v_digests.clear();
+
+	auto p = sample_ids.find(sample_name);
+
+	if (p == sample_ids.end() || !ensure_sample_digests(p->second))
+		return false;
+
+	v_digests.reserve(sample_desc[p->second].contigs.size());
+
+	for (auto& x : sample_desc[p->second].contigs)
+		v_digests.emplace_back(x.name, x.digest);
+
+	return true;
+}
+
+// *******************************************************************************************
+// Accepted forms of digest:
+//   MD5       - 32 hex digits, optionally prefixed by "md5:"
+//   SHA512t24 - 32 base64url characters, optionally prefixed by "SQ." or "ga4gh:SQ."
+// Unprefixed 32 hex digits are taken as MD5
+bool CCollection_V3::find_contigs_by_digest(const string& digest, vector<pair<string, string>>& v_sample_contig)
+{
+	lock_guard<mutex> lck(mtx);
+
+	v_sample_contig.clear();
+
+	if (!digests_enabled)
+		return false;
+
+	string str = digest;
+	string key;
+	bool is_md5 = true;
+	bool is_sha = true;
+
+	if (str.compare(0, 4, "md5:") == 0)
+	{
+		str.erase(0, 4);
+		is_sha = false;
+	}
+	else
+		for (auto prefix : { "ga4gh:SQ.", "SQ." })
+			if (str.compare(0, strlen(prefix), prefix) == 0)
+			{
+				str.erase(0, strlen(prefix));
+				is_md5 = false;
+				break;
+			}
+
+	contig_digest_t parsed;
+
+	if (is_md5 && digest_from_hex(str, parsed.md5.data(), parsed.md5.size()))
+		key.assign(parsed.md5.begin(), parsed.md5.end());
+	else if (is_sha && digest_from_base64url(str, parsed.sha512t24.data(), parsed.sha512t24.size()))
+		key.assign(parsed.sha512t24.begin(), parsed.sha512t24.end());
+	else
+		return false;
+
+	if (!digest_index_built)
+		build_digest_index();
+
+	auto range = digest_index.equal_range(key);
+
+	for (auto p = range.first; p != range.second; ++p)
+		v_sample_contig.emplace_back(sample_desc[p->second.first].name, p->second.second);
+
+	return true;
+}
+
 // EOF
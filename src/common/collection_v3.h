@@ -13,23 +13,31 @@
 
 #include "collection.h"
 #include "archive.h"
+#include "thread_pool.h"
+#include <unordered_set>
 
 class CCollection_V3 : public CCollection
 {
 	struct contig_desc_t {
 		string name;
 		vector<segment_desc_t> segments;
+		contig_stats_t stats;
+		contig_digest_t digest;
 
 		contig_desc_t() : name("") {};
 		
 		contig_desc_t(const contig_desc_t& x) {
 			name = x.name;
 			segments = x.segments;
+			stats = x.stats;
+			digest = x.digest;
 		}
 
 		contig_desc_t(contig_desc_t&& x) noexcept {
 			name = move(x.name);
 			segments = move(x.segments);
+			stats = x.stats;
+			digest = x.digest;
 		}
 
 		contig_desc_t(const string& _name) : name(_name) {};
@@ -38,6 +46,8 @@ class CCollection_V3 : public CCollection
 		{
 			name = x.name;
 			segments = x.segments;
+			stats = x.stats;
+			digest = x.digest;
 
 			return *this;
 		}
@@ -46,6 +56,8 @@ class CCollection_V3 : public CCollection
 		{
 			name = move(x.name);
 			segments = move(x.segments);
+			stats = x.stats;
+			digest = x.digest;
 
 			return *this;
 		}
@@ -85,18 +97,30 @@ class CCollection_V3 : public CCollection
 
 	ZSTD_CCtx* zstd_cctx_samples = nullptr;
 	ZSTD_CCtx* zstd_cctx_contigs = nullptr;
+	ZSTD_CCtx* zstd_cctx_stats = nullptr;
 	array<ZSTD_CCtx*, 5> zstd_cctx_details = { nullptr, nullptr, nullptr, nullptr, nullptr };
 	
 	ZSTD_DCtx* zstd_dctx_samples = nullptr;
 	ZSTD_DCtx* zstd_dctx_contigs = nullptr;
+	ZSTD_DCtx* zstd_dctx_stats = nullptr;
 	array<ZSTD_DCtx*, 5> zstd_dctx_details = { nullptr, nullptr, nullptr, nullptr, nullptr };
 
 	unordered_map<string, uint32_t, MurMurStringsHash> sample_ids;
 	vector<sample_desc_t> sample_desc;
 
 	int unpacked_contig_data_batch_id = -1;
+	int unpacked_contig_stats_batch_id = -1;
+	int unpacked_contig_digests_batch_id = -1;
+
+	// Removed samples are kept in batches (as their ids are positions), but cannot be found by name
+	unordered_set<uint32_t> removed_sample_ids;
+
+	// Built on first lookup: raw digest (MD5 or SHA512t24) -> (sample, contig)
+	bool digest_index_built = false;
+	unordered_multimap<string, pair<uint32_t, string>> digest_index;
 
 	uint32_t no_threads;
+	shared_ptr<CThreadPool> thread_pool;
 
 	size_t batch_size;
 	uint32_t segment_size;
@@ -110,6 +134,10 @@ class CCollection_V3 : public CCollection
 	int collection_samples_id;
 	int collection_contig_id;
 	int collection_details_id;
+	int collection_stats_id;
+	bool stats_enabled;
+	int collection_digests_id;
+	bool digests_enabled;
 
 	shared_ptr<CArchive> in_archive;
 	shared_ptr<CArchive> out_archive;
@@ -118,19 +146,31 @@ class CCollection_V3 : public CCollection
 	void store_batch_sample_names();
 	void store_batch_contig_names(uint32_t id_from, uint32_t id_to);
 	void store_batch_contig_details(uint32_t id_from, uint32_t id_to);
+	void store_batch_contig_stats(uint32_t id_from, uint32_t id_to);
+	void store_batch_contig_digests(uint32_t id_from, uint32_t id_to);
 
 	void load_batch_sample_names();
+	void load_removed_samples();
 	void load_batch_contig_names(size_t id_batch);
 	void load_batch_contig_details(size_t id_batch);
+	void load_batch_contig_stats(size_t id_batch);
+	bool ensure_sample_stats(const size_t sample_id);
+	void load_batch_contig_digests(size_t id_batch);
+	bool ensure_sample_digests(const size_t sample_id);
+	void build_digest_index();
 	void clear_batch_contig(size_t id_batch);
 
-	void serialize_sample_names(vector<uint8_t> &v_data);
+	void serialize_sample_names(vector<uint8_t> &v_data, const size_t no_samples);
 	void serialize_contig_names(vector<uint8_t>& v_data, uint32_t id_from, uint32_t id_to);
 	void serialize_contig_details(array<vector<uint8_t>, 5>& v_data, uint32_t id_from, uint32_t id_to);
+	void serialize_contig_stats(vector<uint8_t>& v_data, uint32_t id_from, uint32_t id_to);
+	void serialize_contig_digests(vector<uint8_t>& v_data, uint32_t id_from, uint32_t id_to);
 
 	void deserialize_sample_names(vector<uint8_t>& v_data);
 	void deserialize_contig_names(vector<uint8_t>& v_data, size_t i_sample);
 	void deserialize_contig_details(array<vector<uint8_t>, 5>& v_data, size_t i_sample);
+	void deserialize_contig_stats(vector<uint8_t>& v_data, size_t i_sample);
+	void deserialize_contig_digests(vector<uint8_t>& v_data, size_t i_sample);
 
 	bool prepare_for_compression();
 	bool prepare_for_appending_copy();
@@ -215,6 +255,10 @@ public:
 		collection_samples_id = -1;
 		collection_contig_id = -1;
 		collection_details_id = -1;
+		collection_stats_id = -1;
+		stats_enabled = false;
+		collection_digests_id = -1;
+		digests_enabled = false;
 
 		placing_sample_id = ~0u;
 		placing_sample_name = "";
@@ -226,11 +270,13 @@ public:
 	virtual ~CCollection_V3() {
 		if (zstd_cctx_samples)	ZSTD_freeCCtx(zstd_cctx_samples);
 		if (zstd_cctx_contigs)	ZSTD_freeCCtx(zstd_cctx_contigs);
+		if (zstd_cctx_stats)	ZSTD_freeCCtx(zstd_cctx_stats);
 		for(auto &x : zstd_cctx_details)
 			if (x)	ZSTD_freeCCtx(x);
 
 		if (zstd_dctx_samples)	ZSTD_freeDCtx(zstd_dctx_samples);
 		if (zstd_dctx_contigs)	ZSTD_freeDCtx(zstd_dctx_contigs);
+		if (zstd_dctx_stats)	ZSTD_freeDCtx(zstd_dctx_stats);
 		for(auto &x : zstd_dctx_details)
 			if (x)	ZSTD_freeDCtx(x);
 	};
@@ -238,8 +284,14 @@ public:
 	bool set_archives(shared_ptr<CArchive> _in_archive, shared_ptr<CArchive> _out_archive,
 		uint32_t _no_threads, size_t _batch_size, uint32_t _segment_size, uint32_t _kmer_length);
 
+	void set_thread_pool(shared_ptr<CThreadPool> _thread_pool);
+
 	void complete_serialization();
 
+	// Metadata of the first no_samples samples (as stored by complete_serialization() and the pending store_contig_batch()),
+	// without changing the state of the collection
+	void store_checkpoint(const uint32_t no_samples);
+
 	bool prepare_for_appending_load_last_batch();
 
 	virtual bool register_sample_contig(const string& sample_name, const string& contig_name);
@@ -257,7 +309,22 @@ public:
 	virtual size_t get_no_samples();
 	virtual int32_t get_no_contigs(const string& sample_name);
 
+	virtual bool has_contig_stats();
+	virtual void set_contig_stats(const string& sample_name, const string& contig_name, const contig_stats_t& stats);
+	virtual bool get_contig_stats(const string& sample_name, const string& contig_name, contig_stats_t& stats);
+	virtual bool get_sample_stats(const string& sample_name, vector<pair<string, contig_stats_t>>& v_stats);
+
+	virtual bool has_contig_digests();
+	virtual void set_contig_digest(const string& sample_name, const string& contig_name, const contig_digest_t& digest);
+	virtual bool get_contig_digest(const string& sample_name, const string& contig_name, contig_digest_t& digest);
+	virtual bool get_sample_digests(const string& sample_name, vector<pair<string, contig_digest_t>>& v_digests);
+	virtual bool find_contigs_by_digest(const string& digest, vector<pair<string, string>>& v_sample_contig);
+
 	void store_contig_batch(uint32_t id_from, uint32_t id_to);
+
+	virtual bool remove_sample(const string& sample_name);
+	virtual size_t get_no_removed_samples();
+	void serialize_removed_samples(vector<uint8_t>& v_data);
 };
 
 // EOF
@@ -0,0 +1,523 @@
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include "cpu_dispatch.h"
+#include <bit>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_AMD64)
+#define CPU_X64
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TARGET(x)
+#else
+#define TARGET(x) __attribute__((target(x)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define CPU_ARM
+#include <arm_neon.h>
+#include <refresh/string_operations/lib/string_operations.h>
+#endif
+
+// *******************************************************************************************
+// Generic kernels (also used for parts of data not handled by vector instructions)
+// *******************************************************************************************
+
+// *******************************************************************************************
+static size_t matching_length_generic(const uint8_t* p, const uint8_t* q, size_t max_len)
+{
+	size_t len = 0;
+
+	// 8 symbols at once; the first difference is given by the lowest differing byte
+	if constexpr (endian::native == endian::little)
+		for (; len + 8 <= max_len; len += 8)
+		{
+			uint64_t x, y;
+			memcpy(&x, p + len, 8);
+			memcpy(&y, q + len, 8);
+
+			if (x != y)
+				return len + countr_zero(x ^ y) / 8;
+		}
+
+	for (; len < max_len && p[len] == q[len]; ++len)
+		;
+
+	return len;
+}
+
+// *******************************************************************************************
+static void num_to_alpha_generic(const uint8_t* src, uint8_t* dst, size_t size, const uint8_t* cnv_num)
+{
+	for (size_t i = 0; i < size; ++i)
+		dst[i] = cnv_num[src[i]];
+}
+
+// *******************************************************************************************
+static size_t pack_raw_block(uint8_t* ctg, size_t in_pos, const size_t in_end, size_t out_pos, const uint8_t* cnv_num)
+{
+	for (; in_pos < in_end; ++in_pos)
+	{
+		uint8_t c = ctg[in_pos];
+		if (c >> 6)                          // (c >= 64)
+			ctg[out_pos++] = cnv_num[c];
+	}
+
+	return out_pos;
+}
+
+// *******************************************************************************************
+static size_t pack_raw_contig_generic(uint8_t* ctg, size_t size, const uint8_t* cnv_num)
+{
+	return pack_raw_block(ctg, 0, size, 0, cnv_num);
+}
+
+// *******************************************************************************************
+// Codes of A, C, G, T (in both cases) indexed by low nibbles of letters (A - 1, C - 3, G - 7, T - 4).
+// Blocks of raw data containing only these letters (the vast majority) are converted by vector shuffles.
+static void acgt_lut(const uint8_t* cnv_num, uint8_t* lut)
+{
+	fill_n(lut, 16, 0);
+
+	for (uint8_t c : { 'A', 'C', 'G', 'T' })
+		lut[c & 0x0f] = cnv_num[c];
+}
+
+#if defined(CPU_X64)
+// *******************************************************************************************
+// SSE4.2 kernels
+// *******************************************************************************************
+
+// *******************************************************************************************
+TARGET("sse4.2") static size_t matching_length_sse42(const uint8_t* p, const uint8_t* q, size_t max_len)
+{
+	size_t len = 0;
+
+	for (; len + 16 <= max_len; len += 16)
+	{
+		const __m128i x = _mm_loadu_si128((const __m128i*) (p + len));
+		const __m128i y = _mm_loadu_si128((const __m128i*) (q + len));
+
+		uint32_t m = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xffffu;
+
+		if (m)
+			return len + countr_zero(m);
+	}
+
+	return len + matching_length_generic(p + len, q + len, max_len - len);
+}
+
+// *******************************************************************************************
+TARGET("sse4.2") static void num_to_alpha_sse42(const uint8_t* src, uint8_t* dst, size_t size, const uint8_t* cnv_num)
+{
+	const __m128i lut = _mm_loadu_si128((const __m128i*) cnv_num);
+	const __m128i max_code = _mm_set1_epi8(15);
+	size_t i = 0;
+
+	for (; i + 16 <= size; i += 16)
+	{
+		const __m128i x = _mm_loadu_si128((const __m128i*) (src + i));
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(x, max_code), max_code)) == 0xffff)
+			_mm_storeu_si128((__m128i*) (dst + i), _mm_shuffle_epi8(lut, x));
+		else
+			num_to_alpha_generic(src + i, dst + i, 16, cnv_num);
+	}
+
+	num_to_alpha_generic(src + i, dst + i, size - i, cnv_num);
+}
+
+// *******************************************************************************************
+TARGET("sse4.2") static size_t pack_raw_contig_sse42(uint8_t* ctg, size_t size, const uint8_t* cnv_num)
+{
+	uint8_t lut_bytes[16];
+	acgt_lut(cnv_num, lut_bytes);
+
+	const __m128i lut = _mm_loadu_si128((const __m128i*) lut_bytes);
+	const __m128i case_bit = _mm_set1_epi8(0x20);
+	const __m128i low_nibble = _mm_set1_epi8(0x0f);
+	const __m128i va = _mm_set1_epi8('a');
+	const __m128i vc = _mm_set1_epi8('c');
+	const __m128i vg = _mm_set1_epi8('g');
+	const __m128i vt = _mm_set1_epi8('t');
+
+	size_t in_pos = 0;
+	size_t out_pos = 0;
+
+	for (; in_pos + 16 <= size; in_pos += 16)
+	{
+		const __m128i x = _mm_loadu_si128((const __m128i*) (ctg + in_pos));
+		const __m128i y = _mm_or_si128(x, case_bit);
+		const __m128i acgt = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(y, va), _mm_cmpeq_epi8(y, vc)), _mm_or_si128(_mm_cmpeq_epi8(y, vg), _mm_cmpeq_epi8(y, vt)));
+
+		if (_mm_movemask_epi8(acgt) == 0xffff)
+		{
+			_mm_storeu_si128((__m128i*) (ctg + out_pos), _mm_shuffle_epi8(lut, _mm_and_si128(x, low_nibble)));
+			out_pos += 16;
+		}
+		else
+			out_pos = pack_raw_block(ctg, in_pos, in_pos + 16, out_pos, cnv_num);
+	}
+
+	return pack_raw_block(ctg, in_pos, size, out_pos, cnv_num);
+}
+
+// *******************************************************************************************
+// AVX2 kernels
+// *******************************************************************************************
+
+// *******************************************************************************************
+TARGET("avx2") static size_t matching_length_avx2(const uint8_t* p, const uint8_t* q, size_t max_len)
+{
+	size_t len = 0;
+
+	for (; len + 32 <= max_len; len += 32)
+	{
+		const __m256i x = _mm256_loadu_si256((const __m256i*) (p + len));
+		const __m256i y = _mm256_loadu_si256((const __m256i*) (q + len));
+
+		uint32_t m = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+
+		if (m)
+			return len + countr_zero(m);
+	}
+
+	return len + matching_length_generic(p + len, q + len, max_len - len);
+}
+
+// *******************************************************************************************
+TARGET("avx2") static void num_to_alpha_avx2(const uint8_t* src, uint8_t* dst, size_t size, const uint8_t* cnv_num)
+{
+	const __m256i lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) cnv_num));
+	const __m256i max_code = _mm256_set1_epi8(15);
+	size_t i = 0;
+
+	for (; i + 32 <= size; i += 32)
+	{
+		const __m256i x = _mm256_loadu_si256((const __m256i*) (src + i));
+
+		if (~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(x, max_code), max_code)) == 0)
+			_mm256_storeu_si256((__m256i*) (dst + i), _mm256_shuffle_epi8(lut, x));
+		else
+			num_to_alpha_generic(src + i, dst + i, 32, cnv_num);
+	}
+
+	num_to_alpha_generic(src + i, dst + i, size - i, cnv_num);
+}
+
+// *******************************************************************************************
+TARGET("avx2") static size_t pack_raw_contig_avx2(uint8_t* ctg, size_t size, const uint8_t* cnv_num)
+{
+	uint8_t lut_bytes[16];
+	acgt_lut(cnv_num, lut_bytes);
+
+	const __m256i lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) lut_bytes));
+	const __m256i case_bit = _mm256_set1_epi8(0x20);
+	const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+	const __m256i va = _mm256_set1_epi8('a');
+	const __m256i vc = _mm256_set1_epi8('c');
+	const __m256i vg = _mm256_set1_epi8('g');
+	const __m256i vt = _mm256_set1_epi8('t');
+
+	size_t in_pos = 0;
+	size_t out_pos = 0;
+
+	for (; in_pos + 32 <= size; in_pos += 32)
+	{
+		const __m256i x = _mm256_loadu_si256((const __m256i*) (ctg + in_pos));
+		const __m256i y = _mm256_or_si256(x, case_bit);
+		const __m256i acgt = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(y, va), _mm256_cmpeq_epi8(y, vc)), _mm256_or_si256(_mm256_cmpeq_epi8(y, vg), _mm256_cmpeq_epi8(y, vt)));
+
+		if (~(uint32_t) _mm256_movemask_epi8(acgt) == 0)
+		{
+			_mm256_storeu_si256((__m256i*) (ctg + out_pos), _mm256_shuffle_epi8(lut, _mm256_and_si256(x, low_nibble)));
+			out_pos += 32;
+		}
+		else
+			out_pos = pack_raw_block(ctg, in_pos, in_pos + 32, out_pos, cnv_num);
+	}
+
+	return pack_raw_block(ctg, in_pos, size, out_pos, cnv_num);
+}
+
+// *******************************************************************************************
+// AVX-512 kernels
+// *******************************************************************************************
+
+// *******************************************************************************************
+TARGET("avx512f,avx512bw") static size_t matching_length_avx512(const uint8_t* p, const uint8_t* q, size_t max_len)
+{
+	size_t len = 0;
+
+	for (; len + 64 <= max_len; len += 64)
+	{
+		const __m512i x = _mm512_loadu_si512((const void*) (p + len));
+		const __m512i y = _mm512_loadu_si512((const void*) (q + len));
+
+		uint64_t m = _mm512_cmpneq_epi8_mask(x, y);
+
+		if (m)
+			return len + countr_zero(m);
+	}
+
+	return len + matching_length_generic(p + len, q + len, max_len - len);
+}
+
+// *******************************************************************************************
+TARGET("avx512f,avx512bw") static void num_to_alpha_avx512(const uint8_t* src, uint8_t* dst, size_t size, const uint8_t* cnv_num)
+{
+	uint8_t lut_bytes[64];
+	for (int i = 0; i < 4; ++i)
+		memcpy(lut_bytes + 16 * i, cnv_num, 16);
+
+	const __m512i lut = _mm512_loadu_si512((const void*) lut_bytes);
+	const __m512i max_code = _mm512_set1_epi8(15);
+	size_t i = 0;
+
+	for (; i + 64 <= size; i += 64)
+	{
+		const __m512i x = _mm512_loadu_si512((const void*) (src + i));
+
+		if (_mm512_cmpgt_epu8_mask(x, max_code) == 0)
+			_mm512_storeu_si512((void*) (dst + i), _mm512_shuffle_epi8(lut, x));
+		else
+			num_to_alpha_generic(src + i, dst + i, 64, cnv_num);
+	}
+
+	num_to_alpha_generic(src + i, dst + i, size - i, cnv_num);
+}
+#endif
+
+#if defined(CPU_ARM)
+// *******************************************************************************************
+// NEON kernels
+// *******************************************************************************************
+
+// *******************************************************************************************
+static size_t matching_length_neon(const uint8_t* p, const uint8_t* q, size_t max_len)
+{
+	return refresh::details::matching_length_neon(p, q, max_len);
+}
+
+// *******************************************************************************************
+static void num_to_alpha_neon(const uint8_t* src, uint8_t* dst, size_t size, const uint8_t* cnv_num)
+{
+	const uint8x16_t lut = vld1q_u8(cnv_num);
+	size_t i = 0;
+
+	for (; i + 16 <= size; i += 16)
+	{
+		const uint8x16_t x = vld1q_u8(src + i);
+
+		if (vmaxvq_u8(x) <= 15)
+			vst1q_u8(dst + i, vqtbl1q_u8(lut, x));
+		else
+			num_to_alpha_generic(src + i, dst + i, 16, cnv_num);
+	}
+
+	num_to_alpha_generic(src + i, dst + i, size - i, cnv_num);
+}
+
+// *******************************************************************************************
+static size_t pack_raw_contig_neon(uint8_t* ctg, size_t size, const uint8_t* cnv_num)
+{
+	uint8_t lut_bytes[16];
+	acgt_lut(cnv_num, lut_bytes);
+
+	const uint8x16_t lut = vld1q_u8(lut_bytes);
+	const uint8x16_t case_bit = vdupq_n_u8(0x20);
+	const uint8x16_t low_nibble = vdupq_n_u8(0x0f);
+	const uint8x16_t va = vdupq_n_u8('a');
+	const uint8x16_t vc = vdupq_n_u8('c');
+	const uint8x16_t vg = vdupq_n_u8('g');
+	const uint8x16_t vt = vdupq_n_u8('t');
+
+	size_t in_pos = 0;
+	size_t out_pos = 0;
+
+	for (; in_pos + 16 <= size; in_pos += 16)
+	{
+		const uint8x16_t x = vld1q_u8(ctg + in_pos);
+		const uint8x16_t y = vorrq_u8(x, case_bit);
+		const uint8x16_t acgt = vorrq_u8(vorrq_u8(vceqq_u8(y, va), vceqq_u8(y, vc)), vorrq_u8(vceqq_u8(y, vg), vceqq_u8(y, vt)));
+
+		if (vminvq_u8(acgt) == 0xff)
+		{
+			vst1q_u8(ctg + out_pos, vqtbl1q_u8(lut, vandq_u8(x, low_nibble)));
+			out_pos += 16;
+		}
+		else
+			out_pos = pack_raw_block(ctg, in_pos, in_pos + 16, out_pos, cnv_num);
+	}
+
+	return pack_raw_block(ctg, in_pos, size, out_pos, cnv_num);
+}
+#endif
+
+// *******************************************************************************************
+// Dispatcher
+// *******************************************************************************************
+
+// *******************************************************************************************
+CCpuDispatch::CCpuDispatch()
+{
+	detect();
+
+	cpu_level_t sel_level = detected_level;
+
+	// Only levels supported by the CPU can be requested
+	const char* env = getenv("AGC_CPU");
+
+	if (env)
+		for (auto x : { cpu_level_t::generic, cpu_level_t::sse42, cpu_level_t::avx2, cpu_level_t::avx512, cpu_level_t::neon })
+		{
+			bool supported = x == cpu_level_t::generic || (detected_level == cpu_level_t::neon ? x == cpu_level_t::neon : x <= detected_level);
+
+			if (LevelName(x) == env && supported)
+				sel_level = x;
+		}
+
+	select(sel_level);
+}
+
+// *******************************************************************************************
+const CCpuDispatch& CCpuDispatch::Instance()
+{
+	static CCpuDispatch instance;
+
+	return instance;
+}
+
+// *******************************************************************************************
+void CCpuDispatch::detect()
+{
+#if defined(CPU_X64)
+	bool sse42, avx2, avx512;
+
+#if defined(_MSC_VER) && !defined(__clang__)
+	int regs[4];
+
+	__cpuid(regs, 0);
+	int max_leaf = regs[0];
+
+	__cpuid(regs, 1);
+	sse42 = regs[2] & (1 << 20);
+
+	// AVX state must be enabled by OS (OSXSAVE + XCR0)
+	bool os_avx = (regs[2] & (1 << 27)) && (regs[2] & (1 << 28)) && (_xgetbv(0) & 0x06) == 0x06;
+	bool os_avx512 = os_avx && (_xgetbv(0) & 0xe6) == 0xe6;
+
+	avx2 = avx512 = false;
+
+	if (max_leaf >= 7)
+	{
+		__cpuidex(regs, 7, 0);
+		avx2 = os_avx && (regs[1] & (1 << 5));
+		avx512 = os_avx512 && (regs[1] & (1 << 16)) && (regs[1] & (1 << 30));
+	}
+#else
+	__builtin_cpu_init();
+
+	sse42 = __builtin_cpu_supports("sse4.2");
+	avx2 = __builtin_cpu_supports("avx2");
+	avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+
+	if (sse42)
+		v_features.emplace_back("sse4.2");
+	if (avx2)
+		v_features.emplace_back("avx2");
+	if (avx512)
+		v_features.emplace_back("avx512f+bw");
+
+	if (sse42 && avx2 && avx512)
+		detected_level = cpu_level_t::avx512;
+	else if (sse42 && avx2)
+		detected_level = cpu_level_t::avx2;
+	else if (sse42)
+		detected_level = cpu_level_t::sse42;
+#elif defined(CPU_ARM)
+	// NEON is obligatory in AArch64
+	v_features.emplace_back("neon");
+	detected_level = cpu_level_t::neon;
+#endif
+}
+
+// *******************************************************************************************
+void CCpuDispatch::select(const cpu_level_t _level)
+{
+	level = _level;
+
+	matching_length = matching_length_generic;
+	num_to_alpha = num_to_alpha_generic;
+	pack_raw_contig = pack_raw_contig_generic;
+	names = { "generic", "generic", "generic" };
+
+#if defined(CPU_X64)
+	if (level >= cpu_level_t::sse42)
+	{
+		matching_length = matching_length_sse42;
+		num_to_alpha = num_to_alpha_sse42;
+		pack_raw_contig = pack_raw_contig_sse42;
+		names = { "sse4.2", "sse4.2", "sse4.2" };
+	}
+
+	if (level >= cpu_level_t::avx2)
+	{
+		matching_length = matching_length_avx2;
+		num_to_alpha = num_to_alpha_avx2;
+		pack_raw_contig = pack_raw_contig_avx2;
+		names = { "avx2", "avx2", "avx2" };
+	}
+
+	// Raw FASTA lines are usually shorter than 64 symbols, so wider blocks would be mostly handled by generic code
+	if (level >= cpu_level_t::avx512)
+	{
+		matching_length = matching_length_avx512;
+		num_to_alpha = num_to_alpha_avx512;
+		names = { "avx512", "avx512", "avx2" };
+	}
+#elif defined(CPU_ARM)
+	if (level == cpu_level_t::neon)
+	{
+		matching_length = matching_length_neon;
+		num_to_alpha = num_to_alpha_neon;
+		pack_raw_contig = pack_raw_contig_neon;
+		names = { "neon", "neon", "neon" };
+	}
+#endif
+}
+
+// *******************************************************************************************
+string CCpuDispatch::LevelName(const cpu_level_t _level)
+{
+	switch (_level)
+	{
+	case cpu_level_t::sse42:	return "sse4.2";
+	case cpu_level_t::avx2:		return "avx2";
+	case cpu_level_t::avx512:	return "avx512";
+	case cpu_level_t::neon:		return "neon";
+	default:					return "generic";
+	}
+}
+
+// *******************************************************************************************
+vector<pair<string, string>> CCpuDispatch::GetKernels() const
+{
+	return {
+		{ "match extension (LZ diff)", names.matching_length },
+		{ "codes to letters (decompression)", names.num_to_alpha },
+		{ "raw FASTA packing (compression)", names.pack_raw_contig } };
+}
+
+// EOF
@@ -0,0 +1,87 @@
+#ifndef _CPU_DISPATCH_H
+#define _CPU_DISPATCH_H
+
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// *******************************************************************************************
+// Instruction sets for which variants of kernels are compiled
+enum class cpu_level_t { generic, sse42, avx2, avx512, neon };
+
+// *******************************************************************************************
+// Runtime dispatch of hot kernels, so a single (portable) binary uses the vector extensions of the CPU
+//   * variants are compiled with function target attributes, independently of the build flags
+//   * the best variant supported by the CPU (and OS) is chosen at the first use
+//   * AGC_CPU environment variable (generic, sse4.2, avx2, avx512) can lower the level, e.g., for benchmarking
+class CCpuDispatch
+{
+public:
+	// Length of common prefix of p and q (at most max_len)
+	using matching_length_t = size_t (*)(const uint8_t* p, const uint8_t* q, size_t max_len);
+
+	// Numeric codes to letters (dst == src is allowed)
+	using num_to_alpha_t = void (*)(const uint8_t* src, uint8_t* dst, size_t size, const uint8_t* cnv_num);
+
+	// Removal of non-letters (EOLs etc.) from raw FASTA data and conversion to numeric codes (in place); returns new size
+	using pack_raw_contig_t = size_t (*)(uint8_t* ctg, size_t size, const uint8_t* cnv_num);
+
+private:
+	cpu_level_t detected_level = cpu_level_t::generic;
+	cpu_level_t level = cpu_level_t::generic;
+	vector<string> v_features;
+
+	struct kernel_names_t {
+		const char* matching_length;
+		const char* num_to_alpha;
+		const char* pack_raw_contig;
+	} names;
+
+	CCpuDispatch();
+
+	void detect();
+	void select(const cpu_level_t _level);
+
+public:
+	matching_length_t matching_length;
+	num_to_alpha_t num_to_alpha;
+	pack_raw_contig_t pack_raw_contig;
+
+	static const CCpuDispatch& Instance();
+
+	static string LevelName(const cpu_level_t _level);
+
+	cpu_level_t GetLevel() const
+	{
+		return level;
+	}
+
+	cpu_level_t GetDetectedLevel() const
+	{
+		return detected_level;
+	}
+
+	const vector<string>& GetFeatures() const
+	{
+		return v_features;
+	}
+
+	// Pairs: kernel description, name of the selected variant
+	vector<pair<string, string>> GetKernels() const;
+};
+
+// EOF
+#endif
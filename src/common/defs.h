@@ -28,6 +28,10 @@ const string AGC_VER_BUILD = "20241125.1"s;
 const uint32_t AGC_FILE_MAJOR = 3;
 const uint32_t AGC_FILE_MINOR = 0;
 
+// Minor file version of archives using extensions of the pack format: seekable packs, non-uniform pack layout
+// (written only if any extension is used, so that default archives remain readable by older releases)
+const uint32_t AGC_FILE_MINOR_PACK_EXT = 1;
+
 const std::string AGC_VERSION = std::string("AGC (Assembled Genomes Compressor) v. ") + 
 	to_string(AGC_VER_MAJOR) + "." + to_string(AGC_VER_MINOR) + "." + to_string(AGC_VER_BUGFIX) +
 	" [build " + AGC_VER_BUILD + "]";
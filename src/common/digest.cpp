@@ -0,0 +1,493 @@
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include "digest.h"
+#include <cstring>
+#include <algorithm>
+
+// *******************************************************************************************
+namespace
+{
+	const uint32_t md5_k[64] = {
+		0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+		0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+		0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+		0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+		0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+		0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+		0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+		0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391 };
+
+	const uint32_t md5_r[64] = {
+		7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+		5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+		4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+		6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21 };
+
+	const uint64_t sha512_k[80] = {
+		0x428a2f98d728ae22ull, 0x7137449123ef65cdull, 0xb5c0fbcfec4d3b2full, 0xe9b5dba58189dbbcull,
+		0x3956c25bf348b538ull, 0x59f111f1b605d019ull, 0x923f82a4af194f9bull, 0xab1c5ed5da6d8118ull,
+		0xd807aa98a3030242ull, 0x12835b0145706fbeull, 0x243185be4ee4b28cull, 0x550c7dc3d5ffb4e2ull,
+		0x72be5d74f27b896full, 0x80deb1fe3b1696b1ull, 0x9bdc06a725c71235ull, 0xc19bf174cf692694ull,
+		0xe49b69c19ef14ad2ull, 0xefbe4786384f25e3ull, 0x0fc19dc68b8cd5b5ull, 0x240ca1cc77ac9c65ull,
+		0x2de92c6f592b0275ull, 0x4a7484aa6ea6e483ull, 0x5cb0a9dcbd41fbd4ull, 0x76f988da831153b5ull,
+		0x983e5152ee66dfabull, 0xa831c66d2db43210ull, 0xb00327c898fb213full, 0xbf597fc7beef0ee4ull,
+		0xc6e00bf33da88fc2ull, 0xd5a79147930aa725ull, 0x06ca6351e003826full, 0x142929670a0e6e70ull,
+		0x27b70a8546d22ffcull, 0x2e1b21385c26c926ull, 0x4d2c6dfc5ac42aedull, 0x53380d139d95b3dfull,
+		0x650a73548baf63deull, 0x766a0abb3c77b2a8ull, 0x81c2c92e47edaee6ull, 0x92722c851482353bull,
+		0xa2bfe8a14cf10364ull, 0xa81a664bbc423001ull, 0xc24b8b70d0f89791ull, 0xc76c51a30654be30ull,
+		0xd192e819d6ef5218ull, 0xd69906245565a910ull, 0xf40e35855771202aull, 0x106aa07032bbd1b8ull,
+		0x19a4c116b8d2d0c8ull, 0x1e376c085141ab53ull, 0x2748774cdf8eeb99ull, 0x34b0bcb5e19b48a8ull,
+		0x391c0cb3c5c95a63ull, 0x4ed8aa4ae3418acbull, 0x5b9cca4f7763e373ull, 0x682e6ff3d6b2b8a3ull,
+		0x748f82ee5defb2fcull, 0x78a5636f43172f60ull, 0x84c87814a1f0ab72ull, 0x8cc702081a6439ecull,
+		0x90befffa23631e28ull, 0xa4506cebde82bde9ull, 0xbef9a3f7b2c67915ull, 0xc67178f2e372532bull,
+		0xca273eceea26619cull, 0xd186b8c721c0c207ull, 0xeada7dd6cde0eb1eull, 0xf57d4f7fee6ed178ull,
+		0x06f067aa72176fbaull, 0x0a637dc5a2c898a6ull, 0x113f9804bef90daeull, 0x1b710b35131c471bull,
+		0x28db77f523047d84ull, 0x32caab7b40c72493ull, 0x3c9ebe0a15c9bebcull, 0x431d67c49c100d4cull,
+		0x4cc5d4becb3e42b6ull, 0x597f299cfc657e2aull, 0x5fcb6fab3ad6faecull, 0x6c44198c4a475817ull };
+
+	const char hex_digits[] = "0123456789abcdef";
+	const char base64url_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+	inline uint32_t rotl32(const uint32_t x, const uint32_t n)
+	{
+		return (x << n) | (x >> (32 - n));
+	}
+
+	inline uint64_t rotr64(const uint64_t x, const uint32_t n)
+	{
+		return (x >> n) | (x << (64 - n));
+	}
+
+	const uint64_t xxh_p1 = 0x9E3779B185EBCA87ull;
+	const uint64_t xxh_p2 = 0xC2B2AE3D27D4EB4Full;
+	const uint64_t xxh_p3 = 0x165667B19E3779F9ull;
+	const uint64_t xxh_p4 = 0x85EBCA77C2B2AE63ull;
+	const uint64_t xxh_p5 = 0x27D4EB2F165667C5ull;
+
+	inline uint64_t load64_le(const uint8_t* p)
+	{
+		uint64_t x = 0;
+		for (int i = 7; i >= 0; --i)
+			x = (x << 8) | p[i];
+
+		return x;
+	}
+
+	inline uint32_t load32_le(const uint8_t* p)
+	{
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	inline uint64_t xxh64_round(uint64_t acc, const uint64_t input)
+	{
+		acc += input * xxh_p2;
+		acc = rotr64(acc, 64 - 31);
+
+		return acc * xxh_p1;
+	}
+
+	inline uint64_t xxh64_merge_round(uint64_t acc, const uint64_t val)
+	{
+		acc ^= xxh64_round(0, val);
+
+		return acc * xxh_p1 + xxh_p4;
+	}
+}
+
+// *******************************************************************************************
+void CMD5::Reset()
+{
+	state = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+	buffer_filled = 0;
+	total_size = 0;
+}
+
+// *******************************************************************************************
+void CMD5::transform(const uint8_t* block)
+{
+	uint32_t w[16];
+
+	for (int i = 0; i < 16; ++i)
+		w[i] = (uint32_t)block[4 * i] | ((uint32_t)block[4 * i + 1] << 8) | ((uint32_t)block[4 * i + 2] << 16) | ((uint32_t)block[4 * i + 3] << 24);
+
+	uint32_t a = state[0];
+	uint32_t b = state[1];
+	uint32_t c = state[2];
+	uint32_t d = state[3];
+
+	for (int i = 0; i < 64; ++i)
+	{
+		uint32_t f;
+		int g;
+
+		if (i < 16)
+		{
+			f = (b & c) | (~b & d);
+			g = i;
+		}
+		else if (i < 32)
+		{
+			f = (d & b) | (~d & c);
+			g = (5 * i + 1) & 15;
+		}
+		else if (i < 48)
+		{
+			f = b ^ c ^ d;
+			g = (3 * i + 5) & 15;
+		}
+		else
+		{
+			f = c ^ (b | ~d);
+			g = (7 * i) & 15;
+		}
+
+		uint32_t t = d;
+		d = c;
+		c = b;
+		b = b + rotl32(a + f + md5_k[i] + w[g], md5_r[i]);
+		a = t;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+}
+
+// *******************************************************************************************
+void CMD5::Update(const uint8_t* data, size_t size)
+{
+	total_size += size;
+
+	if (buffer_filled)
+	{
+		size_t to_copy = min(size, buffer.size() - buffer_filled);
+		memcpy(buffer.data() + buffer_filled, data, to_copy);
+		buffer_filled += to_copy;
+		data += to_copy;
+		size -= to_copy;
+
+		if (buffer_filled < buffer.size())
+			return;
+
+		transform(buffer.data());
+		buffer_filled = 0;
+	}
+
+	for (; size >= buffer.size(); data += buffer.size(), size -= buffer.size())
+		transform(data);
+
+	memcpy(buffer.data(), data, size);
+	buffer_filled = size;
+}
+
+// *******************************************************************************************
+array<uint8_t, 16> CMD5::Final()
+{
+	uint64_t no_bits = total_size * 8;
+	uint8_t pad[72] = { 0x80 };
+	size_t pad_size = (buffer_filled < 56) ? 56 - buffer_filled : 120 - buffer_filled;
+
+	for (int i = 0; i < 8; ++i)
+		pad[pad_size + i] = (uint8_t)(no_bits >> (8 * i));
+
+	Update(pad, pad_size + 8);
+
+	array<uint8_t, 16> digest;
+
+	for (int i = 0; i < 16; ++i)
+		digest[i] = (uint8_t)(state[i / 4] >> (8 * (i % 4)));
+
+	Reset();
+
+	return digest;
+}
+
+// *******************************************************************************************
+void CSHA512::Reset()
+{
+	state = { 0x6a09e667f3bcc908ull, 0xbb67ae8584caa73bull, 0x3c6ef372fe94f82bull, 0xa54ff53a5f1d36f1ull,
+		0x510e527fade682d1ull, 0x9b05688c2b3e6c1full, 0x1f83d9abfb41bd6bull, 0x5be0cd19137e2179ull };
+	buffer_filled = 0;
+	total_size = 0;
+}
+
+// *******************************************************************************************
+void CSHA512::transform(const uint8_t* block)
+{
+	uint64_t w[80];
+
+	for (int i = 0; i < 16; ++i)
+	{
+		w[i] = 0;
+		for (int j = 0; j < 8; ++j)
+			w[i] = (w[i] << 8) | block[8 * i + j];
+	}
+
+	for (int i = 16; i < 80; ++i)
+	{
+		uint64_t s0 = rotr64(w[i - 15], 1) ^ rotr64(w[i - 15], 8) ^ (w[i - 15] >> 7);
+		uint64_t s1 = rotr64(w[i - 2], 19) ^ rotr64(w[i - 2], 61) ^ (w[i - 2] >> 6);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint64_t a = state[0];
+	uint64_t b = state[1];
+	uint64_t c = state[2];
+	uint64_t d = state[3];
+	uint64_t e = state[4];
+	uint64_t f = state[5];
+	uint64_t g = state[6];
+	uint64_t h = state[7];
+
+	for (int i = 0; i < 80; ++i)
+	{
+		uint64_t S1 = rotr64(e, 14) ^ rotr64(e, 18) ^ rotr64(e, 41);
+		uint64_t ch = (e & f) ^ (~e & g);
+		uint64_t t1 = h + S1 + ch + sha512_k[i] + w[i];
+		uint64_t S0 = rotr64(a, 28) ^ rotr64(a, 34) ^ rotr64(a, 39);
+		uint64_t maj = (a & b) ^ (a & c) ^ (b & c);
+		uint64_t t2 = S0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+// *******************************************************************************************
+void CSHA512::Update(const uint8_t* data, size_t size)
+{
+	total_size += size;
+
+	if (buffer_filled)
+	{
+		size_t to_copy = min(size, buffer.size() - buffer_filled);
+		memcpy(buffer.data() + buffer_filled, data, to_copy);
+		buffer_filled += to_copy;
+		data += to_copy;
+		size -= to_copy;
+
+		if (buffer_filled < buffer.size())
+			return;
+
+		transform(buffer.data());
+		buffer_filled = 0;
+	}
+
+	for (; size >= buffer.size(); data += buffer.size(), size -= buffer.size())
+		transform(data);
+
+	memcpy(buffer.data(), data, size);
+	buffer_filled = size;
+}
+
+// *******************************************************************************************
+// Message length is stored on 128 bits, but the upper half is always 0 here
+array<uint8_t, 64> CSHA512::Final()
+{
+	uint64_t no_bits = total_size * 8;
+	uint8_t pad[144] = { 0x80 };
+	size_t pad_size = (buffer_filled < 112) ? 128 - buffer_filled : 256 - buffer_filled;
+
+	for (int i = 0; i < 8; ++i)
+		pad[pad_size - 1 - i] = (uint8_t)(no_bits >> (8 * i));
+
+	Update(pad, pad_size);
+
+	array<uint8_t, 64> digest;
+
+	for (int i = 0; i < 64; ++i)
+		digest[i] = (uint8_t)(state[i / 8] >> (8 * (7 - i % 8)));
+
+	Reset();
+
+	return digest;
+}
+
+// *******************************************************************************************
+uint64_t xxh64(const uint8_t* data, const size_t size, const uint64_t seed)
+{
+	const uint8_t* p = data;
+	const uint8_t* p_end = data + size;
+	uint64_t h;
+
+	if (size >= 32)
+	{
+		uint64_t v1 = seed + xxh_p1 + xxh_p2;
+		uint64_t v2 = seed + xxh_p2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - xxh_p1;
+
+		for (; p + 32 <= p_end; p += 32)
+		{
+			v1 = xxh64_round(v1, load64_le(p));
+			v2 = xxh64_round(v2, load64_le(p + 8));
+			v3 = xxh64_round(v3, load64_le(p + 16));
+			v4 = xxh64_round(v4, load64_le(p + 24));
+		}
+
+		h = rotr64(v1, 64 - 1) + rotr64(v2, 64 - 7) + rotr64(v3, 64 - 12) + rotr64(v4, 64 - 18);
+		h = xxh64_merge_round(h, v1);
+		h = xxh64_merge_round(h, v2);
+		h = xxh64_merge_round(h, v3);
+		h = xxh64_merge_round(h, v4);
+	}
+	else
+		h = seed + xxh_p5;
+
+	h += (uint64_t)size;
+
+	for (; p + 8 <= p_end; p += 8)
+	{
+		h ^= xxh64_round(0, load64_le(p));
+		h = rotr64(h, 64 - 27) * xxh_p1 + xxh_p4;
+	}
+
+	if (p + 4 <= p_end)
+	{
+		h ^= (uint64_t)load32_le(p) * xxh_p1;
+		h = rotr64(h, 64 - 23) * xxh_p2 + xxh_p3;
+		p += 4;
+	}
+
+	for (; p < p_end; ++p)
+	{
+		h ^= (uint64_t)(*p) * xxh_p5;
+		h = rotr64(h, 64 - 11) * xxh_p1;
+	}
+
+	h ^= h >> 33;
+	h *= xxh_p2;
+	h ^= h >> 29;
+	h *= xxh_p3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+// *******************************************************************************************
+string digest_to_hex(const uint8_t* data, const size_t size)
+{
+	string str;
+
+	str.reserve(2 * size);
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		str.push_back(hex_digits[data[i] >> 4]);
+		str.push_back(hex_digits[data[i] & 15]);
+	}
+
+	return str;
+}
+
+// *******************************************************************************************
+// Without padding (size is a multiple of 3 for SHA512t24u)
+string digest_to_base64url(const uint8_t* data, const size_t size)
+{
+	string str;
+	uint32_t acc = 0;
+	int no_bits = 0;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		acc = (acc << 8) | data[i];
+		no_bits += 8;
+
+		while (no_bits >= 6)
+		{
+			no_bits -= 6;
+			str.push_back(base64url_digits[(acc >> no_bits) & 63]);
+		}
+	}
+
+	if (no_bits)
+		str.push_back(base64url_digits[(acc << (6 - no_bits)) & 63]);
+
+	return str;
+}
+
+// *******************************************************************************************
+bool digest_from_hex(const string& str, uint8_t* data, const size_t size)
+{
+	if (str.size() != 2 * size)
+		return false;
+
+	for (size_t i = 0; i < str.size(); ++i)
+	{
+		char c = str[i];
+		uint8_t x;
+
+		if (c >= '0' && c <= '9')
+			x = (uint8_t)(c - '0');
+		else if (c >= 'a' && c <= 'f')
+			x = (uint8_t)(c - 'a' + 10);
+		else if (c >= 'A' && c <= 'F')
+			x = (uint8_t)(c - 'A' + 10);
+		else
+			return false;
+
+		if (i % 2 == 0)
+			data[i / 2] = (uint8_t)(x << 4);
+		else
+			data[i / 2] |= x;
+	}
+
+	return true;
+}
+
+// *******************************************************************************************
+bool digest_from_base64url(const string& str, uint8_t* data, const size_t size)
+{
+	if (str.size() != (size * 8 + 5) / 6)
+		return false;
+
+	uint32_t acc = 0;
+	int no_bits = 0;
+	size_t pos = 0;
+
+	for (auto c : str)
+	{
+		auto p = strchr(base64url_digits, c);
+
+		if (c == 0 || !p)
+			return false;
+
+		acc = (acc << 6) | (uint32_t)(p - base64url_digits);
+		no_bits += 6;
+
+		if (no_bits >= 8)
+		{
+			no_bits -= 8;
+			if (pos < size)
+				data[pos++] = (uint8_t)(acc >> no_bits);
+		}
+	}
+
+	return pos == size;
+}
+
+// EOF
@@ -0,0 +1,77 @@
+#ifndef _DIGEST_H
+#define _DIGEST_H
+
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <string>
+
+using namespace std;
+
+// *******************************************************************************************
+// MD5 (RFC 1321)
+class CMD5
+{
+	array<uint32_t, 4> state;
+	array<uint8_t, 64> buffer;
+	size_t buffer_filled;
+	uint64_t total_size;
+
+	void transform(const uint8_t* block);
+
+public:
+	CMD5()
+	{
+		Reset();
+	}
+
+	void Reset();
+	void Update(const uint8_t* data, size_t size);
+	array<uint8_t, 16> Final();
+};
+
+// *******************************************************************************************
+// SHA-512 (FIPS 180-4)
+class CSHA512
+{
+	array<uint64_t, 8> state;
+	array<uint8_t, 128> buffer;
+	size_t buffer_filled;
+	uint64_t total_size;
+
+	void transform(const uint8_t* block);
+
+public:
+	CSHA512()
+	{
+		Reset();
+	}
+
+	void Reset();
+	void Update(const uint8_t* data, size_t size);
+	array<uint8_t, 64> Final();
+};
+
+// *******************************************************************************************
+// XXH64 (64-bit xxHash) - fast non-cryptographic checksum
+uint64_t xxh64(const uint8_t* data, const size_t size, const uint64_t seed = 0);
+
+// *******************************************************************************************
+// Textual forms of digests
+string digest_to_hex(const uint8_t* data, const size_t size);
+string digest_to_base64url(const uint8_t* data, const size_t size);
+bool digest_from_hex(const string& str, uint8_t* data, const size_t size);
+bool digest_from_base64url(const string& str, uint8_t* data, const size_t size);
+
+// EOF
+#endif
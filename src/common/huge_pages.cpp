@@ -0,0 +1,37 @@
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include "huge_pages.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// *******************************************************************************************
+bool CHugePages::Advise(void* ptr, size_t size)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	if (!IsEnabled() || ptr == nullptr || size < huge_page_size)
+		return false;
+
+	// Only the huge-page-aligned interior of the block can be backed by huge pages
+	uint64_t from = ((uint64_t)ptr + huge_page_size - 1) / huge_page_size * huge_page_size;
+	uint64_t to = ((uint64_t)ptr + size) / huge_page_size * huge_page_size;
+
+	if (from >= to)
+		return false;
+
+	return madvise((void*)from, (size_t)(to - from), MADV_HUGEPAGE) == 0;
+#else
+	return false;
+#endif
+}
+
+// EOF
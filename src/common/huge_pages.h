@@ -0,0 +1,46 @@
+#ifndef _HUGE_PAGES_H
+#define _HUGE_PAGES_H
+
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// *******************************************************************************************
+// Requests (transparent) huge pages for large, randomly accessed arrays.
+// The setting is process-wide, as the tables are allocated deeply in the internal classes (e.g., LZ-diff indexes).
+// If huge pages are unavailable (non-Linux system, THP disabled) the memory stays backed by regular pages.
+class CHugePages
+{
+	inline static atomic<bool> enabled{ false };
+
+public:
+	static constexpr size_t huge_page_size = 2ull << 20;
+
+	static void SetEnabled(const bool _enabled)
+	{
+		enabled = _enabled;
+	}
+
+	static bool IsEnabled()
+	{
+		return enabled.load(memory_order_relaxed);
+	}
+
+	// Must be called before the memory is touched; blocks smaller than a huge page are ignored
+	static bool Advise(void* ptr, size_t size);
+};
+
+// EOF
+#endif
@@ -16,6 +16,9 @@
 #include <string>
 #include <cstdint>
 #include <cstring>
+#include <mutex>
+#include <random>
+#include <filesystem>
 
 #include <iostream>
 
@@ -24,6 +27,7 @@ using namespace std;
 #ifndef _WIN32
 #define my_fseek	fseek
 #define my_ftell	ftell
+#include <fcntl.h>
 #else
 #define my_fseek	_fseeki64
 #define my_ftell	_ftelli64
@@ -232,6 +236,20 @@ public:
 		return true;
 	}
 
+	// *******************************************************************************************
+	// Hint for the OS that the range will be read soon (nothing to do if the whole file is buffered)
+	bool Advise(const size_t offset, const size_t size)
+	{
+#if defined(POSIX_FADV_WILLNEED)
+		if (!f || BUFFER_SIZE >= file_size)
+			return false;
+
+		return posix_fadvise(fileno(f), (off_t)offset, (off_t)size, POSIX_FADV_WILLNEED) == 0;
+#else
+		return false;
+#endif
+	}
+
 	// *******************************************************************************************
 	size_t FileSize() const
 	{
@@ -275,7 +293,8 @@ public:
 	}
 
 	// *******************************************************************************************
-	bool Open(const string &file_name, const size_t _BUFFER_SIZE = 8 << 20)
+	// append - data are written after the current end of the file
+	bool Open(const string &file_name, const size_t _BUFFER_SIZE = 8 << 20, const bool append = false)
 	{
 		if (f)
 			return false;
@@ -291,7 +310,7 @@ public:
 		}
 		else
 		{
-			f = fopen(file_name.c_str(), "wb");
+			f = fopen(file_name.c_str(), append ? "ab" : "wb");
 			if (!f)
 				return false;
 		}
@@ -335,6 +354,21 @@ public:
 		return f != nullptr;
 	}
 
+	// *******************************************************************************************
+	// Buffered data are passed to the OS (so they survive termination of the process)
+	bool Flush()
+	{
+		if (buffer_pos)
+		{
+			success &= fwrite(buffer, 1, buffer_pos, f) == buffer_pos;
+			buffer_pos = 0;
+		}
+
+		success &= fflush(f) == 0;
+
+		return success;
+	}
+
 	// *******************************************************************************************
 	void Put(const uint8_t c)
 	{
@@ -420,5 +454,110 @@ public:
 	}
 };
 
+// *******************************************************************************************
+// Temporary file (in the system temporary directory) for data that do not fit in memory.
+// The file is created at the first write and removed when closed. Writes and reads are synchronized
+class CSpillFile
+{
+	FILE* f = nullptr;
+	string file_name;
+	uint64_t file_size = 0;
+	mutex mtx;
+
+	// *******************************************************************************************
+	bool open()
+	{
+		error_code ec;
+		auto dir = filesystem::temp_directory_path(ec);
+
+		if (ec)
+			return false;
+
+		random_device rd;
+
+		for (int i = 0; i < 16 && !f; ++i)
+		{
+			file_name = (dir / ("agc-spill-" + to_string(rd()) + to_string(rd()) + ".tmp")).string();
+			f = fopen(file_name.c_str(), "w+bx");
+		}
+
+		if (!f)
+			return false;
+
+#ifndef _WIN32
+		// Space is freed when the file is closed (also if the process is killed)
+		remove(file_name.c_str());
+		file_name.clear();
+#endif
+
+		return true;
+	}
+
+public:
+	// *******************************************************************************************
+	~CSpillFile()
+	{
+		Close();
+	}
+
+	// *******************************************************************************************
+	void Close()
+	{
+		lock_guard<mutex> lck(mtx);
+
+		if (f)
+		{
+			fclose(f);
+			f = nullptr;
+		}
+
+		if (!file_name.empty())
+		{
+			remove(file_name.c_str());
+			file_name.clear();
+		}
+
+		file_size = 0;
+	}
+
+	// *******************************************************************************************
+	// Position of the data in the file is returned (~0ull on error)
+	uint64_t Write(const uint8_t* ptr, const size_t size)
+	{
+		lock_guard<mutex> lck(mtx);
+
+		if (!f && !open())
+			return ~0ull;
+
+		if (my_fseek(f, file_size, SEEK_SET) != 0 || fwrite(ptr, 1, size, f) != size)
+			return ~0ull;
+
+		uint64_t pos = file_size;
+		file_size += size;
+
+		return pos;
+	}
+
+	// *******************************************************************************************
+	bool Read(const uint64_t pos, uint8_t* ptr, const size_t size)
+	{
+		lock_guard<mutex> lck(mtx);
+
+		if (!f || pos + size > file_size)
+			return false;
+
+		return my_fseek(f, pos, SEEK_SET) == 0 && fread(ptr, 1, size, f) == size;
+	}
+
+	// *******************************************************************************************
+	// Stored data are not needed anymore, so the space is reused
+	void Rewind()
+	{
+		lock_guard<mutex> lck(mtx);
+
+		file_size = 0;
+	}
+};
+
 // EOF
 #endif
\ No newline at end of file
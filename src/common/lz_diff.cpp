@@ -128,11 +128,15 @@ void CLZDiffBase::prepare_index()
 
 	if (short_ht_ver)
 	{
+		ht16.reserve(ht_size);
+		CHugePages::Advise(ht16.data(), ht_size * sizeof(uint16_t));
 		ht16.resize(ht_size, empty_key16);
 		make_index16();
 	}
 	else
 	{
+		ht32.reserve(ht_size);
+		CHugePages::Advise(ht32.data(), ht_size * sizeof(uint32_t));
 		ht32.resize(ht_size, empty_key32);
 		make_index32();
 	}
@@ -155,6 +159,23 @@ void CLZDiffBase::AssureIndex()
 		prepare_index();
 }
 
+// *******************************************************************************************
+void CLZDiffBase::ReleaseIndex()
+{
+	ht16.clear();
+	ht16.shrink_to_fit();
+	ht32.clear();
+	ht32.shrink_to_fit();
+
+	index_ready = false;
+}
+
+// *******************************************************************************************
+size_t CLZDiffBase::GetIndexMemory() const
+{
+	return ht16.capacity() * sizeof(uint16_t) + ht32.capacity() * sizeof(uint32_t);
+}
+
 // *******************************************************************************************
 void CLZDiffBase::GetCodingCostVector(const contig_t& text, vector<uint32_t>& v_costs, const bool prefix_costs) const
 {
@@ -594,31 +615,66 @@ size_t CLZDiff_V1::Estimate(const contig_t& text, uint32_t bound)
 }
 
 // *******************************************************************************************
-void CLZDiff_V1::Decode(const contig_t& reference, const contig_t& encoded, contig_t& decoded)
+size_t CLZDiff_V1::decoded_size(const contig_t& reference, const contig_t& encoded)
+{
+	uint8_t c;
+	uint32_t ref_pos, len;
+	uint32_t pred_pos = 0;
+	size_t size = 0;
+
+	for (auto p = encoded.begin(); p != encoded.end(); )
+	{
+		if (is_literal(p))
+		{
+			decode_literal(p, c);
+			++size;
+			++pred_pos;
+		}
+		else if (is_Nrun(p))
+		{
+			decode_Nrun(p, len);
+			size += len;
+		}
+		else
+		{
+			decode_match(p, ref_pos, len, pred_pos);
+			size += len;
+			pred_pos = ref_pos + len;
+		}
+	}
+
+	return size;
+}
+
+// *******************************************************************************************
+void CLZDiff_V1::DecodeAt(const contig_t& reference, const contig_t& encoded, contig_t& decoded, const size_t pos, const bool rev_comp)
 {
 	uint8_t c;
 	uint32_t ref_pos, len;
 	uint32_t pred_pos = 0;
 
-	decoded.clear();
+	size_t size = decoded_size(reference, encoded);
+	decoded.resize(pos + size);
+
+	CContigWriter writer(decoded.data() + pos, size, rev_comp);
 
 	for (auto p = encoded.begin(); p != encoded.end(); )
 	{
 		if (is_literal(p))
 		{
 			decode_literal(p, c);
-			decoded.emplace_back(c);
+			writer.put(c);
 			++pred_pos;
 		}
 		else if (is_Nrun(p))
 		{
 			decode_Nrun(p, len);
-			decoded.insert(decoded.end(), len, N_code);
+			writer.put_run(N_code, len);
 		}
 		else
 		{
 			decode_match(p, ref_pos, len, pred_pos);
-			decoded.insert(decoded.end(), reference.begin() + ref_pos, reference.begin() + ref_pos + len);
+			writer.put_copy(reference.data() + ref_pos, len);
 			pred_pos = ref_pos + len;
 		}
 	}
@@ -798,13 +854,52 @@ void CLZDiff_V2::Encode(const contig_t& text, contig_t& encoded)
 }
 
 // *******************************************************************************************
-void CLZDiff_V2::Decode(const contig_t& reference, const contig_t& encoded, contig_t& decoded)
+size_t CLZDiff_V2::decoded_size(const contig_t& reference, const contig_t& encoded)
+{
+	uint8_t c;
+	uint32_t ref_pos, len;
+	uint32_t pred_pos = 0;
+	size_t size = 0;
+
+	for (auto p = encoded.begin(); p != encoded.end(); )
+	{
+		if (is_literal(p))
+		{
+			decode_literal(p, c);
+			++size;
+			++pred_pos;
+		}
+		else if (is_Nrun(p))
+		{
+			decode_Nrun(p, len);
+			size += len;
+		}
+		else
+		{
+			decode_match(p, ref_pos, len, pred_pos);
+
+			if (len == ~0u)
+				len = reference.size() - ref_pos;
+
+			size += len;
+			pred_pos = ref_pos + len;
+		}
+	}
+
+	return size;
+}
+
+// *******************************************************************************************
+void CLZDiff_V2::DecodeAt(const contig_t& reference, const contig_t& encoded, contig_t& decoded, const size_t pos, const bool rev_comp)
 {
 	uint8_t c;
 	uint32_t ref_pos, len;
 	uint32_t pred_pos = 0;
 
-	decoded.clear();
+	size_t size = decoded_size(reference, encoded);
+	decoded.resize(pos + size);
+
+	CContigWriter writer(decoded.data() + pos, size, rev_comp);
 
 	for (auto p = encoded.begin(); p != encoded.end(); )
 	{
@@ -814,13 +909,13 @@ void CLZDiff_V2::Decode(const contig_t& reference, const contig_t& encoded, cont
 
 			if (c == '!')
 				c = reference[pred_pos];
-			decoded.emplace_back(c);
+			writer.put(c);
 			++pred_pos;
 		}
 		else if (is_Nrun(p))
 		{
 			decode_Nrun(p, len);
-			decoded.insert(decoded.end(), len, N_code);
+			writer.put_run(N_code, len);
 		}
 		else
 		{
@@ -829,7 +924,7 @@ void CLZDiff_V2::Decode(const contig_t& reference, const contig_t& encoded, cont
 			if (len == ~0u)
 				len = reference.size() - ref_pos;
 
-			decoded.insert(decoded.end(), reference.begin() + ref_pos, reference.begin() + ref_pos + len);
+			writer.put_copy(reference.data() + ref_pos, len);
 			pred_pos = ref_pos + len;
 		}
 	}
@@ -15,13 +15,68 @@
 #include <vector>
 #include <array>
 #include "../common/utils.h"
-
-#include <refresh/string_operations/lib/string_operations.h>
+#include "../common/huge_pages.h"
+#include "../common/cpu_dispatch.h"
 
 using namespace std;
 
 #define USE_SPARSE_HT
 
+// *******************************************************************************************
+// Destination of decoded symbols: preallocated range of a contig
+// In reverse-complement mode the range is filled from its end, so the reverse complement is produced on the fly
+class CContigWriter
+{
+	uint8_t* p;
+	const bool rev_comp;
+
+	static uint8_t complement(const uint8_t c)
+	{
+		return c < 4 ? 3 - c : c;
+	}
+
+public:
+	CContigWriter(uint8_t* begin, const size_t size, const bool _rev_comp) :
+		p(_rev_comp ? begin + size : begin), rev_comp(_rev_comp)
+	{}
+
+	void put(const uint8_t c)
+	{
+		if (rev_comp)
+			*--p = complement(c);
+		else
+			*p++ = c;
+	}
+
+	void put_run(const uint8_t c, const uint32_t len)
+	{
+		if (rev_comp)
+		{
+			p -= len;
+			fill_n(p, len, complement(c));
+		}
+		else
+		{
+			fill_n(p, len, c);
+			p += len;
+		}
+	}
+
+	void put_copy(const uint8_t* src, const uint32_t len)
+	{
+		if (rev_comp)
+		{
+			for (uint32_t i = 0; i < len; ++i)
+				*--p = complement(src[i]);
+		}
+		else
+		{
+			copy_n(src, len, p);
+			p += len;
+		}
+	}
+};
+
 // *******************************************************************************************
 class CLZDiffBase
 {
@@ -281,7 +336,7 @@ protected:
 
 	uint32_t compare_fwd(uint8_t* p, uint8_t* q, uint32_t max_len) const
 	{
-		return (uint32_t)refresh::matching_length(p, q, max_len);
+		return (uint32_t)CCpuDispatch::Instance().matching_length(p, q, max_len);
 
 #if 0
 		uint32_t len = 0;
@@ -342,12 +397,23 @@ public:
 	void Prepare(const contig_t& _reference);
 
 	virtual void Encode(const contig_t& text, contig_t&encoded) = 0;
-	virtual void Decode(const contig_t& reference, const contig_t& encoded, contig_t& decoded) = 0;
+
+	void Decode(const contig_t& reference, const contig_t& encoded, contig_t& decoded)
+	{
+		DecodeAt(reference, encoded, decoded, 0, false);
+	}
+
+	// Decoded sequence (or its reverse complement) is stored in decoded starting from pos; decoded is resized to fit it exactly
+	virtual void DecodeAt(const contig_t& reference, const contig_t& encoded, contig_t& decoded, const size_t pos, const bool rev_comp) = 0;
 
 	virtual size_t Estimate(const contig_t& text, uint32_t bound = 0) = 0;
 
 	void AssureIndex();
 
+	// Index is rebuilt on demand
+	void ReleaseIndex();
+	size_t GetIndexMemory() const;
+
 	void GetReference(contig_t& s);
 	void GetCodingCostVector(const contig_t& text, vector<uint32_t> &v_costs, const bool prefix_costs) const;
 };
@@ -357,7 +423,7 @@ class CLZDiff_V1 : public CLZDiffBase
 {
 	void encode_match(const uint32_t ref_pos, const uint32_t len, const uint32_t pred_pos, contig_t& encoded);
 	void decode_match(contig_t::const_iterator& p, uint32_t& ref_pos, uint32_t& len, uint32_t& pred_pos);
-
+	size_t decoded_size(const contig_t& reference, const contig_t& encoded);
 
 public:
 	CLZDiff_V1(const uint32_t _min_match_len = 18) : CLZDiffBase(_min_match_len)
@@ -366,7 +432,7 @@ public:
 	virtual ~CLZDiff_V1() {};
 
 	virtual void Encode(const contig_t& text, contig_t& encoded);
-	virtual void Decode(const contig_t& reference, const contig_t& encoded, contig_t& decoded);
+	virtual void DecodeAt(const contig_t& reference, const contig_t& encoded, contig_t& decoded, const size_t pos, const bool rev_comp);
 
 	virtual size_t Estimate(const contig_t& text, uint32_t bound = 0);
 };
@@ -376,6 +442,7 @@ class CLZDiff_V2 : public CLZDiffBase
 {
 	void encode_match(const uint32_t ref_pos, const uint32_t len, const uint32_t pred_pos, contig_t& encoded);
 	void decode_match(contig_t::const_iterator& p, uint32_t& ref_pos, uint32_t& len, uint32_t& pred_pos);
+	size_t decoded_size(const contig_t& reference, const contig_t& encoded);
 
 	uint32_t int_len(int x) const
 	{
@@ -430,7 +497,7 @@ public:
 	virtual ~CLZDiff_V2() {};
 
 	virtual void Encode(const contig_t& text, contig_t& encoded);
-	virtual void Decode(const contig_t& reference, const contig_t& encoded, contig_t& decoded);
+	virtual void DecodeAt(const contig_t& reference, const contig_t& encoded, contig_t& decoded, const size_t pos, const bool rev_comp);
 
 	virtual size_t Estimate(const contig_t& text, uint32_t bound = ~0u);
 };
@@ -0,0 +1,130 @@
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include "numa.h"
+#include <fstream>
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+// *******************************************************************************************
+CNumaTopology::CNumaTopology()
+{
+#ifdef __linux__
+	for (uint32_t node = 0; ; ++node)
+	{
+		ifstream inf("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+
+		if (!inf.is_open())
+			break;
+
+		string line;
+		getline(inf, line);
+
+		auto v_cpus = parse_cpu_list(line);
+
+		// Memory-only nodes (no CPUs) are not used for placement of workers
+		if (v_cpus.empty())
+			break;
+
+		v_node_cpus.emplace_back(move(v_cpus));
+	}
+#endif
+}
+
+// *******************************************************************************************
+// Parse list in format used by Linux kernel, e.g., "0-3,8-11,16"
+vector<uint32_t> CNumaTopology::parse_cpu_list(const string& str)
+{
+	vector<uint32_t> v_cpus;
+	size_t pos = 0;
+
+	while (pos < str.size())
+	{
+		size_t end = str.find(',', pos);
+		if (end == string::npos)
+			end = str.size();
+
+		string item = str.substr(pos, end - pos);
+		auto dash = item.find('-');
+
+		if (!item.empty())
+		{
+			uint32_t from = (uint32_t)stoul(item.substr(0, dash));
+			uint32_t to = (dash == string::npos) ? from : (uint32_t)stoul(item.substr(dash + 1));
+
+			for (uint32_t i = from; i <= to; ++i)
+				v_cpus.emplace_back(i);
+		}
+
+		pos = end + 1;
+	}
+
+	return v_cpus;
+}
+
+// *******************************************************************************************
+const CNumaTopology& CNumaTopology::Instance()
+{
+	static CNumaTopology topology;
+
+	return topology;
+}
+
+// *******************************************************************************************
+bool CNumaTopology::PinCurrentThreadToNode(uint32_t node) const
+{
+#ifdef __linux__
+	if (node >= v_node_cpus.size())
+		return false;
+
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+
+	for (auto cpu : v_node_cpus[node])
+		if (cpu < CPU_SETSIZE)
+			CPU_SET(cpu, &cpu_set);
+
+	return sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0;
+#else
+	return false;
+#endif
+}
+
+// *******************************************************************************************
+bool CNumaTopology::InterleaveMemory(void* ptr, size_t size) const
+{
+#if defined(__linux__) && defined(SYS_mbind)
+	if (!IsNuma() || ptr == nullptr)
+		return false;
+
+	const int mpol_interleave = 3;			// MPOL_INTERLEAVE from <numaif.h> (not included to avoid dependency on libnuma)
+	const uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+
+	uint64_t from = ((uint64_t)ptr + page_size - 1) / page_size * page_size;
+	uint64_t to = ((uint64_t)ptr + size) / page_size * page_size;
+
+	if (from >= to)
+		return false;
+
+	unsigned long node_mask = 0;
+	for (uint32_t i = 0; i < v_node_cpus.size() && i < 8 * sizeof(node_mask); ++i)
+		node_mask |= 1ul << i;
+
+	return syscall(SYS_mbind, (void*)from, (unsigned long)(to - from), mpol_interleave, &node_mask, (unsigned long)(8 * sizeof(node_mask)), 0u) == 0;
+#else
+	return false;
+#endif
+}
+
+// EOF
@@ -0,0 +1,59 @@
+#ifndef _NUMA_H
+#define _NUMA_H
+
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// *******************************************************************************************
+// Minimal NUMA support without external libraries
+//   * topology is read from /sys/devices/system/node (Linux only)
+//   * threads are pinned with sched_setaffinity
+//   * memory ranges are interleaved over nodes with mbind (must be called before the pages are touched)
+// On other systems (or single-node machines) all functions are no-ops.
+class CNumaTopology
+{
+	vector<vector<uint32_t>> v_node_cpus;
+
+	CNumaTopology();
+
+	static vector<uint32_t> parse_cpu_list(const string& str);
+
+public:
+	static const CNumaTopology& Instance();
+
+	uint32_t GetNoNodes() const
+	{
+		return (uint32_t)v_node_cpus.size();
+	}
+
+	bool IsNuma() const
+	{
+		return v_node_cpus.size() > 1;
+	}
+
+	// Node used by worker with given id (workers are spread round-robin over nodes)
+	uint32_t NodeForWorker(uint32_t worker_id) const
+	{
+		return v_node_cpus.empty() ? 0 : worker_id % (uint32_t)v_node_cpus.size();
+	}
+
+	bool PinCurrentThreadToNode(uint32_t node) const;
+	bool InterleaveMemory(void* ptr, size_t size) const;
+};
+
+// EOF
+#endif
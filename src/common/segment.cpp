@@ -11,19 +11,22 @@
 #include "segment.h"
 
 // *******************************************************************************************
-uint32_t CSegment::add_raw(const contig_t& s, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx)
+uint32_t CSegment::add_raw(const contig_t& s, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx, const bool hot)
 {
     lock_guard<mutex> lck(mtx);
 
     if (internal_state == internal_state_t::packed)
         unpack(zstd_dctx);
 
-    if (v_raw.size() == contigs_in_pack)
+    if (pack_to_close(v_raw.size(), hot))
     {
-        store_in_archive(v_raw, zstd_cctx);
+        store_pack(v_raw, false, zstd_cctx);
         v_raw.clear();
     }
 
+    if (v_raw.empty())
+        cur_pack_hot = hot;
+
     ++no_seqs;
     v_raw.emplace_back(s);
 
@@ -31,7 +34,7 @@ uint32_t CSegment::add_raw(const contig_t& s, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* z
 }
 
 // *******************************************************************************************
-uint32_t CSegment::add(const contig_t& s, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx)
+uint32_t CSegment::add(const contig_t& s, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx, const bool hot)
 {
     lock_guard<mutex> lck(mtx);
 
@@ -48,15 +51,19 @@ uint32_t CSegment::add(const contig_t& s, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_
     }
     else
     {
-        if (v_lzp.size() == contigs_in_pack)
+        if (pack_to_close(v_lzp.size(), hot))
         {
-            store_in_archive(v_lzp, zstd_cctx);
+            store_pack(v_lzp, false, zstd_cctx);
             v_lzp.clear();
         }
 
+        if (v_lzp.empty())
+            cur_pack_hot = hot;
+
         contig_t delta;
 
         lz_diff->Encode(s, delta);
+        index_used = true;
 
 #ifdef IMPROVED_LZ_ENCODING
         if (delta.empty())       // same sequence as reference
@@ -79,6 +86,51 @@ uint32_t CSegment::add(const contig_t& s, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_
     return no_seqs - 1u;
 }
 
+// *******************************************************************************************
+void CSegment::add_packed_ref(const vector<uint8_t>& packed_ref, const uint64_t raw_size, const contig_t& ref)
+{
+    lock_guard<mutex> lck(mtx);
+
+    lz_diff->Prepare(ref);
+
+    stream_id_ref = out_archive->RegisterStream(name + ss_ref_ext(archive_version));
+    out_archive->AddPartBuffered(stream_id_ref, packed_ref, raw_size);
+
+    ref_size = ref.size() + 1;
+    no_seqs = 1;
+}
+
+// *******************************************************************************************
+uint32_t CSegment::add_encoded(const contig_t& delta, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx, const bool hot)
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (internal_state == internal_state_t::packed)
+        unpack(zstd_dctx);
+
+    if (pack_to_close(v_lzp.size(), hot))
+    {
+        store_pack(v_lzp, false, zstd_cctx);
+        v_lzp.clear();
+    }
+
+    if (v_lzp.empty())
+        cur_pack_hot = hot;
+
+    auto p = find(v_lzp.begin(), v_lzp.end(), delta);
+
+    if (p != v_lzp.end())
+        return no_seqs - distance(p, v_lzp.end());
+
+    packed_size += delta.size() + 1;
+
+    v_lzp.emplace_back(delta);
+
+    ++no_seqs;
+
+    return no_seqs - 1u;
+}
+
 // *******************************************************************************************
 uint64_t CSegment::estimate(const contig_t& s, uint32_t bound, ZSTD_DCtx* zstd_dctx)
 {
@@ -92,6 +144,7 @@ uint64_t CSegment::estimate(const contig_t& s, uint32_t bound, ZSTD_DCtx* zstd_d
             unpack(zstd_dctx);
 
         lz_diff->AssureIndex();
+        index_used = true;
     }
 
     return lz_diff->Estimate(s, bound);
@@ -110,6 +163,7 @@ void CSegment::get_coding_cost(const contig_t& s, vector<uint32_t>& v_costs, con
         if (internal_state == internal_state_t::packed)
             unpack(zstd_dctx);
         lz_diff->AssureIndex();
+        index_used = true;
     }
 
     lz_diff->GetCodingCostVector(s, v_costs, prefix_costs);
@@ -121,25 +175,71 @@ size_t CSegment::get_ref_size() const
     return ref_size;
 }
 
+// *******************************************************************************************
+size_t CSegment::get_index_memory()
+{
+    lock_guard<mutex> lck(mtx);
+
+    return lz_diff->GetIndexMemory();
+}
+
+// *******************************************************************************************
+size_t CSegment::release_index(const bool idle_only)
+{
+    lock_guard<mutex> lck(mtx);
+
+    size_t released = 0;
+
+    if (!idle_only || !index_used)
+    {
+        released = lz_diff->GetIndexMemory();
+        lz_diff->ReleaseIndex();
+    }
+
+    index_used = false;
+
+    return released;
+}
+
 // *******************************************************************************************
 void CSegment::finish(ZSTD_CCtx* zstd_ctx)
 {
     if (!v_lzp.empty())
-        store_in_archive(v_lzp, zstd_ctx);
+        store_pack(v_lzp, true, zstd_ctx);
     if (!v_raw.empty())
-        store_in_archive(v_raw, zstd_ctx);
+        store_pack(v_raw, true, zstd_ctx);
     if (!packed_delta.empty())
         store_compressed_delta_in_archive();
 }
 
 // *******************************************************************************************
-bool CSegment::get_raw(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
+void CSegment::store_checkpoint(ZSTD_CCtx* zstd_ctx, vector<uint32_t>& v_checkpoint_pack_ends)
+{
+    lock_guard<mutex> lck(mtx);
+
+    auto saved_pack_ends = v_pack_ends;
+    auto saved_no_stored_packs = no_stored_packs;
+    auto saved_stream_id_delta = stream_id_delta;
+
+    finish(zstd_ctx);
+
+    v_checkpoint_pack_ends = v_pack_ends;
+
+    v_pack_ends = move(saved_pack_ends);
+    no_stored_packs = saved_no_stored_packs;
+    stream_id_delta = saved_stream_id_delta;
+}
+
+// *******************************************************************************************
+bool CSegment::get_raw(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx, const size_t ctg_pos, const bool rev_comp)
 {
     // Retrive pack of raw contigs
 //    vector<uint8_t> pack_raw_seq;
 
-    int part_id = id_seq / contigs_in_pack;
-    int seq_in_part_id = id_seq % contigs_in_pack;
+    int part_id;
+    int seq_in_part_id;
+
+    locate_member(id_seq, part_id, seq_in_part_id);
 
     uint8_t* pack_raw_seq = nullptr;
     contig_t buf;
@@ -152,7 +252,7 @@ bool CSegment::get_raw(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx
     {
         tie(stream_id_delta, ignore) = in_archive->GetPart(name + ss_delta_ext(archive_version), part_id, zstd_raw_seq, raw_seq_size);
 
-        if (raw_seq_size == 0)
+        if (raw_seq_size == 0 || seekable_packs)
         {
             pack_raw_seq = zstd_raw_seq.data();
             pack_raw_seq_size = zstd_raw_seq.size();
@@ -178,12 +278,16 @@ bool CSegment::get_raw(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx
 
             tie(p_raw, ignore) = pf_packed_raw_seq.insert(make_pair(part_id, vector<uint8_t>()));
 
-            if (raw_seq_size == 0)
+            if (raw_seq_size == 0 || seekable_packs)
                 p_raw->second = move(zstd_raw_seq);
             else
             {
                 p_raw->second.resize(raw_seq_size);
-                ZSTD_decompressDCtx(zstd_ctx, p_raw->second.data(), p_raw->second.size(), zstd_raw_seq.data(), zstd_raw_seq.size());
+                if (!decompress_frame(zstd_ctx, p_raw->second.data(), p_raw->second.size(), zstd_raw_seq.data(), zstd_raw_seq.size()))
+                {
+                    pf_packed_raw_seq.erase(p_raw);
+                    return false;
+                }
             }
         }
 
@@ -191,6 +295,18 @@ bool CSegment::get_raw(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx
         pack_raw_seq_size = p_raw->second.size();
     }
 
+    if (seekable_packs)
+    {
+        contig_t raw_seq;
+
+        if (!get_seekable_member(pack_raw_seq, pack_raw_seq_size, seq_in_part_id, raw_seq, zstd_ctx))
+            return false;
+
+        store_at(raw_seq.data(), raw_seq.size(), ctg, ctg_pos, rev_comp);
+
+        return true;
+    }
+
     // Retrive the requested delta-coded contig
     uint32_t b_pos = 0;
     uint32_t e_pos = 0;
@@ -211,13 +327,13 @@ bool CSegment::get_raw(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx
         }
     }
 
-    ctg.assign(pack_raw_seq + b_pos, pack_raw_seq + e_pos);
+    store_at(pack_raw_seq + b_pos, e_pos - b_pos, ctg, ctg_pos, rev_comp);
 
     return true;
 }
 
 // *******************************************************************************************
-bool CSegment::get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
+bool CSegment::get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx, const size_t ctg_pos, const bool rev_comp)
 {
     // Retrive reference contig
 //    contig_t ref_seq;
@@ -227,7 +343,11 @@ bool CSegment::get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
     uint64_t delta_seq_size = 0;
 
     uint64_t ref_seq_size = 0;
-    int part_id = (id_seq - 1) / contigs_in_pack;
+    int part_id = -1;               // no delta part is needed for the reference
+    int seq_in_part_id = 0;
+
+    if (id_seq > 0)
+        locate_member(id_seq - 1, part_id, seq_in_part_id);
 
     if (!fast)
     {
@@ -255,10 +375,19 @@ bool CSegment::get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
             ref_seq = move(zstd_ref_seq);       // No compression
         else
         {
+            if (zstd_ref_seq.empty())
+                return false;
+
             ref_seq.resize(ref_seq_size);
 
             if (zstd_ref_seq.back() == 0)
-                ZSTD_decompressDCtx(zstd_ctx, ref_seq.data(), ref_seq.size(), zstd_ref_seq.data(), zstd_ref_seq.size() - 1u);
+            {
+                if (!decompress_frame(zstd_ctx, ref_seq.data(), ref_seq.size(), zstd_ref_seq.data(), zstd_ref_seq.size() - 1u))
+                {
+                    ref_seq.clear();
+                    return false;
+                }
+            }
             else
             {
                 vector<uint8_t> v_tuples;
@@ -266,6 +395,12 @@ bool CSegment::get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
 
                 auto output_size = ZSTD_decompressDCtx(zstd_ctx, v_tuples.data(), v_tuples.size(), zstd_ref_seq.data(), zstd_ref_seq.size() - 1u);
 
+                if (ZSTD_isError(output_size))
+                {
+                    ref_seq.clear();
+                    return false;
+                }
+
                 v_tuples.resize(output_size);
                 tuples2bytes(v_tuples, ref_seq);
             }
@@ -274,14 +409,16 @@ bool CSegment::get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
 
     if (id_seq == 0)
     {
+        if (!fast && ctg_pos == 0 && !rev_comp)
+            ctg = move(ref_seq);
+        else
+            store_at(ref_seq.data(), ref_seq.size(), ctg, ctg_pos, rev_comp);
+
         if (!fast)
         {
-            ctg = move(ref_seq);
             ref_seq.clear();
             ref_seq.shrink_to_fit();
         }
-        else
-            ctg = ref_seq;
 
         return true;
     }
@@ -292,7 +429,7 @@ bool CSegment::get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
 
     if (!fast)
     {
-        if (delta_seq_size == 0)
+        if (delta_seq_size == 0 || seekable_packs)
         {
             pack_delta_seq = zstd_delta_seq.data();
             delta_seq_size = zstd_delta_seq.size();
@@ -312,12 +449,16 @@ bool CSegment::get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
         {
             tie(p_delta, ignore) = pf_packed_delta_seq.insert(make_pair(part_id, make_pair(vector<uint8_t>(), vector<uint32_t>())));
 
-            if (delta_seq_size == 0)
-                p_delta->second.first = zstd_delta_seq;
+            if (delta_seq_size == 0 || seekable_packs)
+                p_delta->second.first = move(zstd_delta_seq);
             else
             {
                 p_delta->second.first.resize(delta_seq_size);
-                ZSTD_decompressDCtx(zstd_ctx, p_delta->second.first.data(), delta_seq_size, zstd_delta_seq.data(), zstd_delta_seq.size());
+                if (!decompress_frame(zstd_ctx, p_delta->second.first.data(), delta_seq_size, zstd_delta_seq.data(), zstd_delta_seq.size()))
+                {
+                    pf_packed_delta_seq.erase(p_delta);
+                    return false;
+                }
             }
 
             auto& sep_pos = p_delta->second.second;
@@ -325,12 +466,13 @@ bool CSegment::get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
             pack_delta_seq = p_delta->second.first.data();
             delta_seq_size = p_delta->second.first.size();
 
-            if (contigs_in_pack == 1)
+            // Members of seekable packs are located using offset table stored in the pack
+            if (!seekable_packs && contigs_in_pack == 1)
             {
                 sep_pos.emplace_back(0);
                 sep_pos.emplace_back(delta_seq_size);
             }
-            else
+            else if (!seekable_packs)
             {
                 sep_pos.emplace_back(0);
 
@@ -348,9 +490,18 @@ bool CSegment::get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
 
     // Retrive pack of delta-coded contigs
     contig_t delta_seq;
-    int seq_in_part_id = (id_seq - 1) % contigs_in_pack;
 
-    if (!fast)
+    if (seekable_packs)
+    {
+        if (!get_seekable_member(pack_delta_seq, delta_seq_size, seq_in_part_id, delta_seq, zstd_ctx))
+        {
+            if (need_deallocate_pack_delta_seq)
+                delete[] pack_delta_seq;
+
+            return false;
+        }
+    }
+    else if (!fast)
     {
         if (contigs_in_pack > 1)
         {
@@ -380,11 +531,17 @@ bool CSegment::get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
             delta_seq.assign(pack_delta_seq, pack_delta_seq + delta_seq_size - 1);
     }
     else
-        delta_seq.assign(pack_delta_seq + p_delta->second.second[seq_in_part_id], pack_delta_seq + p_delta->second.second[seq_in_part_id + 1] - 1);
+    {
+        auto& sep_pos = p_delta->second.second;
+
+        if ((size_t) seq_in_part_id + 1 >= sep_pos.size() || sep_pos[seq_in_part_id + 1] <= sep_pos[seq_in_part_id])
+            return false;
+
+        delta_seq.assign(pack_delta_seq + sep_pos[seq_in_part_id], pack_delta_seq + sep_pos[seq_in_part_id + 1] - 1);
+    }
 
     // LZ decode delta-encoded contig
-    ctg.clear();
-    lz_diff->Decode(ref_seq, delta_seq, ctg);
+    lz_diff->DecodeAt(ref_seq, delta_seq, ctg, ctg_pos, rev_comp);
 
     if (need_deallocate_pack_delta_seq)
         delete[] pack_delta_seq;
@@ -399,19 +556,19 @@ bool CSegment::get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
 }
 
 // *******************************************************************************************
-bool CSegment::get_raw_locked(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
+bool CSegment::get_raw_locked(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx, const size_t ctg_pos, const bool rev_comp)
 {
     lock_guard<mutex> lck(mtx);
 
-    return get_raw(id_seq, ctg, zstd_ctx);
+    return get_raw(id_seq, ctg, zstd_ctx, ctg_pos, rev_comp);
 }
 
 // *******************************************************************************************
-bool CSegment::get_locked(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx)
+bool CSegment::get_locked(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx, const size_t ctg_pos, const bool rev_comp)
 {
     lock_guard<mutex> lck(mtx);
 
-    return get(id_seq, ctg, zstd_ctx);
+    return get(id_seq, ctg, zstd_ctx, ctg_pos, rev_comp);
 }
 
 // *******************************************************************************************
@@ -458,9 +615,11 @@ void CSegment::appending_init()
         {
             in_archive->GetPart(in_stream_id_delta, tmp_data, tmp_meta);
             out_archive->AddPart(out_stream_id_delta, tmp_data, tmp_meta);
-            no_seqs += contigs_in_pack;
+            no_seqs += v_pack_ends.empty() ? contigs_in_pack : v_pack_ends[i] - (i ? v_pack_ends[i - 1] : 0);
         }
 
+        no_stored_packs = no_parts - 1;
+
         in_archive->GetPart(in_stream_id_delta, packed_delta, raw_delta_size);
     }
 
@@ -470,6 +629,92 @@ void CSegment::appending_init()
     stream_id_delta = out_stream_id_delta;
 }
 
+// *******************************************************************************************
+bool CSegment::get_encoded_members(vector<contig_t>& v_members, ZSTD_DCtx* zstd_ctx)
+{
+    v_members.clear();
+
+    int in_stream_id_delta = in_archive->GetStreamId(name + ss_delta_ext(archive_version));
+
+    if (in_stream_id_delta < 0)
+        return true;
+
+    vector<uint8_t> v_packed;
+    contig_t pack;
+    uint64_t raw_size;
+
+    int no_parts = (int) in_archive->GetNoParts(in_stream_id_delta);
+
+    for (int i = 0; i < no_parts; ++i)
+    {
+        if (!in_archive->GetPart(in_stream_id_delta, i, v_packed, raw_size))
+            return false;
+
+        if (seekable_packs)
+        {
+            uint32_t no_members = get_seekable_no_members(v_packed.data(), v_packed.size());
+
+            if (no_members == 0)
+                return false;
+
+            for (uint32_t j = 0; j < no_members; ++j)
+            {
+                v_members.emplace_back();
+                if (!get_seekable_member(v_packed.data(), v_packed.size(), j, v_members.back(), zstd_ctx))
+                    return false;
+            }
+
+            continue;
+        }
+
+        if (raw_size == 0)
+            pack.swap(v_packed);
+        else
+        {
+            pack.resize(raw_size);
+            if (!decompress_frame(zstd_ctx, pack.data(), pack.size(), v_packed.data(), v_packed.size()))
+                return false;
+        }
+
+        if (pack.empty())
+            return false;
+
+        if (contigs_in_pack > 1)
+        {
+            uint32_t b_pos = 0;
+
+            for (uint32_t j = 0; j < pack.size(); ++j)
+                if (pack[j] == contig_separator)
+                {
+                    v_members.emplace_back(pack.begin() + b_pos, pack.begin() + j);
+                    b_pos = j + 1;
+                }
+        }
+        else
+            v_members.emplace_back(pack.begin(), pack.begin() + (pack.size() - 1));
+    }
+
+    return true;
+}
+
+// *******************************************************************************************
+void CSegment::set_hot_contigs_in_pack(const uint32_t _hot_contigs_in_pack)
+{
+    hot_contigs_in_pack = max<uint32_t>(1, min(_hot_contigs_in_pack, contigs_in_pack));
+}
+
+// *******************************************************************************************
+void CSegment::set_pack_layout(const vector<uint32_t>& _v_pack_ends)
+{
+    v_pack_ends = _v_pack_ends;
+}
+
+// *******************************************************************************************
+const vector<uint32_t>& CSegment::get_pack_layout() const
+{
+    return v_pack_ends;
+}
+
 // *******************************************************************************************
 void CSegment::clear()
 {
@@ -492,6 +737,45 @@ uint64_t CSegment::get_no_seqs()
     return no_seqs;
 }
 
+// *******************************************************************************************
+uint32_t CSegment::get_seekable_no_members(const uint8_t* pack, const size_t pack_size) const
+{
+    if (pack_size < 5 || pack[pack_size - 1] != seekable_pack_marker)
+        return 0;
+
+    uint32_t no_members = read_u32(pack + pack_size - 5);
+
+    if (8ull * no_members + 5 > pack_size)
+        return 0;
+
+    return no_members;
+}
+
+// *******************************************************************************************
+bool CSegment::get_seekable_member(const uint8_t* pack, const size_t pack_size, const uint32_t member_id, contig_t& member, ZSTD_DCtx* zstd_ctx) const
+{
+    uint32_t no_members = get_seekable_no_members(pack, pack_size);
+
+    if (member_id >= no_members)
+        return false;
+
+    const uint8_t* table = pack + pack_size - 5 - 8ull * no_members;
+
+    uint32_t frame_begin = member_id ? read_u32(table + 8ull * (member_id - 1)) : 0;
+    uint32_t frame_end = read_u32(table + 8ull * member_id);
+    uint32_t raw_size = read_u32(table + 8ull * member_id + 4);
+
+    if (frame_end - frame_begin == raw_size)
+    {
+        member.assign(pack + frame_begin, pack + frame_end);
+        return true;
+    }
+
+    member.resize(raw_size);
+
+    return !ZSTD_isError(ZSTD_decompressDCtx(zstd_ctx, member.data(), raw_size, pack + frame_begin, frame_end - frame_begin));
+}
+
 // *******************************************************************************************
 void CSegment::unpack(ZSTD_DCtx* zstd_ctx)
 {
@@ -529,7 +813,29 @@ void CSegment::unpack(ZSTD_DCtx* zstd_ctx)
         ref_size = ref_seq.size() + 1;
     }
 
-    if (!packed_delta.empty())
+    if (!packed_delta.empty() && !v_pack_ends.empty())
+        v_pack_ends.pop_back();         // members of the last pack will be stored again
+
+    if (!packed_delta.empty() && seekable_packs)
+    {
+        if (zstd_ctx == nullptr)
+            zstd_ctx = ZSTD_createDCtx();
+
+        v_lzp.clear();
+        v_lzp.resize(get_seekable_no_members(packed_delta.data(), packed_delta.size()));
+
+        for (uint32_t i = 0; i < v_lzp.size(); ++i)
+            get_seekable_member(packed_delta.data(), packed_delta.size(), i, v_lzp[i], zstd_ctx);
+
+        packed_delta.clear();
+        packed_delta.shrink_to_fit();
+
+        no_seqs += (uint32_t) v_lzp.size();
+
+        if (ref_size == 0)          // There is no reference sequence so the deltas are in fact raw sequences
+            swap(v_raw, v_lzp);
+    }
+    else if (!packed_delta.empty())
     {
         contig_t delta_seq;
 
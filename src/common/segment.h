@@ -29,15 +29,18 @@ class CSegment
     enum class internal_state_t {none, normal, packed};
 
     const uint8_t contig_separator = 0xffu;
+    const uint8_t seekable_pack_marker = 2;
 
     string name;
     shared_ptr<CArchive> in_archive;
     shared_ptr<CArchive> out_archive;
     uint32_t contigs_in_pack;
+    uint32_t hot_contigs_in_pack;
     uint32_t min_match_len;
     bool concatenated_genomes;
     uint32_t archive_version;
     bool fast;
+    bool seekable_packs;
 
     int stream_id_ref;
     int stream_id_delta;
@@ -53,8 +56,15 @@ class CSegment
     unique_ptr<CLZDiffBase> lz_diff;
 
     uint32_t no_seqs;
+    bool index_used = false;
     vector<contig_t> v_lzp;
 
+    // Pack layout: packs are uniform (contigs_in_pack members, except the last one) unless v_pack_ends is non-empty,
+    // then it contains cumulative no. of members (in delta stream) after each pack
+    vector<uint32_t> v_pack_ends;
+    uint32_t no_stored_packs = 0;
+    bool cur_pack_hot = false;
+
     contig_t ref_seq;
     map<int, pair<vector<uint8_t>, vector<uint32_t>>> pf_packed_delta_seq;
     map<int, vector<uint8_t>> pf_packed_raw_seq;
@@ -257,6 +267,12 @@ private:
     // *******************************************************************************************
     void store_in_archive(const vector<contig_t>& v_data, ZSTD_CCtx* zstd_ctx)
     {
+        if (seekable_packs)
+        {
+            store_seekable_pack(v_data, 17, zstd_ctx);
+            return;
+        }
+
         contig_t pack;
 
         size_t res_size = v_data.size();
@@ -279,6 +295,120 @@ private:
         add_to_archive(stream_id_delta, pack, 17, zstd_ctx);
     }
 
+    // *******************************************************************************************
+    void append_u32(contig_t& data, uint32_t x)
+    {
+        for (int i = 0; i < 4; ++i, x >>= 8)
+            data.emplace_back((uint8_t) (x & 0xffu));
+    }
+
+    // *******************************************************************************************
+    uint32_t read_u32(const uint8_t* p) const
+    {
+        return (uint32_t) p[0] + ((uint32_t) p[1] << 8) + ((uint32_t) p[2] << 16) + ((uint32_t) p[3] << 24);
+    }
+
+    // *******************************************************************************************
+    // Seekable pack: members are compressed as independent ZSTD frames, so a single member can be decoded
+    // without decompressing the rest of the pack
+    //   layout: frame_0 ... frame_{n-1} | n x (frame_end: u32, raw_size: u32) | n: u32 | marker: u8
+    //   frame of the same size as the member is stored uncompressed
+    void store_seekable_pack(const vector<contig_t>& v_data, const int compression_level, ZSTD_CCtx* zstd_ctx)
+    {
+        contig_t pack;
+        contig_t frame;
+        vector<uint32_t> v_table;
+        uint64_t raw_size = 0;
+
+        v_table.reserve(2 * v_data.size());
+
+        for (auto& x : v_data)
+        {
+            frame.resize(ZSTD_compressBound(x.size()));
+            size_t frame_size = ZSTD_compressCCtx(zstd_ctx, frame.data(), frame.size(), x.data(), x.size(), compression_level);
+
+            if (ZSTD_isError(frame_size) || frame_size >= x.size())
+                pack.insert(pack.end(), x.begin(), x.end());
+            else
+                pack.insert(pack.end(), frame.begin(), frame.begin() + frame_size);
+
+            v_table.emplace_back((uint32_t) pack.size());
+            v_table.emplace_back((uint32_t) x.size());
+
+            raw_size += x.size() + 1;        // as for plain packs (with separators), so it is never 0
+        }
+
+        for (auto x : v_table)
+            append_u32(pack, x);
+        append_u32(pack, (uint32_t) v_data.size());
+        pack.emplace_back(seekable_pack_marker);
+
+        if (stream_id_delta < 0)
+            stream_id_delta = out_archive->RegisterStream(name + ss_delta_ext(archive_version));
+
+        out_archive->AddPartBuffered(stream_id_delta, pack, raw_size);
+    }
+
+    uint32_t get_seekable_no_members(const uint8_t* pack, const size_t pack_size) const;
+    bool get_seekable_member(const uint8_t* pack, const size_t pack_size, const uint32_t member_id, contig_t& member, ZSTD_DCtx* zstd_ctx) const;
+
+    // *******************************************************************************************
+    void store_pack(const vector<contig_t>& v_data, const bool last, ZSTD_CCtx* zstd_ctx)
+    {
+        uint32_t no_members = (uint32_t) v_data.size();
+        bool uniform = v_pack_ends.empty() && (last || no_members == contigs_in_pack);
+
+        if (!uniform)
+        {
+            if (v_pack_ends.empty())
+                for (uint32_t i = 0; i < no_stored_packs; ++i)
+                    v_pack_ends.emplace_back((i + 1) * contigs_in_pack);
+
+            v_pack_ends.emplace_back((v_pack_ends.empty() ? 0 : v_pack_ends.back()) + no_members);
+        }
+
+        ++no_stored_packs;
+
+        store_in_archive(v_data, zstd_ctx);
+    }
+
+    // *******************************************************************************************
+    // Close current pack if it is full or the new member is of other kind (hot/regular)
+    bool pack_to_close(const size_t pack_size, const bool hot) const
+    {
+        if (pack_size == 0)
+            return false;
+
+        return hot != cur_pack_hot || pack_size == (cur_pack_hot ? hot_contigs_in_pack : contigs_in_pack);
+    }
+
+    // *******************************************************************************************
+    // Packs are followed by a marker byte, so only the leading ZSTD frame is decoded
+    static bool decompress_frame(ZSTD_DCtx* zstd_ctx, uint8_t* dst, const size_t dst_size, const uint8_t* src, const size_t src_size)
+    {
+        size_t frame_size = ZSTD_findFrameCompressedSize(src, src_size);
+
+        if (ZSTD_isError(frame_size))
+            return false;
+
+        return ZSTD_decompressDCtx(zstd_ctx, dst, dst_size, src, frame_size) == dst_size;
+    }
+
+    // *******************************************************************************************
+    void locate_member(const uint32_t member_id, int& part_id, int& in_part_id) const
+    {
+        if (v_pack_ends.empty())
+        {
+            part_id = (int) (member_id / contigs_in_pack);
+            in_part_id = (int) (member_id % contigs_in_pack);
+        }
+        else
+        {
+            part_id = (int) (upper_bound(v_pack_ends.begin(), v_pack_ends.end(), member_id) - v_pack_ends.begin());
+            in_part_id = (int) (member_id - (part_id ? v_pack_ends[part_id - 1] : 0));
+        }
+    }
+
     // *******************************************************************************************
     void store_compressed_delta_in_archive()
     {
@@ -289,16 +419,27 @@ private:
         }
 
         out_archive->AddPartBuffered(stream_id_delta, packed_delta, raw_delta_size);
+        ++no_stored_packs;
     }
 
     void unpack(ZSTD_DCtx* zstd_ctx);
 
+    // *******************************************************************************************
+    void store_at(const uint8_t* src, const size_t len, contig_t& ctg, const size_t ctg_pos, const bool rev_comp)
+    {
+        ctg.resize(ctg_pos + len);
+
+        CContigWriter writer(ctg.data() + ctg_pos, len, rev_comp);
+        writer.put_copy(src, (uint32_t)len);
+    }
+
 public:
     // *******************************************************************************************
     CSegment(const string &_name, shared_ptr<CArchive> _in_archive, shared_ptr<CArchive> _out_archive,
-        const uint32_t _contigs_in_pack, const uint32_t _min_match_len, const bool _concatenated_genomes, uint32_t _archive_version, bool fast = false) :
+        const uint32_t _contigs_in_pack, const uint32_t _min_match_len, const bool _concatenated_genomes, uint32_t _archive_version, const bool _seekable_packs, bool fast = false) :
         name(_name), in_archive(_in_archive), out_archive(_out_archive), 
-        contigs_in_pack(_contigs_in_pack), min_match_len(_min_match_len), concatenated_genomes(_concatenated_genomes), archive_version(_archive_version), fast(fast),
+        contigs_in_pack(_contigs_in_pack), hot_contigs_in_pack(_contigs_in_pack), min_match_len(_min_match_len), concatenated_genomes(_concatenated_genomes), archive_version(_archive_version), fast(fast),
+        seekable_packs(_seekable_packs),
         no_seqs(0), ref_size(0), seq_size(0), packed_size(0)
     {
         stream_id_ref = -1;
@@ -317,25 +458,52 @@ public:
     {
     }
 
-    uint32_t add_raw(const contig_t& s, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx);
-    uint32_t add(const contig_t& s, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx);
+    // Members of hot samples are stored in separate (usually smaller) packs to make their extraction cheap
+    uint32_t add_raw(const contig_t& s, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx, const bool hot = false);
+    uint32_t add(const contig_t& s, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx, const bool hot = false);
+
+    // Reference already packed (e.g., part copied from other archive); ref is its decoded form
+    void add_packed_ref(const vector<uint8_t>& packed_ref, const uint64_t raw_size, const contig_t& ref);
+
+    // Add member already LZ-encoded against the same reference as the one of this segment
+    uint32_t add_encoded(const contig_t& delta, ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx, const bool hot = false);
     uint64_t estimate(const contig_t& s, uint32_t bound, ZSTD_DCtx* zstd_dctx);
 
     void get_coding_cost(const contig_t& s, vector<uint32_t> &v_costs, const bool prefix_costs, ZSTD_DCtx* zstd_dctx);
 
     void finish(ZSTD_CCtx* zstd_ctx);
-    bool get_raw(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx);
-    bool get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx);
 
-    bool get_raw_locked(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx);
-    bool get_locked(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx);
+    // Incomplete packs are stored as by finish(), but the state of the segment is kept, so they are stored again later.
+    // Pack layout including these packs is returned
+    void store_checkpoint(ZSTD_CCtx* zstd_ctx, vector<uint32_t>& v_checkpoint_pack_ends);
+
+    // Sequence (or its reverse complement) is stored in ctg starting from ctg_pos; ctg is resized to fit it exactly
+    bool get_raw(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx, const size_t ctg_pos = 0, const bool rev_comp = false);
+    bool get(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx, const size_t ctg_pos = 0, const bool rev_comp = false);
+
+    bool get_raw_locked(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx, const size_t ctg_pos = 0, const bool rev_comp = false);
+    bool get_locked(const uint32_t id_seq, contig_t& ctg, ZSTD_DCtx* zstd_ctx, const size_t ctg_pos = 0, const bool rev_comp = false);
 
     void clear();
     uint64_t get_no_seqs();
 
     size_t get_ref_size() const;
 
+    // LZ index of the reference is rebuilt on demand, so it can be released to save memory.
+    // If idle_only, it is released only if it was not used since the previous call
+    size_t get_index_memory();
+    size_t release_index(const bool idle_only);
+
     void appending_init();
+
+    // All members (LZ-encoded for groups with reference, raw for raw groups) in the order of in-group ids (reference excluded)
+    bool get_encoded_members(vector<contig_t>& v_members, ZSTD_DCtx* zstd_ctx);
+
+    void set_hot_contigs_in_pack(const uint32_t _hot_contigs_in_pack);
+
+    // Layout must be set before any other operation (empty layout means uniform packs)
+    void set_pack_layout(const vector<uint32_t>& _v_pack_ends);
+    const vector<uint32_t>& get_pack_layout() const;
 };
 
 // EOF
@@ -0,0 +1,377 @@
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+using namespace std;
+
+// *******************************************************************************************
+// Group of tasks that can be waited for together
+class CTaskGroup
+{
+	friend class CThreadPool;
+
+	atomic<int64_t> no_pending{ 0 };
+
+public:
+	CTaskGroup() = default;
+	CTaskGroup(const CTaskGroup&) = delete;
+	CTaskGroup& operator=(const CTaskGroup&) = delete;
+
+	bool IsCompleted() const
+	{
+		return no_pending.load() == 0;
+	}
+};
+
+// *******************************************************************************************
+// Persistent work-stealing thread pool
+//   * each worker owns a deque of tasks; it takes its own tasks from the back and steals from the front of the others
+//   * tasks submitted from outside the pool go to the shared (injection) deque
+//   * a thread waiting for a group executes the queued tasks of this group, so nested parallelism cannot deadlock
+//   * long-running tasks (e.g., workers synchronized by barriers) require Reserve() to be called before, to guarantee
+//     that all of them can run at the same time
+class CThreadPool
+{
+	struct task_t
+	{
+		function<void()> job;
+		CTaskGroup* group;
+	};
+
+	struct worker_deque_t
+	{
+		mutex mtx;
+		deque<task_t> q;
+	};
+
+	vector<thread> v_workers;
+	vector<unique_ptr<worker_deque_t>> v_deques;				// [0] - injection deque, [i+1] - deque of i-th worker
+	atomic<uint32_t> no_workers{ 0 };
+	uint32_t max_threads;
+
+	mutex mtx_workers;											// protects creation of workers
+
+	mutex mtx_sleep;
+	condition_variable cv_sleep;
+	atomic<int64_t> no_queued{ 0 };
+	bool stop = false;
+
+	mutex mtx_pinning;
+	function<void(uint32_t)> pinning_hook;
+	atomic<uint32_t> pinning_generation{ 0 };
+
+	static constexpr uint32_t max_no_deques = 1024;
+
+	inline static thread_local CThreadPool* tl_pool = nullptr;
+	inline static thread_local uint32_t tl_deque_id = 0;
+
+	// *******************************************************************************************
+	void apply_pinning(uint32_t worker_id, uint32_t& generation)
+	{
+		uint32_t curr_generation = pinning_generation.load();
+
+		if (curr_generation == generation)
+			return;
+
+		function<void(uint32_t)> hook;
+		{
+			lock_guard<mutex> lck(mtx_pinning);
+			hook = pinning_hook;
+		}
+
+		if (hook)
+			hook(worker_id);
+
+		generation = curr_generation;
+	}
+
+	// *******************************************************************************************
+	bool pop_from(uint32_t deque_id, bool from_back, task_t& task, CTaskGroup* group)
+	{
+		auto& wd = *v_deques[deque_id];
+		lock_guard<mutex> lck(wd.mtx);
+
+		if (wd.q.empty())
+			return false;
+
+		if (group == nullptr)
+		{
+			if (from_back)
+			{
+				task = move(wd.q.back());
+				wd.q.pop_back();
+			}
+			else
+			{
+				task = move(wd.q.front());
+				wd.q.pop_front();
+			}
+		}
+		else
+		{
+			// Only tasks of the given group are taken by a waiting thread
+			auto p = wd.q.end();
+
+			if (from_back)
+			{
+				for (auto q = wd.q.rbegin(); q != wd.q.rend(); ++q)
+					if (q->group == group)
+					{
+						p = prev(q.base());
+						break;
+					}
+			}
+			else
+			{
+				for (auto q = wd.q.begin(); q != wd.q.end(); ++q)
+					if (q->group == group)
+					{
+						p = q;
+						break;
+					}
+			}
+
+			if (p == wd.q.end())
+				return false;
+
+			task = move(*p);
+			wd.q.erase(p);
+		}
+
+		no_queued.fetch_sub(1);
+
+		return true;
+	}
+
+	// *******************************************************************************************
+	bool try_pop(uint32_t own_deque_id, task_t& task, CTaskGroup* group = nullptr)
+	{
+		uint32_t n_deques = no_workers.load() + 1;
+
+		if (own_deque_id && pop_from(own_deque_id, true, task, group))
+			return true;
+
+		if (pop_from(0, false, task, group))
+			return true;
+
+		for (uint32_t i = 1; i < n_deques; ++i)
+		{
+			uint32_t id = (own_deque_id + i) % n_deques;
+			if (id != 0 && pop_from(id, false, task, group))
+				return true;
+		}
+
+		return false;
+	}
+
+	// *******************************************************************************************
+	void run_task(task_t& task)
+	{
+		task.job();
+		task.job = nullptr;
+
+		task.group->no_pending.fetch_sub(1);
+		task.group->no_pending.notify_all();
+	}
+
+	// *******************************************************************************************
+	void worker_loop(uint32_t worker_id)
+	{
+		tl_pool = this;
+		tl_deque_id = worker_id + 1;
+
+		uint32_t generation = 0;
+		task_t task;
+
+		while (true)
+		{
+			apply_pinning(worker_id, generation);
+
+			if (try_pop(tl_deque_id, task))
+			{
+				run_task(task);
+				continue;
+			}
+
+			unique_lock<mutex> lck(mtx_sleep);
+			cv_sleep.wait(lck, [this, generation] {return stop || no_queued.load() > 0 || pinning_generation.load() != generation; });
+
+			if (stop && no_queued.load() == 0)
+				break;
+		}
+	}
+
+	// *******************************************************************************************
+	void grow(uint32_t n)
+	{
+		lock_guard<mutex> lck(mtx_workers);
+
+		n = min(n, max_no_deques - 1);
+
+		while (no_workers.load() < n)
+		{
+			uint32_t worker_id = no_workers.load();
+
+			v_workers.emplace_back([this, worker_id] {worker_loop(worker_id); });
+			no_workers.fetch_add(1);
+		}
+	}
+
+public:
+	// *******************************************************************************************
+	CThreadPool(uint32_t _max_threads = 0) : max_threads(_max_threads)
+	{
+		// Deques are allocated once to allow lock-free access to v_deques
+		v_deques.reserve(max_no_deques);
+		for (uint32_t i = 0; i < max_no_deques; ++i)
+			v_deques.emplace_back(make_unique<worker_deque_t>());
+	}
+
+	CThreadPool(const CThreadPool&) = delete;
+	CThreadPool& operator=(const CThreadPool&) = delete;
+
+	// *******************************************************************************************
+	~CThreadPool()
+	{
+		{
+			lock_guard<mutex> lck(mtx_sleep);
+			stop = true;
+		}
+		cv_sleep.notify_all();
+
+		for (auto& t : v_workers)
+			t.join();
+	}
+
+	// *******************************************************************************************
+	// Upper limit of parallelism requested by the owner (0 - no limit)
+	void SetMaxThreads(uint32_t _max_threads)
+	{
+		max_threads = _max_threads;
+	}
+
+	// *******************************************************************************************
+	uint32_t GetMaxThreads() const
+	{
+		return max_threads;
+	}
+
+	// *******************************************************************************************
+	uint32_t LimitThreads(uint32_t n) const
+	{
+		if (max_threads && n > max_threads)
+			return max(1u, max_threads);
+
+		return max(1u, n);
+	}
+
+	// *******************************************************************************************
+	uint32_t GetNoWorkers() const
+	{
+		return no_workers.load();
+	}
+
+	// *******************************************************************************************
+	// Hook called in the context of each worker (before it executes any task and after each change of the hook)
+	// Can be used, e.g., to pin workers to cores or NUMA nodes
+	void SetPinningHook(function<void(uint32_t)> hook)
+	{
+		{
+			lock_guard<mutex> lck(mtx_pinning);
+			pinning_hook = move(hook);
+		}
+
+		{
+			lock_guard<mutex> lck(mtx_sleep);
+			pinning_generation.fetch_add(1);
+		}
+		cv_sleep.notify_all();
+	}
+
+	// *******************************************************************************************
+	// Make sure that at least n workers exist
+	void Reserve(uint32_t n)
+	{
+		if (no_workers.load() < n)
+			grow(n);
+	}
+
+	// *******************************************************************************************
+	void Launch(CTaskGroup& group, function<void()> job)
+	{
+		if (no_workers.load() == 0)
+			grow(1);
+
+		group.no_pending.fetch_add(1);
+
+		uint32_t deque_id = (tl_pool == this) ? tl_deque_id : 0;
+
+		{
+			auto& wd = *v_deques[deque_id];
+			lock_guard<mutex> lck(wd.mtx);
+			wd.q.emplace_back(task_t{ move(job), &group });
+		}
+
+		{
+			lock_guard<mutex> lck(mtx_sleep);
+			no_queued.fetch_add(1);
+		}
+		cv_sleep.notify_one();
+	}
+
+	// *******************************************************************************************
+	// Wait for completion of all tasks from the group. The calling thread executes the queued tasks of the group.
+	void Wait(CTaskGroup& group)
+	{
+		uint32_t own_deque_id = (tl_pool == this) ? tl_deque_id : 0;
+		task_t task;
+
+		while (true)
+		{
+			int64_t n = group.no_pending.load();
+
+			if (n == 0)
+				break;
+
+			if (try_pop(own_deque_id, task, &group))
+				run_task(task);
+			else
+				group.no_pending.wait(n);
+		}
+	}
+
+	// *******************************************************************************************
+	// Run job in n instances (n-1 in the pool and 1 in the calling thread) and wait for all of them
+	void ParallelRun(uint32_t n, const function<void()>& job)
+	{
+		CTaskGroup group;
+
+		for (uint32_t i = 1; i < n; ++i)
+			Launch(group, job);
+
+		job();
+
+		Wait(group);
+	}
+};
+
+// EOF
+#endif
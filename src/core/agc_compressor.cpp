@@ -13,11 +13,13 @@
 #include <set>
 #include <unordered_set>
 #include <filesystem>
+#include <fstream>
 #include "agc_compressor.h"
 #include "agc_decompressor.h"
+#include "../common/digest.h"
+#include "../common/cpu_dispatch.h"
 
 #include <execution>
-#include <future>
 
 #include <chrono>
 
@@ -60,6 +62,11 @@ CAGCCompressor::CAGCCompressor() : CAGCBasic()
 
     map_segments.max_load_factor(1);
     map_segments_terminators.max_load_factor(1);
+
+    buffered_seg_part.set_thread_pool(thread_pool.get());
+
+    hs_splitters.set_memory_advisor([this](void* ptr, size_t size) {advise_memory(ptr, size); });
+    bloom_splitters.set_memory_advisor([this](void* ptr, size_t size) {advise_memory(ptr, size); });
 }
 
 // *******************************************************************************************
@@ -172,7 +179,7 @@ void CAGCCompressor::store_metadata_impl_v3(uint32_t no_threads)
 }
 
 // *******************************************************************************************
-void CAGCCompressor::store_metadata(uint32_t no_threads)
+void CAGCCompressor::store_metadata(uint32_t no_threads, const bool print_stats)
 {
     if (archive_version < 2000)
         store_metadata_impl_v1(no_threads);
@@ -213,6 +220,12 @@ void CAGCCompressor::store_metadata(uint32_t no_threads)
     if(archive_version >= 2000)
         append(v_params, compression_params.segment_size);
 
+    if (has_pack_ext())
+    {
+        append(v_params, seekable_packs ? 1u : 0u);     // pack flags
+        store_pack_layouts();
+    }
+
     auto compression_params_id = out_archive->RegisterStream("params");
     out_archive->AddPart(compression_params_id, v_params);
 
@@ -251,7 +264,7 @@ void CAGCCompressor::store_metadata(uint32_t no_threads)
     auto map_segments_id = out_archive->RegisterStream("segment-splitters");
     out_archive->AddPart(map_segments_id, v_tmp, map_segments.size());
 
-    if (verbosity > 0 && is_app_mode)
+    if (verbosity > 0 && is_app_mode && print_stats)
     {
         cerr << endl;
         cerr << "*** Component sizes ***" << endl;
@@ -283,6 +296,67 @@ void CAGCCompressor::store_metadata(uint32_t no_threads)
     }
 }
 
+// *******************************************************************************************
+void CAGCCompressor::store_pack_layouts()
+{
+    vector<uint8_t> v_data;
+
+    for (uint32_t i = 0; i < (uint32_t) vv_pack_layouts.size(); ++i)
+    {
+        auto& v_pack_ends = vv_pack_layouts[i];
+
+        if (v_pack_ends.empty())
+            continue;
+
+        append(v_data, i);
+        append(v_data, (uint32_t) v_pack_ends.size());
+
+        for (size_t j = 0; j < v_pack_ends.size(); ++j)
+            append(v_data, v_pack_ends[j] - (j ? v_pack_ends[j - 1] : 0));
+    }
+
+    if (v_data.empty())
+        return;
+
+    vector<uint8_t> v_packed(ZSTD_compressBound(v_data.size()));
+    v_packed.resize(ZSTD_compress(v_packed.data(), v_packed.size(), v_data.data(), v_data.size(), 19));
+
+    auto s_id = out_archive->RegisterStream("pack-layout");
+    out_archive->AddPart(s_id, v_packed, v_data.size());
+}
+
+// *******************************************************************************************
+shared_ptr<CSegment> CAGCCompressor::make_segment(const uint32_t group_id, shared_ptr<CArchive> _in_archive)
+{
+    auto segment = make_shared<CSegment>(ss_base(archive_version, group_id), _in_archive, out_archive, pack_cardinality, min_match_len, concatenated_genomes, archive_version, seekable_packs);
+
+    segment->set_hot_contigs_in_pack(hot_pack_cardinality);
+
+    auto p_layout = m_pack_layouts.find(group_id);
+    if (p_layout != m_pack_layouts.end())
+        segment->set_pack_layout(p_layout->second);
+
+    return segment;
+}
+
+// *******************************************************************************************
+void CAGCCompressor::create_raw_groups()
+{
+    map_segments[std::make_pair(~0ull, ~0ull)] = 0;
+
+    v_segments.resize(no_raw_groups);
+
+    for (no_segments = 0; no_segments < no_raw_groups; ++no_segments)
+    {
+        contig_t empty_ctg{ 0x7f };
+
+        out_archive->RegisterStream(ss_delta_name(archive_version, no_segments));
+
+        v_segments[no_segments] = make_segment(no_segments, nullptr);
+        v_segments[no_segments]->add_raw(empty_ctg, nullptr, nullptr);		// To ensure that raw (special) segments are present in the archive
+    }
+}
+
 // *******************************************************************************************
 void CAGCCompressor::store_file_type_info()
 {
@@ -315,7 +389,7 @@ void CAGCCompressor::appending_init()
         if (ref_stream_id < 0 && delta_stream_id < 0)
             break;
 
-        v_segments.emplace_back(make_shared<CSegment>(ss_base(archive_version, no_segments), in_archive, out_archive, pack_cardinality, min_match_len, concatenated_genomes, archive_version));
+        v_segments.emplace_back(make_segment(no_segments, in_archive));
         v_segments.back()->appending_init();
 
         ++no_segments;
@@ -424,6 +498,19 @@ void CAGCCompressor::add_fallback_mapping(uint64_t splitter1, uint64_t splitter2
         mfm_kd.emplace_back(to_add);
 }
 
+// *******************************************************************************************
+// Allocate (and fill with empty values) the array of candidate k-mers; it is shared by all threads, so its memory placement is set before touching it
+void CAGCCompressor::allocate_candidate_kmers(const size_t size)
+{
+    v_candidate_kmers.clear();
+    v_candidate_kmers.shrink_to_fit();
+
+    v_candidate_kmers.reserve(size);
+    advise_memory(v_candidate_kmers.data(), size * sizeof(uint64_t));
+
+    v_candidate_kmers.resize(size, ~0ull);
+}
+
 // *******************************************************************************************
 bool CAGCCompressor::determine_splitters(const string& reference_file_name, const size_t segment_size, const uint32_t no_threads)
 {
@@ -438,7 +525,7 @@ bool CAGCCompressor::determine_splitters(const string& reference_file_name, cons
     string id;
     contig_t contig;
 
-    v_candidate_kmers.resize(gio.FileSize() + raduls::ALIGNMENT / 8 + contig_part_size * (no_threads + 1) + 1, ~0ull);
+    allocate_candidate_kmers(gio.FileSize() + raduls::ALIGNMENT / 8 + contig_part_size * (no_threads + 1) + 1);
 
     auto alignment_shift = ((uint64_t)v_candidate_kmers.data()) % raduls::ALIGNMENT;
 //    auto extra_items = raduls::ALIGNMENT / 8 - alignment_shift / 8;
@@ -448,9 +535,9 @@ bool CAGCCompressor::determine_splitters(const string& reference_file_name, cons
         cerr << "Gathering reference k-mers\n";
 
     q_contigs_data = make_unique<CBoundedQueue<contig_t>>(1, contig_part_size * no_threads * 3);
-    vector<thread> v_threads;
+    CTaskGroup task_group;
 
-    start_kmer_collecting_threads(v_threads, no_threads, v_candidate_kmers, v_candidate_kmers_offset);
+    start_kmer_collecting_threads(task_group, no_threads, v_candidate_kmers, v_candidate_kmers_offset);
 
     while (gio.ReadContigRaw(id, contig))
     {
@@ -471,7 +558,7 @@ bool CAGCCompressor::determine_splitters(const string& reference_file_name, cons
 
     q_contigs_data->MarkCompleted();
 
-    join_threads(v_threads);
+    thread_pool->Wait(task_group);
 
     q_contigs_data.release();
 
@@ -513,12 +600,12 @@ bool CAGCCompressor::determine_splitters(const string& reference_file_name, cons
     }
 
     // Determine splitters
-    pq_contigs_raw = make_unique<CBoundedPQueue<contig_t>>(1, 4ull << 30);
+    pq_contigs_raw = make_unique<CBoundedPQueue<contig_t>>(1, min<size_t>(4ull << 30, memory_share()));
 
     vv_splitters.resize(no_threads);
     vv_fallback_minimizers.resize(no_threads);
 
-    start_splitter_finding_threads(v_threads, no_threads, v_begin, v_end, vv_splitters);
+    start_splitter_finding_threads(task_group, no_threads, v_begin, v_end, vv_splitters);
 
     while (gio.ReadContigRaw(id, contig))
     {
@@ -529,7 +616,7 @@ bool CAGCCompressor::determine_splitters(const string& reference_file_name, cons
 
     pq_contigs_raw->MarkCompleted();
 
-    join_threads(v_threads);
+    thread_pool->Wait(task_group);
 
     pq_contigs_raw.release();
 
@@ -570,7 +657,7 @@ bool CAGCCompressor::count_kmers(vector<pair<string, vector<uint8_t>>>& v_contig
     for (auto& cd : v_contig_data)
         tot_contig_len += cd.second.size();
 
-    v_candidate_kmers.resize(tot_contig_len + raduls::ALIGNMENT / 8 + contig_part_size * (no_threads + 1) + 1, ~0ull);
+    allocate_candidate_kmers(tot_contig_len + raduls::ALIGNMENT / 8 + contig_part_size * (no_threads + 1) + 1);
 
     auto alignment_shift = ((uint64_t)v_candidate_kmers.data()) % raduls::ALIGNMENT;
     //    auto extra_items = raduls::ALIGNMENT / 8 - alignment_shift / 8;
@@ -580,9 +667,9 @@ bool CAGCCompressor::count_kmers(vector<pair<string, vector<uint8_t>>>& v_contig
         cerr << "Gathering reference k-mers\n";
 
     q_contigs_data = make_unique<CBoundedQueue<contig_t>>(1, contig_part_size * no_threads * 3);
-    vector<thread> v_threads;
+    CTaskGroup task_group;
 
-    start_kmer_collecting_threads(v_threads, no_threads, v_candidate_kmers, v_candidate_kmers_offset);
+    start_kmer_collecting_threads(task_group, no_threads, v_candidate_kmers, v_candidate_kmers_offset);
 
     for (auto& cd : v_contig_data)
     {
@@ -603,7 +690,7 @@ bool CAGCCompressor::count_kmers(vector<pair<string, vector<uint8_t>>>& v_contig
 
     q_contigs_data->MarkCompleted();
 
-    join_threads(v_threads);
+    thread_pool->Wait(task_group);
 
     q_contigs_data.release();
 
@@ -704,15 +791,14 @@ void CAGCCompressor::remove_non_singletons(vector<uint64_t>& vec, vector<uint64_
 }
 
 // *******************************************************************************************
-void CAGCCompressor::start_kmer_collecting_threads(vector<thread> &v_threads, const uint32_t n_t, vector<uint64_t>& v_kmers, const size_t extra_items)
+void CAGCCompressor::start_kmer_collecting_threads(CTaskGroup &task_group, const uint32_t n_t, vector<uint64_t>& v_kmers, const size_t extra_items)
 {
-    v_threads.clear();
-    v_threads.reserve(n_t);
+    thread_pool->Reserve(n_t);
 
     a_part_id = 0;
 
     for (uint32_t i = 0; i < n_t; ++i)
-        v_threads.emplace_back([&, extra_items] {
+        thread_pool->Launch(task_group, [&, extra_items] {
 
         CKmer kmer(kmer_length, kmer_mode_t::canonical);
 
@@ -847,14 +933,13 @@ void CAGCCompressor::build_candidate_kmers_from_archive(const uint32_t n_t)
 }
 
 // *******************************************************************************************
-void CAGCCompressor::start_splitter_finding_threads(vector<thread>& v_threads, const uint32_t n_t, 
+void CAGCCompressor::start_splitter_finding_threads(CTaskGroup& task_group, const uint32_t n_t, 
     const vector<uint64_t>::iterator v_begin, const vector<uint64_t>::iterator v_end, vector<vector<uint64_t>>& v_splitters)
 {
-    v_threads.clear();
-    v_threads.reserve(n_t);
+    thread_pool->Reserve(n_t);
 
     for (uint32_t i = 0; i < n_t; ++i)
-        v_threads.emplace_back([&, i, v_begin, v_end] {
+        thread_pool->Launch(task_group, [&, i, v_begin, v_end] {
 
         uint32_t thread_id = i;
 
@@ -877,15 +962,17 @@ void CAGCCompressor::start_splitter_finding_threads(vector<thread>& v_threads, c
 }
 
 // *******************************************************************************************
-void CAGCCompressor::start_finalizing_threads(vector<thread>& v_threads, const uint32_t n_t)
+void CAGCCompressor::start_finalizing_threads(CTaskGroup& task_group, const uint32_t n_t)
 {
-    v_threads.clear();
-    v_threads.reserve(n_t);
+    thread_pool->Reserve(n_t);
 
     id_segment = 0;
 
+    vv_pack_layouts.clear();
+    vv_pack_layouts.resize(no_segments);
+
     for (uint32_t i = 0; i < n_t; ++i)
-        v_threads.emplace_back([&] {
+        thread_pool->Launch(task_group, [&] {
         auto zstd_ctx = ZSTD_createCCtx();
 
         while (true)
@@ -896,6 +983,7 @@ void CAGCCompressor::start_finalizing_threads(vector<thread>& v_threads, const u
                 break;
 
             v_segments[j]->finish(zstd_ctx);
+            vv_pack_layouts[j] = v_segments[j]->get_pack_layout();
             v_segments[j].reset();
         }
 
@@ -903,50 +991,55 @@ void CAGCCompressor::start_finalizing_threads(vector<thread>& v_threads, const u
         });
 }
 
+// *******************************************************************************************
+// Contig must be already preprocessed (symbol codes)
+contig_stats_t CAGCCompressor::count_contig_stats(const contig_t& ctg) const
+{
+    array<uint64_t, 32> hist{};
+
+    for (auto c : ctg)
+        ++hist[c & 31];
+
+    // codes: C - 1, G - 2, N - 4, S - 7
+    return contig_stats_t(ctg.size(), hist[1] + hist[2] + hist[7], hist[4]);
+}
+
+// *******************************************************************************************
+// Contig must be already preprocessed (symbol codes)
+// Digests are computed over the sequence as it is decompressed, so it is converted back to letters in small chunks
+contig_digest_t CAGCCompressor::compute_contig_digest(const contig_t& ctg) const
+{
+    const size_t chunk_size = 1 << 16;
+    array<uint8_t, chunk_size> chunk;
+
+    CMD5 md5;
+    CSHA512 sha512;
+
+    for (size_t i = 0; i < ctg.size(); i += chunk_size)
+    {
+        size_t len = min(chunk_size, ctg.size() - i);
+
+        for (size_t j = 0; j < len; ++j)
+            chunk[j] = cnv_num[ctg[i + j] & 127];
+
+        md5.Update(chunk.data(), len);
+        sha512.Update(chunk.data(), len);
+    }
+
+    contig_digest_t digest;
+
+    digest.md5 = md5.Final();
+
+    auto sha = sha512.Final();
+    copy_n(sha.begin(), digest.sha512t24.size(), digest.sha512t24.begin());
+
+    return digest;
+}
+
 // *******************************************************************************************
 void CAGCCompressor::preprocess_raw_contig(contig_t& ctg)
 {
-    size_t len = ctg.size();
-    size_t in_pos = 0;
-    size_t out_pos = 0;
-
-    uint8_t c;
-
-    switch (len % 4)
-    {
-    case 3:
-        c = ctg[in_pos++];
-        if (c >> 6)                          // (c >= 64)
-            ctg[out_pos++] = cnv_num[c];
-        [[fallthrough]];
-    case 2:
-        c = ctg[in_pos++];
-        if (c >> 6)                          // (c >= 64)
-            ctg[out_pos++] = cnv_num[c];
-        [[fallthrough]];
-    case 1:
-        c = ctg[in_pos++];
-        if (c >> 6)                          // (c >= 64)
-            ctg[out_pos++] = cnv_num[c];
-    }
-
-    for (; in_pos < len;)
-    {
-        c = ctg[in_pos++];
-        if (c >> 6)                          // (c >= 64)
-            ctg[out_pos++] = cnv_num[c];
-        c = ctg[in_pos++];
-        if (c >> 6)                          // (c >= 64)
-            ctg[out_pos++] = cnv_num[c];
-        c = ctg[in_pos++];
-        if (c >> 6)                          // (c >= 64)
-            ctg[out_pos++] = cnv_num[c];
-        c = ctg[in_pos++];
-        if (c >> 6)                          // (c >= 64)
-            ctg[out_pos++] = cnv_num[c];
-    }
-
-    ctg.resize(out_pos);
+    ctg.resize(CCpuDispatch::Instance().pack_raw_contig(ctg.data(), ctg.size(), cnv_num));
 //    ctg.shrink_to_fit();
 }
 
@@ -1002,7 +1095,7 @@ void CAGCCompressor::store_segments(ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx)
                 {
                     if (v_segments[group_id] == nullptr)
                     {
-                        v_segments[group_id] = make_shared<CSegment>(ss_base(archive_version, group_id), nullptr, out_archive, pack_cardinality, min_match_len, concatenated_genomes, archive_version);
+                        v_segments[group_id] = make_segment(group_id, nullptr);
 
                         seg_map_mtx.lock();
 
@@ -1027,12 +1120,14 @@ void CAGCCompressor::store_segments(ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx)
                         seg_map_mtx.unlock();
                     }
 
+                    bool is_hot = !hot_samples.empty() && hot_samples.count(sample_name);
+
                     if (group_id < (int)no_raw_groups)
                     {
-                        in_group_id = v_segments[group_id]->add_raw(seg_data, zstd_cctx, zstd_dctx);
+                        in_group_id = v_segments[group_id]->add_raw(seg_data, zstd_cctx, zstd_dctx, is_hot);
                     }
                     else
-                        in_group_id = v_segments[group_id]->add(seg_data, zstd_cctx, zstd_dctx);
+                        in_group_id = v_segments[group_id]->add(seg_data, zstd_cctx, zstd_dctx, is_hot);
 
                     //                    collection_desc->add_segment_placed(sample_name, contig_name, seg_part_no, group_id, in_group_id, is_rev_comp, (uint32_t)seg_data.size());
                     if (buffered_coll_insertions.size() == max_buff_size)
@@ -1090,21 +1185,30 @@ void CAGCCompressor::compressing_stage2_job(uint32_t thread_id, uint32_t n_t)
 
 // *******************************************************************************************
 // Start compressing threads
-void CAGCCompressor::start_compressing_threads(vector<thread>& v_threads, my_barrier &bar, const uint32_t n_t)
+void CAGCCompressor::start_compressing_threads(CTaskGroup& task_group, my_barrier &bar, const uint32_t n_t)
 {
-    v_threads.clear();
+    // Workers are synchronized by barriers, so all of them must run at the same time.
+    // Extra workers execute the tasks spawned during the search of candidate segments.
+    thread_pool->Reserve(2 * n_t);
+
+    while (v_arenas.size() < n_t)
+        v_arenas.emplace_back(make_unique<CArena>());
 
     for (uint32_t i = 0; i < n_t; ++i)
     {
-        v_threads.emplace_back([&, i, n_t]() {
+        thread_pool->Launch(task_group, [&, i, n_t]() {
             auto zstd_cctx = ZSTD_createCCtx();
             auto zstd_dctx = ZSTD_createDCtx();
             uint32_t thread_id = i;
+            auto& arena = *v_arenas[thread_id];
 
             while(true)
             {
                 task_t task;
 
+                // Temporaries of the previous task are not needed anymore
+                arena.Reset();
+
                 auto q_res = pq_contigs_desc_working->PopLarge(task);
                 if (q_res == CBoundedPQueue<task_t>::result_t::empty)
                     continue;
@@ -1137,7 +1241,38 @@ void CAGCCompressor::start_compressing_threads(vector<thread>& v_threads, my_bar
                     {
                         buffered_seg_part.clear(max(1u, n_t-1));
 
+                        if (index_memory_limit != ~0ull)
+                            limit_index_memory();
+
                         if (n_t == 1)
+                        {
+                            if (get<1>(task) != partial_sync_name)
+                            {
+                                if (!concatenated_genomes)
+                                    ++processed_samples;
+                                else
+                                {
+                                    processed_samples = processed_samples / pack_cardinality * pack_cardinality + pack_cardinality;
+
+                                    auto max_ps = dynamic_pointer_cast<CCollection_V3>(collection_desc)->get_no_samples();
+                                    if (max_ps < processed_samples)
+                                        processed_samples = (uint32_t) max_ps;
+                                }
+
+                                if (archive_version >= 3000 && processed_samples % pack_cardinality == 0)
+                                    dynamic_pointer_cast<CCollection_V3>(collection_desc)->store_contig_batch(processed_samples - pack_cardinality, processed_samples);
+                            }
+
+                            out_archive->FlushOutBuffers();
+                        }
+
+                        // !!! ???
+                        if(adaptive_compression)
+                            pq_contigs_desc_working = pq_contigs_desc;
+                    }
+                    else if (thread_id == 1)
+                    {
+                        if (get<1>(task) != partial_sync_name)
                         {
                             if (!concatenated_genomes)
                                 ++processed_samples;
@@ -1152,34 +1287,35 @@ void CAGCCompressor::start_compressing_threads(vector<thread>& v_threads, my_bar
 
                             if (archive_version >= 3000 && processed_samples % pack_cardinality == 0)
                                 dynamic_pointer_cast<CCollection_V3>(collection_desc)->store_contig_batch(processed_samples - pack_cardinality, processed_samples);
-
-                            out_archive->FlushOutBuffers();
                         }
 
-                        // !!! ???
-                        if(adaptive_compression)
-                            pq_contigs_desc_working = pq_contigs_desc;
+                        out_archive->FlushOutBuffers();
                     }
-                    else if (thread_id == 1)
+
+                    bar.arrive_and_wait();
+
+                    if (checkpoint_interval && processed_samples >= checkpoint_samples + checkpoint_interval)
                     {
-                        if (!concatenated_genomes)
-                            ++processed_samples;
-                        else
+                        if (thread_id == 0)
                         {
-                            processed_samples = processed_samples / pack_cardinality * pack_cardinality + pack_cardinality;
+                            out_archive->BeginCheckpoint();
 
-                            auto max_ps = dynamic_pointer_cast<CCollection_V3>(collection_desc)->get_no_samples();
-                            if (max_ps < processed_samples)
-                                processed_samples = (uint32_t) max_ps;
+                            vv_pack_layouts.clear();
+                            vv_pack_layouts.resize(no_segments);
+                            id_segment = 0;
                         }
 
-                        if (archive_version >= 3000 && processed_samples % pack_cardinality == 0)
-                            dynamic_pointer_cast<CCollection_V3>(collection_desc)->store_contig_batch(processed_samples - pack_cardinality, processed_samples);
+                        bar.arrive_and_wait();
 
-                        out_archive->FlushOutBuffers();
-                    }
+                        store_checkpoint_segments(zstd_cctx);
 
-                    bar.arrive_and_wait();
+                        bar.arrive_and_wait();
+
+                        if (thread_id == 0)
+                            store_checkpoint();
+
+                        bar.arrive_and_wait();
+                    }
 
                     continue;
                 }
@@ -1222,7 +1358,7 @@ void CAGCCompressor::start_compressing_threads(vector<thread>& v_threads, my_bar
 
                         v_raw_contigs.clear();
 
-                        pq_contigs_desc_aux->EmplaceManyNoCost(make_tuple(contig_processing_stage_t::registration, "", "", contig_t()), 0, n_t);
+                        pq_contigs_desc_aux->EmplaceManyNoCost(make_tuple(contig_processing_stage_t::registration, get<1>(task), "", contig_t()), 0, n_t);
 
                         pq_contigs_desc_working = pq_contigs_desc_aux;
                     }
@@ -1239,6 +1375,8 @@ void CAGCCompressor::start_compressing_threads(vector<thread>& v_threads, my_bar
                 if (get<0>(task) == contig_processing_stage_t::all_contigs)
                 {
                     preprocess_raw_contig(get<3>(task));
+                    collection_desc->set_contig_stats(get<1>(task), get<2>(task), count_contig_stats(get<3>(task)));
+                    collection_desc->set_contig_digest(get<1>(task), get<2>(task), compute_contig_digest(get<3>(task)));
                 }
 
                 size_t ctg_size = get<3>(task).size();
@@ -1282,6 +1420,7 @@ pair_segment_desc_t CAGCCompressor::add_segment(const string& sample_name, const
     bool store2_rc = false;
 
     int segment_id{ -1 }, segment_id2{ -1 };
+    auto& arena = *v_arenas[thread_id];
 
     if (!kmer_front.is_full() && !kmer_back.is_full())
     {
@@ -1290,11 +1429,8 @@ pair_segment_desc_t CAGCCompressor::add_segment(const string& sample_name, const
         if (fallback_filter)       // Try fallback minimizers procedure
         {
 //            tie(pk, store_rc) = find_cand_segment_using_fallback_minimizers(segment, 2);
-            tie(pk, store_rc) = find_cand_segment_using_fallback_minimizers(segment, 1);
+            tie(pk, store_rc) = find_cand_segment_using_fallback_minimizers(segment, 1, arena);
 //            tie(pk, store_rc) = find_cand_segment_using_fallback_minimizers(segment, (uint64_t) (segment.size() * fallback_frac * 0.2));
-
-            if(pk != pk_empty && store_rc)
-                reverse_complement_copy(segment, segment_rc);
         }
         else
             pk = pk_empty;
@@ -1308,23 +1444,22 @@ pair_segment_desc_t CAGCCompressor::add_segment(const string& sample_name, const
         else
         {
             pk = make_pair(kmer_back.data(), kmer_front.data());
-            reverse_complement_copy(segment, segment_rc);
             store_rc = true;
         }
     }
     else if (kmer_front.is_full())
     {
         CKmer kmer = kmer_front;
-        reverse_complement_copy(segment, segment_rc);
 
-        tie(pk, store_rc) = find_cand_segment_with_one_splitter(kmer, segment, segment_rc, zstd_dctx, bar);
+        // segment_rc is built by find_cand_segment_with_one_splitter only if some candidate needs it
+        tie(pk, store_rc) = find_cand_segment_with_one_splitter(kmer, segment, segment_rc, zstd_dctx, bar, arena);
 
         if (pk.first == ~0ull || pk.second == ~0ull)
         {
             auto pk_alt = pk;
             bool store_rc_alt = false;
 
-            tie(pk_alt, store_rc_alt) = find_cand_segment_using_fallback_minimizers(segment, 5);
+            tie(pk_alt, store_rc_alt) = find_cand_segment_using_fallback_minimizers(segment, 5, arena);
 //            tie(pk_alt, store_rc_alt) = find_cand_segment_using_fallback_minimizers(segment, (uint64_t)(segment.size() * fallback_frac * 0.1));
 
             if (pk_alt != pk_empty)
@@ -1338,10 +1473,9 @@ pair_segment_desc_t CAGCCompressor::add_segment(const string& sample_name, const
     {
         CKmer kmer = kmer_back;
         kmer.swap_dir_rc();
-        reverse_complement_copy(segment, segment_rc);
         bool store_dir;
 
-        tie(pk, store_dir) = find_cand_segment_with_one_splitter(kmer, segment_rc, segment, zstd_dctx, bar);
+        tie(pk, store_dir) = find_cand_segment_with_one_splitter(kmer, segment_rc, segment, zstd_dctx, bar, arena);
         store_rc = !store_dir;
 
         if (pk.first == ~0ull || pk.second == ~0ull)
@@ -1349,7 +1483,10 @@ pair_segment_desc_t CAGCCompressor::add_segment(const string& sample_name, const
             auto pk_alt = pk;
             bool store_dir_alt = false;
 
-            tie(pk_alt, store_dir_alt) = find_cand_segment_using_fallback_minimizers(segment_rc, 5);
+            if (segment_rc.empty())
+                reverse_complement_copy(segment, segment_rc);
+
+            tie(pk_alt, store_dir_alt) = find_cand_segment_using_fallback_minimizers(segment_rc, 5, arena);
 //            tie(pk_alt, store_dir_alt) = find_cand_segment_using_fallback_minimizers(segment_rc, (uint64_t)(segment.size() * fallback_frac * 0.1));
 
             if (pk_alt != pk_empty)
@@ -1390,7 +1527,7 @@ pair_segment_desc_t CAGCCompressor::add_segment(const string& sample_name, const
                 kmer2.swap_dir_rc();
             }
 
-            auto split_match = find_cand_segment_with_missing_middle_splitter(kmer1, kmer2, use_rc ? segment_rc : segment, use_rc ? segment : segment_rc, zstd_dctx, bar);
+            auto split_match = find_cand_segment_with_missing_middle_splitter(kmer1, kmer2, use_rc ? segment_rc : segment, use_rc ? segment : segment_rc, zstd_dctx, bar, arena);
 
             if (split_match.first != ~0ull)
             {
@@ -1463,7 +1600,7 @@ pair_segment_desc_t CAGCCompressor::add_segment(const string& sample_name, const
         pair<uint64_t, uint64_t> pk_fb;
         bool store_rc_fb;
 
-        tie(pk_fb, store_rc_fb) = find_cand_segment_using_fallback_minimizers(segment, 2);
+        tie(pk_fb, store_rc_fb) = find_cand_segment_using_fallback_minimizers(segment, 2, arena);
 //        tie(pk_fb, store_rc_fb) = find_cand_segment_using_fallback_minimizers(segment, (uint64_t)(segment.size() * fallback_frac * 0.05));
 
         if (pk_fb != pk_empty)
@@ -1471,12 +1608,13 @@ pair_segment_desc_t CAGCCompressor::add_segment(const string& sample_name, const
             pk = pk_fb;
             store_rc = store_rc_fb;
             p = map_segments.find(pk);
-
-            if (store_rc)
-                reverse_complement_copy(segment, segment_rc);
         }
     }
 
+    // Reverse complement is built lazily, only if it is stored or was needed by the candidate search
+    if (store_rc && segment_rc.empty())
+        reverse_complement_copy(segment, segment_rc);
+
     uint32_t segment_size = (uint32_t) segment.size();
     uint32_t segment2_size = (uint32_t) segment2.size();
 
@@ -1499,7 +1637,7 @@ pair_segment_desc_t CAGCCompressor::add_segment(const string& sample_name, const
 }
 
 // *******************************************************************************************
-pair<uint64_t, uint32_t> CAGCCompressor::find_cand_segment_with_missing_middle_splitter(CKmer kmer_front, CKmer kmer_back, contig_t& segment_dir, contig_t& segment_rc, ZSTD_DCtx* zstd_dctx, my_barrier& bar)
+pair<uint64_t, uint32_t> CAGCCompressor::find_cand_segment_with_missing_middle_splitter(CKmer kmer_front, CKmer kmer_back, contig_t& segment_dir, contig_t& segment_rc, ZSTD_DCtx* zstd_dctx, my_barrier& bar, CArena& arena)
 {
     auto p_front = map_segments_terminators.find(kmer_front.data());
     auto p_back = map_segments_terminators.find(kmer_back.data());
@@ -1507,7 +1645,7 @@ pair<uint64_t, uint32_t> CAGCCompressor::find_cand_segment_with_missing_middle_s
     if (p_front == map_segments_terminators.end() || p_back == map_segments_terminators.end())
         return make_pair(~0ull, 0);
 
-    vector<uint64_t> shared_splitters;
+    pmr::vector<uint64_t> shared_splitters(&arena);
 
     shared_splitters.resize(min(p_front->second.size(), p_back->second.size()));
 
@@ -1587,10 +1725,12 @@ pair<uint64_t, uint32_t> CAGCCompressor::find_cand_segment_with_missing_middle_s
         
     if(run_seg2_in_separate_thread)
     {
-        future<void> fut = async([&] {seg2_run(nullptr); });
+        CTaskGroup task_group;
+
+        thread_pool->Launch(task_group, [&] {seg2_run(nullptr); });
         seg1_run();
 
-        fut.wait();
+        thread_pool->Wait(task_group);
         bar.decrement();
     }
     else
@@ -1622,14 +1762,15 @@ pair<uint64_t, uint32_t> CAGCCompressor::find_cand_segment_with_missing_middle_s
 }
 
 // *******************************************************************************************
-pair<pair<uint64_t, uint64_t>, bool> CAGCCompressor::find_cand_segment_with_one_splitter(CKmer kmer, contig_t& segment_dir, contig_t& segment_rc, ZSTD_DCtx* zstd_dctx, my_barrier& bar)
+pair<pair<uint64_t, uint64_t>, bool> CAGCCompressor::find_cand_segment_with_one_splitter(CKmer kmer, contig_t& segment_dir, contig_t& segment_rc, ZSTD_DCtx* zstd_dctx, my_barrier& bar, CArena& arena)
 {
     const pair<uint64_t, uint64_t> empty_pk(~0ull, ~0ull);
     pair<uint64_t, uint64_t> best_pk(~0ull, ~0ull);
-    uint64_t best_estim_size = segment_dir.size() < 16 ? segment_dir.size() : segment_dir.size() - 16u;
+    int64_t segment_size = (int64_t)max(segment_dir.size(), segment_rc.size());      // one of the orientations can be not constructed yet
+    uint64_t best_estim_size = segment_size < 16 ? segment_size : segment_size - 16u;
     bool is_best_rc = false;
 
-    vector<tuple<uint64_t, uint64_t, bool, shared_ptr<CSegment>, std::array<uint8_t, 24+64+56>>> v_candidates;        // filled with array to avoid false sharing
+    pmr::vector<tuple<uint64_t, uint64_t, bool, shared_ptr<CSegment>, std::array<uint8_t, 24+64+56>>> v_candidates(&arena);        // filled with array to avoid false sharing
 
     auto p = map_segments_terminators.find(kmer.data());
     if (p == map_segments_terminators.end())
@@ -1672,7 +1813,18 @@ pair<pair<uint64_t, uint64_t>, bool> CAGCCompressor::find_cand_segment_with_one_
         get<3>(ck) = v_segments[map_segments[cand_pk]];
     }
 
-    int64_t segment_size = (int64_t)segment_dir.size();
+    // Construct the missing orientation only if some candidate needs it
+    if (segment_dir.empty() || segment_rc.empty())
+    {
+        bool need_rc = any_of(v_candidates.begin(), v_candidates.end(), [](const auto& x) {return get<2>(x); });
+        bool need_dir = any_of(v_candidates.begin(), v_candidates.end(), [](const auto& x) {return !get<2>(x); });
+
+        if (need_rc && segment_rc.empty())
+            reverse_complement_copy(segment_dir, segment_rc);
+        if (need_dir && segment_dir.empty())
+            reverse_complement_copy(segment_rc, segment_dir);
+    }
+
     stable_sort(v_candidates.begin(), v_candidates.end(), [segment_size](const auto& x, const auto& y) {
         int64_t x_size = get<3>(x)->get_ref_size();
         int64_t y_size = get<3>(y)->get_ref_size();
@@ -1685,7 +1837,7 @@ pair<pair<uint64_t, uint64_t>, bool> CAGCCompressor::find_cand_segment_with_one_
         });
 
     {
-        set<shared_ptr<CSegment>> test_set;
+        pmr::set<shared_ptr<CSegment>> test_set(&arena);
 
         for (auto& cand : v_candidates)
             test_set.emplace(get<3>(cand));
@@ -1718,8 +1870,8 @@ pair<pair<uint64_t, uint64_t>, bool> CAGCCompressor::find_cand_segment_with_one_
     if (v_candidates.size() > 2)
         no_extra_threads = bar.try_increment_max((int32_t)(v_candidates.size() - 1) / 2);
 
-    vector<uint64_t> v_estim_size(v_candidates.size(), best_estim_size);
-    vector<pair<uint64_t, uint64_t>> v_cand_pk(v_candidates.size(), best_pk);
+    pmr::vector<uint64_t> v_estim_size(v_candidates.size(), best_estim_size, &arena);
+    pmr::vector<pair<uint64_t, uint64_t>> v_cand_pk(v_candidates.size(), best_pk, &arena);
 
     if (no_extra_threads == 0)
     {
@@ -1761,14 +1913,8 @@ pair<pair<uint64_t, uint64_t>, bool> CAGCCompressor::find_cand_segment_with_one_
             };
         };
 
-        vector<future<void>> v_fut;
-
-        for (size_t i = 0; i < no_extra_threads; ++i)
-            v_fut.emplace_back(async(job));
-        job();
+        thread_pool->ParallelRun(no_extra_threads + 1, job);
 
-        for (auto& f : v_fut)
-            f.wait();
         bar.decrement(no_extra_threads);
     }
         
@@ -1804,7 +1950,7 @@ pair<pair<uint64_t, uint64_t>, bool> CAGCCompressor::find_cand_segment_with_one_
 
 // #define DEBUG_CANDIDATES
 // *******************************************************************************************
-pair<pair<uint64_t, uint64_t>, bool> CAGCCompressor::find_cand_segment_using_fallback_minimizers(contig_t& segment, uint64_t max_val)
+pair<pair<uint64_t, uint64_t>, bool> CAGCCompressor::find_cand_segment_using_fallback_minimizers(contig_t& segment, uint64_t max_val, CArena& arena)
 {
     const size_t max_num_to_estimate = 10;
     const bool short_segments = segment_size <= 10000;
@@ -1816,7 +1962,7 @@ pair<pair<uint64_t, uint64_t>, bool> CAGCCompressor::find_cand_segment_using_fal
 
     CKmer kmer(kmer_length, kmer_mode_t::canonical);
 
-    map<pair<uint64_t, uint64_t>, vector<uint64_t>> cand_seg_counts;
+    pmr::map<pair<uint64_t, uint64_t>, pmr::vector<uint64_t>> cand_seg_counts(&arena);
 
     kmer.Reset();
 
@@ -1848,7 +1994,7 @@ pair<pair<uint64_t, uint64_t>, bool> CAGCCompressor::find_cand_segment_using_fal
         }
     }
 
-    vector<pair<uint64_t, pair<uint64_t, uint64_t>>> pruned_cand_seg_counts;
+    pmr::vector<pair<uint64_t, pair<uint64_t, uint64_t>>> pruned_cand_seg_counts(&arena);
 
     for (auto& x : cand_seg_counts)
     {
@@ -2085,16 +2231,136 @@ contig_t CAGCCompressor::get_part(const contig_t& contig, uint64_t pos, uint64_t
         return contig_t(contig.begin() + pos, contig.end());
 }
 
+// *******************************************************************************************
+// Memory of the structures that are not limited by the budget
+size_t CAGCCompressor::fixed_memory_usage()
+{
+    return (v_candidate_kmers.capacity() + v_duplicated_kmers.capacity() + hs_splitters.allocated_size()) * sizeof(uint64_t);
+}
+
+// *******************************************************************************************
+// Budget of a single limited structure (input queue, contigs waiting for synchronization, LZ indexes)
+size_t CAGCCompressor::memory_share()
+{
+    if (!max_memory)
+        return ~0ull;
+
+    size_t fixed_size = fixed_memory_usage();
+
+    return max((fixed_size < max_memory) ? (max_memory - fixed_size) / 3 : 0, min_memory_share);
+}
+
+// *******************************************************************************************
+// LZ indexes (rebuilt on demand) of groups not used since the previous release are released first, all of them if it is not enough
+void CAGCCompressor::limit_index_memory()
+{
+    size_t index_memory = 0;
+
+    for (auto& seg : v_segments)
+        if (seg)
+            index_memory += seg->get_index_memory();
+
+    if (index_memory <= index_memory_limit)
+        return;
+
+    for (auto& seg : v_segments)
+        if (seg)
+            index_memory -= seg->release_index(true);
+
+    if (index_memory > index_memory_limit)
+        for (auto& seg : v_segments)
+            if (seg)
+                seg->release_index(false);
+
+    ++no_index_releases;
+}
+
+// *******************************************************************************************
+// Incomplete packs of all groups (workers share the groups)
+void CAGCCompressor::store_checkpoint_segments(ZSTD_CCtx* zstd_cctx)
+{
+    while (true)
+    {
+        uint32_t j = atomic_fetch_add(&id_segment, 1);
+
+        if (j >= no_segments)
+            break;
+
+        if (v_segments[j])
+            v_segments[j]->store_checkpoint(zstd_cctx, vv_pack_layouts[j]);
+    }
+}
+
+// *******************************************************************************************
+string CAGCCompressor::checkpoint_info_name(const string& archive_fn)
+{
+    return archive_fn + ".ckpt";
+}
+
+// *******************************************************************************************
+// Metadata (as at closing) of the processed samples are added to the incomplete packs, so the file is a complete archive.
+// Its size is stored (atomically) in the checkpoint info file
+bool CAGCCompressor::store_checkpoint()
+{
+    store_metadata(1, false);
+
+    if (archive_version >= 3000)
+        dynamic_pointer_cast<CCollection_V3>(collection_desc)->store_checkpoint(processed_samples);
+
+    store_file_type_info();
+
+    size_t file_size = 0;
+    bool r = out_archive->EndCheckpoint(file_size);
+
+    vv_pack_layouts.clear();
+    checkpoint_samples = processed_samples;
+
+    string info_fn = checkpoint_info_name(out_archive_name);
+
+    if (r)
+    {
+        ofstream ofs(info_fn + ".tmp");
+        ofs << file_size << " " << processed_samples << endl;
+        ofs.close();
+        r = !ofs.fail();
+    }
+
+    error_code ec;
+
+    if (r)
+    {
+        filesystem::rename(info_fn + ".tmp", info_fn, ec);
+        r = !ec;
+    }
+
+    if (!r)
+    {
+        cerr << "Cannot store checkpoint of archive " << out_archive_name << endl;
+        return false;
+    }
+
+    if (!resume_archive_name.empty())
+    {
+        filesystem::remove(resume_archive_name, ec);
+        resume_archive_name.clear();
+    }
+
+    if (verbosity > 0 && is_app_mode)
+        cerr << "Checkpoint: " << processed_samples << " samples, " << file_size << " bytes" << endl;
+
+    return true;
+}
+
 // *******************************************************************************************
 bool CAGCCompressor::close_compression(const uint32_t no_threads)
 {
     if (working_mode != working_mode_t::compression && working_mode != working_mode_t::appending)
         return false;
 
-    vector<thread> v_threads;
+    CTaskGroup task_group;
 
-    start_finalizing_threads(v_threads, no_threads);
-    join_threads(v_threads);
+    start_finalizing_threads(task_group, no_threads);
+    thread_pool->Wait(task_group);
 
     out_archive->FlushOutBuffers();
 
@@ -2109,68 +2375,893 @@ bool CAGCCompressor::close_compression(const uint32_t no_threads)
 }
 
 // *******************************************************************************************
-// Add sample files
-bool CAGCCompressor::AddSampleFiles(vector<pair<string, string>> _v_sample_file_name, const uint32_t no_threads)
+bool CAGCCompressor::merge_check_compatibility(CAGCDecompressorLibrary& src, const string& src_name)
 {
-    if (_v_sample_file_name.empty())
-        return true;
+    if (src.archive_version < 3000 || src.archive_version >= 4000 || archive_version < 3000)
+    {
+        cerr << "Only archives in format 3.x can be merged: " << src_name << endl;
+        return false;
+    }
 
-    processed_bases = 0;
+    if (src.kmer_length != kmer_length || src.min_match_len != min_match_len || src.pack_cardinality != pack_cardinality)
+    {
+        cerr << "Different compression parameters (k-mer length, min. match length or batch size) of archive " << src_name << endl;
+        return false;
+    }
 
-    size_t queue_capacity = max(2ull << 30, no_threads * (192ull << 20));
+    if (src.seekable_packs != seekable_packs)
+    {
+        cerr << "Different pack format (seekable packs) of archive " << src_name << endl;
+        return false;
+    }
 
-    pq_contigs_desc = make_shared<CBoundedPQueue<task_t>>(1, queue_capacity);
-    pq_contigs_desc_aux = make_shared<CBoundedPQueue<task_t>>(1, ~0ull);
-    pq_contigs_desc_working = pq_contigs_desc;
+    if ((collection_desc->has_contig_stats() && !src.collection_desc->has_contig_stats()) ||
+        (collection_desc->has_contig_digests() && !src.collection_desc->has_contig_digests()))
+    {
+        cerr << "Archive " << src_name << " has no contig stats or digests (created by an older release), so its samples cannot be added to archive with them" << endl;
+        return false;
+    }
 
-    uint32_t no_workers = (no_threads < 8) ? no_threads : no_threads - 1;
+    // Non-uniform pack layouts can be stored only in the extended format
+    if (src.has_pack_ext() && !has_pack_ext())
+    {
+        archive_version = AGC_FILE_MAJOR * 1000 + AGC_FILE_MINOR_PACK_EXT;
+        m_file_type_info["file_version_minor"] = to_string(AGC_FILE_MINOR_PACK_EXT);
+    }
 
-    vector<thread> v_threads;
-    v_threads.reserve((size_t)no_workers);
+    return true;
+}
 
-    my_barrier bar(no_workers);
+// *******************************************************************************************
+// Splitters of source archive are added to the current ones and the splitter pairs of its groups are returned
+bool CAGCCompressor::merge_load_group_keys(CAGCDecompressorLibrary& src, unordered_map<uint32_t, pair<uint64_t, uint64_t>>& m_group_keys)
+{
+    vector<uint8_t> v_tmp;
+    uint64_t no_items;
+    uint64_t x1, x2;
+    uint32_t x3;
 
-    start_compressing_threads(v_threads, bar, no_workers);
+    if (!src.in_archive->GetPart(src.in_archive->GetStreamId("splitters"), 0, v_tmp, no_items) || v_tmp.size() != no_items * 8)
+        return false;
 
-    // Reading Input
-    pair<string, string> sf;
-    CGenomeIO gio;
-    string id;
-    contig_t contig;
-    size_t sample_priority = ~0ull;
-    size_t cnt_contigs_in_sample = 0;
-    const size_t max_no_contigs_before_synchronization = pack_cardinality;
-    const size_t min_size_before_synchronization = 1ull << 30;
+    auto p = v_tmp.begin();
 
-    if (archive_version >= 3000 && in_archive != nullptr)
-        processed_samples = (uint32_t) dynamic_pointer_cast<CCollection_V3>(collection_desc)->get_no_samples();
-    else
-        processed_samples = 0;
+    for (uint64_t i = 0; i < no_items; ++i)
+    {
+        read64(p, x1);
 
-    if (concatenated_genomes)
-        cnt_contigs_in_sample = processed_samples % pack_cardinality;
+        if (hs_splitters.insert(x1).second)
+            bloom_splitters.insert(x1);
+    }
 
-    size_t num_empty_input = 0; 
-    
-    for(auto sf : _v_sample_file_name)
+    if (bloom_splitters.filling_factor() > 0.3)
     {
-        if (archive_version >= 3000)
-            dynamic_pointer_cast<CCollection_V3>(collection_desc)->reset_prev_sample_name();
+        bloom_splitters.resize((uint64_t)(hs_splitters.size() / 0.25));
+        bloom_splitters.insert(hs_splitters.begin(), hs_splitters.end());
+    }
 
-        if (!gio.Open(sf.second, false))
-        {
-            cerr << "Cannot open file: " << sf.second << endl;
-            continue;
-        }
-        else
-        {
-            ;
-        }
+    if (!src.in_archive->GetPart(src.in_archive->GetStreamId("segment-splitters"), 0, v_tmp, no_items) || v_tmp.size() != no_items * 20)
+        return false;
 
-        bool any_contigs_read = false;
-        bool any_contigs_added = false;
-        
-        while (gio.ReadContigRaw(id, contig))
+    p = v_tmp.begin();
+    m_group_keys.clear();
+
+    for (uint64_t i = 0; i < no_items; ++i)
+    {
+        read64(p, x1);
+        read64(p, x2);
+        read(p, x3);
+
+        m_group_keys[x3] = make_pair(x1, x2);
+    }
+
+    return true;
+}
+
+// *******************************************************************************************
+bool CAGCCompressor::merge_get_group_reference(const uint32_t group_id, contig_t& ref, ZSTD_DCtx* zstd_dctx)
+{
+    shared_ptr<CArchive> archive = in_archive;
+    uint32_t src_group_id = group_id;
+
+    auto p = m_merged_group_origins.find(group_id);
+    if (p != m_merged_group_origins.end())
+    {
+        archive = p->second.archive;
+        src_group_id = p->second.group_id;
+    }
+
+    if (archive->GetStreamId(ss_ref_name(archive_version, src_group_id)) < 0)
+        return false;
+
+    CSegment segment(ss_base(archive_version, src_group_id), archive, nullptr, pack_cardinality, min_match_len, false, archive_version, seekable_packs);
+
+    return segment.get(0, ref, zstd_dctx);
+}
+
+// *******************************************************************************************
+// Referenced members of the source group are added to the group of the output archive (v_remap: in-group ids, ~0u - not referenced).
+// Members are LZ-encoded again only if the references of the groups differ. New groups receive the (packed) reference of the source group
+bool CAGCCompressor::merge_group(CAGCDecompressorLibrary& src, const uint32_t src_group_id, const uint32_t group_id, const bool new_group, vector<uint32_t>& v_remap,
+    ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx, uint64_t& no_reused, uint64_t& no_reencoded)
+{
+    CSegment src_segment(ss_base(src.archive_version, src_group_id), src.in_archive, nullptr, pack_cardinality, min_match_len, false, src.archive_version, src.seekable_packs, true);
+
+    auto p_layout = src.m_pack_layouts.find(src_group_id);
+    if (p_layout != src.m_pack_layouts.end())
+        src_segment.set_pack_layout(p_layout->second);
+
+    auto& segment = v_segments[group_id];
+    contig_t ctg;
+
+    if (group_id < no_raw_groups)
+    {
+        for (uint32_t i = 0; i < v_remap.size(); ++i)
+        {
+            if (v_remap[i] == ~0u)
+                continue;
+
+            if (!src_segment.get_raw(i, ctg, zstd_dctx))
+                return false;
+
+            v_remap[i] = segment->add_raw(ctg, zstd_cctx, zstd_dctx);
+            ++no_reencoded;
+        }
+
+        return true;
+    }
+
+    contig_t src_ref, ref;
+
+    if (!src_segment.get(0, src_ref, zstd_dctx))
+        return false;
+
+    if (new_group && reselect_references)
+    {
+        vector<contig_t> v_members;
+
+        if (!src_segment.get_encoded_members(v_members, zstd_dctx))
+            return false;
+
+        if (merge_group_reselect(src_ref, v_members, v_remap, segment, zstd_cctx, zstd_dctx, no_reencoded))
+            return true;
+    }
+
+    if (new_group)
+    {
+        vector<uint8_t> packed_ref;
+        uint64_t raw_size;
+
+        if (!src.in_archive->GetPart(src.in_archive->GetStreamId(ss_ref_name(src.archive_version, src_group_id)), 0, packed_ref, raw_size))
+            return false;
+
+        segment->add_packed_ref(packed_ref, raw_size, src_ref);
+    }
+
+    if (new_group || (merge_get_group_reference(group_id, ref, zstd_dctx) && ref == src_ref))
+    {
+        vector<contig_t> v_members;
+
+        if (!src_segment.get_encoded_members(v_members, zstd_dctx))
+            return false;
+
+        if (!v_remap.empty())
+            v_remap[0] = 0;
+
+        for (uint32_t i = 1; i < v_remap.size(); ++i)
+        {
+            if (v_remap[i] == ~0u)
+                continue;
+
+            if (i > v_members.size())
+                return false;
+
+            v_remap[i] = segment->add_encoded(v_members[i - 1], zstd_cctx, zstd_dctx);
+            ++no_reused;
+        }
+
+        return true;
+    }
+
+    for (uint32_t i = 0; i < v_remap.size(); ++i)
+    {
+        if (v_remap[i] == ~0u)
+            continue;
+
+        if (i == 0)
+            ctg = src_ref;
+        else if (!src_segment.get(i, ctg, zstd_dctx))
+            return false;
+
+        v_remap[i] = segment->add(ctg, zstd_cctx, zstd_dctx);
+        ++no_reencoded;
+    }
+
+    return true;
+}
+
+// *******************************************************************************************
+// Members (and the reference) of the source group are decoded and the best reference candidate is selected by estimated LZ costs 
+// of (a sample of) referenced members. Return false if the current reference should be kept (nothing is added to the segment then)
+bool CAGCCompressor::merge_group_reselect(const contig_t& src_ref, const vector<contig_t>& v_members, vector<uint32_t>& v_remap, shared_ptr<CSegment> segment,
+    ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx, uint64_t& no_reencoded)
+{
+    vector<uint32_t> v_ids;
+
+    for (uint32_t i = 0; i < v_remap.size(); ++i)
+        if (v_remap[i] != ~0u && (i == 0 || i <= v_members.size()))
+            v_ids.emplace_back(i);
+
+    if (v_ids.size() < 3)
+        return false;
+
+    vector<contig_t> v_raw(v_remap.size());
+    uint64_t old_delta_size = 0;
+    CLZDiff_V2 lz_old(min_match_len);
+
+    auto t1 = high_resolution_clock::now();
+
+    for (auto i : v_ids)
+        if (i == 0)
+            v_raw[0] = src_ref;
+        else
+        {
+            lz_old.Decode(src_ref, v_members[i - 1], v_raw[i]);
+            old_delta_size += v_members[i - 1].size();
+        }
+
+    auto old_decode_ns = (uint64_t) duration_cast<nanoseconds>(high_resolution_clock::now() - t1).count();
+
+    auto pick = [&v_ids](const uint32_t max_no) {
+        vector<uint32_t> v_picked;
+        size_t step = max<size_t>(1, v_ids.size() / max_no);
+
+        for (size_t i = 0; i < v_ids.size() && v_picked.size() < max_no; i += step)
+            v_picked.emplace_back(v_ids[i]);
+
+        return v_picked;
+    };
+
+    auto v_evaluated = pick(reselect_max_evaluated);
+    auto v_candidates = pick(reselect_max_candidates);
+
+    auto total_cost = [&](const contig_t& ref, const uint32_t ref_id) {
+        CLZDiff_V2 lz(min_match_len);
+        lz.Prepare(ref);
+
+        uint64_t cost = 0;
+
+        for (auto i : v_evaluated)
+            if (i != ref_id)
+                cost += lz.Estimate(v_raw[i]);
+
+        return cost;
+    };
+
+    uint64_t cur_cost = total_cost(src_ref, 0);
+    uint64_t best_cost = cur_cost;
+    uint32_t best_id = 0;
+
+    for (auto i : v_candidates)
+    {
+        if (i == 0)
+            continue;
+
+        auto cost = total_cost(v_raw[i], i);
+
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            best_id = i;
+        }
+    }
+
+    if (best_id == 0 || best_cost >= cur_cost * (1.0 - reselect_min_gain))
+        return false;
+
+    // Members are encoded against the new reference (and checked by decoding)
+    CLZDiff_V2 lz_new(min_match_len);
+    lz_new.Prepare(v_raw[best_id]);
+
+    vector<contig_t> v_deltas(v_remap.size());
+    uint64_t new_delta_size = 0;
+
+    for (auto i : v_ids)
+        if (i != best_id)
+        {
+            lz_new.Encode(v_raw[i], v_deltas[i]);
+            new_delta_size += v_deltas[i].size();
+        }
+
+    contig_t ctg;
+    bool ok = true;
+
+    t1 = high_resolution_clock::now();
+
+    for (auto i : v_ids)
+        if (i != best_id && !v_deltas[i].empty())
+        {
+            lz_new.Decode(v_raw[best_id], v_deltas[i], ctg);
+            ok &= ctg == v_raw[i];
+        }
+
+    auto new_decode_ns = (uint64_t) duration_cast<nanoseconds>(high_resolution_clock::now() - t1).count();
+
+    if (!ok)
+        return false;
+
+    segment->add(v_raw[best_id], zstd_cctx, zstd_dctx);
+
+    for (auto i : v_ids)
+    {
+        if (v_deltas[i].empty())            // new reference or the same sequence
+            v_remap[i] = 0;
+        else
+            v_remap[i] = segment->add_encoded(v_deltas[i], zstd_cctx, zstd_dctx);
+
+        ++no_reencoded;
+    }
+
+    ++no_reselected_groups;
+    reselect_old_delta_size += old_delta_size;
+    reselect_new_delta_size += new_delta_size;
+    reselect_old_decode_ns += old_decode_ns;
+    reselect_new_decode_ns += new_decode_ns;
+
+    return true;
+}
+
+// *******************************************************************************************
+// Samples of the source archive (only v_sample_names if non-empty) are added to the output archive
+bool CAGCCompressor::merge_archive(CAGCDecompressorLibrary& src, const string& src_name, const vector<string>& v_sample_names, const uint32_t no_threads)
+{
+    if (!merge_check_compatibility(src, src_name))
+        return false;
+
+    unordered_map<uint32_t, pair<uint64_t, uint64_t>> m_group_keys;
+
+    if (!merge_load_group_keys(src, m_group_keys))
+    {
+        cerr << "Corrupted splitters in archive " << src_name << endl;
+        return false;
+    }
+
+    auto coll_v3 = dynamic_pointer_cast<CCollection_V3>(collection_desc);
+
+    vector<string> v_src_samples, v_dst_samples, v_samples;
+    collection_desc->get_samples_list(v_dst_samples, false);
+
+    if (v_sample_names.empty())
+        src.collection_desc->get_samples_list(v_src_samples, false);
+    else
+    {
+        vector<string> v_all_samples;
+        src.collection_desc->get_samples_list(v_all_samples, false);
+
+        unordered_set<string> s_all_samples(v_all_samples.begin(), v_all_samples.end());
+        unordered_set<string> s_selected;
+
+        for (auto& sample_name : v_sample_names)
+            if (!s_all_samples.count(sample_name))
+            {
+                cerr << "There is no sample " << sample_name << " in archive " << src_name << endl;
+                return false;
+            }
+            else
+                s_selected.insert(sample_name);
+
+        // Order of samples in the source archive is kept
+        for (auto& sample_name : v_all_samples)
+            if (s_selected.count(sample_name))
+                v_src_samples.emplace_back(sample_name);
+    }
+
+    unordered_set<string> s_dst_samples(v_dst_samples.begin(), v_dst_samples.end());
+    vector<pair<string, vector<segment_desc_t>>> src_sample_desc, dst_sample_desc;
+
+    // Samples present in both archives (e.g., reference sample of archives extended by append) are taken once
+    for (auto& sample_name : v_src_samples)
+    {
+        if (!s_dst_samples.count(sample_name))
+        {
+            v_samples.emplace_back(sample_name);
+            continue;
+        }
+
+        // Full descriptions are loaded, as loading of contig names only would leave the batch without segment details
+        src.collection_desc->get_sample_desc(sample_name, src_sample_desc);
+        collection_desc->get_sample_desc(sample_name, dst_sample_desc);
+
+        if (src_sample_desc.size() != dst_sample_desc.size() ||
+            !equal(src_sample_desc.begin(), src_sample_desc.end(), dst_sample_desc.begin(), [](const auto& x, const auto& y) { return x.first == y.first; }))
+        {
+            cerr << "Sample " << sample_name << " from archive " << src_name << " differs from the sample of the same name already in the archive" << endl;
+            return false;
+        }
+
+        if (verbosity > 1 && is_app_mode)
+            cerr << "Sample " << sample_name << " from archive " << src_name << " is already in the archive (skipped)" << endl;
+    }
+
+    // Members referenced by the samples
+    vector<pair<string, vector<segment_desc_t>>> sample_desc;
+    vector<vector<uint32_t>> vv_remap;
+
+    for (auto& sample_name : v_samples)
+    {
+        if (!src.collection_desc->get_sample_desc(sample_name, sample_desc))
+        {
+            cerr << "Cannot load description of sample " << sample_name << " from archive " << src_name << endl;
+            return false;
+        }
+
+        for (auto& contig : sample_desc)
+            for (auto& seg : contig.second)
+            {
+                if (seg.group_id >= vv_remap.size())
+                    vv_remap.resize(seg.group_id + 1);
+                if (seg.in_group_id >= vv_remap[seg.group_id].size())
+                    vv_remap[seg.group_id].resize(seg.in_group_id + 1, ~0u);
+
+                vv_remap[seg.group_id][seg.in_group_id] = 0;
+            }
+    }
+
+    // Groups of the same splitters are unified, other groups are copied (with the same in-group ids)
+    vector<uint32_t> v_target(vv_remap.size(), ~0u);
+    vector<uint32_t> v_merged_groups;
+    vector<bool> v_new_group(vv_remap.size(), false);
+    uint64_t no_new_groups = 0;
+
+    for (uint32_t i = 0; i < (uint32_t) vv_remap.size(); ++i)
+    {
+        if (vv_remap[i].empty())
+            continue;
+
+        if (src.in_archive->GetStreamId(ss_delta_name(src.archive_version, i)) < 0 && src.in_archive->GetStreamId(ss_ref_name(src.archive_version, i)) < 0)
+        {
+            cerr << "Missing group " << i << " in archive " << src_name << endl;
+            return false;
+        }
+
+        v_merged_groups.emplace_back(i);
+
+        if (i < no_raw_groups)
+        {
+            v_target[i] = i;
+            continue;
+        }
+
+        auto p_key = m_group_keys.find(i);
+        auto p_group = (p_key == m_group_keys.end()) ? map_segments.end() : map_segments.find(p_key->second);
+
+        if (p_group != map_segments.end() && v_segments[p_group->second] != nullptr)
+        {
+            v_target[i] = (uint32_t) p_group->second;
+            continue;
+        }
+
+        uint32_t group_id = no_segments++;
+
+        if (no_segments > v_segments.size())
+            v_segments.resize(no_segments);
+
+        v_segments[group_id] = make_segment(group_id, nullptr);
+
+        m_merged_group_origins[group_id] = merged_group_origin_t{ src.in_archive, i };
+        v_target[i] = group_id;
+        v_new_group[i] = true;
+        ++no_new_groups;
+
+        if (p_key != m_group_keys.end())
+        {
+            auto kmer1 = p_key->second.first;
+            auto kmer2 = p_key->second.second;
+
+            map_segments[p_key->second] = group_id;
+
+            if (kmer1 != ~0ull && kmer2 != ~0ull)
+            {
+                map_segments_terminators[kmer1].push_back(kmer2);
+                sort(map_segments_terminators[kmer1].begin(), map_segments_terminators[kmer1].end());
+
+                if (kmer1 != kmer2)
+                {
+                    map_segments_terminators[kmer2].push_back(kmer1);
+                    sort(map_segments_terminators[kmer2].begin(), map_segments_terminators[kmer2].end());
+                }
+            }
+        }
+    }
+
+    buffered_seg_part.resize(no_segments);
+
+    // Groups are processed in parallel (each output group receives members of a single source group)
+    atomic<size_t> next_group{ 0 };
+    atomic<uint64_t> no_reused{ 0 };
+    atomic<uint64_t> no_reencoded{ 0 };
+    atomic<bool> ok{ true };
+    CTaskGroup task_group;
+
+    thread_pool->Reserve(no_threads);
+
+    for (uint32_t t = 0; t < no_threads; ++t)
+        thread_pool->Launch(task_group, [&] {
+            auto zstd_cctx = ZSTD_createCCtx();
+            auto zstd_dctx = ZSTD_createDCtx();
+            uint64_t loc_reused = 0;
+            uint64_t loc_reencoded = 0;
+
+            for (size_t j = next_group++; j < v_merged_groups.size(); j = next_group++)
+            {
+                auto src_group_id = v_merged_groups[j];
+
+                if (!merge_group(src, src_group_id, v_target[src_group_id], v_new_group[src_group_id], vv_remap[src_group_id], zstd_cctx, zstd_dctx, loc_reused, loc_reencoded))
+                    ok = false;
+
+                // Packs completed so far are written, so the memory usage does not depend on the archive size
+                if (j % 256 == 255)
+                    out_archive->FlushOutBuffers();
+            }
+
+            no_reused += loc_reused;
+            no_reencoded += loc_reencoded;
+
+            ZSTD_freeCCtx(zstd_cctx);
+            ZSTD_freeDCtx(zstd_dctx);
+            });
+
+    thread_pool->Wait(task_group);
+
+    if (!ok)
+    {
+        cerr << "Cannot decode segments of archive " << src_name << endl;
+        return false;
+    }
+
+    // Samples with remapped segments
+    vector<segments_to_place_t> v_segments_to_place;
+    vector<pair<string, contig_stats_t>> v_contig_stats;
+    vector<pair<string, contig_digest_t>> v_contig_digests;
+
+    for (auto& sample_name : v_samples)
+    {
+        src.collection_desc->get_sample_desc(sample_name, sample_desc);
+
+        bool has_stats = src.collection_desc->get_sample_stats(sample_name, v_contig_stats) && v_contig_stats.size() == sample_desc.size();
+        bool has_digests = src.collection_desc->get_sample_digests(sample_name, v_contig_digests) && v_contig_digests.size() == sample_desc.size();
+
+        coll_v3->reset_prev_sample_name();
+        v_segments_to_place.clear();
+
+        for (size_t i = 0; i < sample_desc.size(); ++i)
+        {
+            auto& contig_name = sample_desc[i].first;
+
+            if (!collection_desc->register_sample_contig(sample_name, contig_name))
+            {
+                cerr << "Error: Pair sample_name:contig_name " << sample_name << ":" << contig_name << " is already in the archive!\n";
+                continue;
+            }
+
+            auto& segments = sample_desc[i].second;
+
+            for (uint32_t j = 0; j < (uint32_t) segments.size(); ++j)
+            {
+                auto& seg = segments[j];
+
+                v_segments_to_place.emplace_back(sample_name, contig_name, j, v_target[seg.group_id], vv_remap[seg.group_id][seg.in_group_id], seg.is_rev_comp, seg.raw_length);
+            }
+
+            if (has_stats)
+                collection_desc->set_contig_stats(sample_name, contig_name, v_contig_stats[i].second);
+            if (has_digests)
+                collection_desc->set_contig_digest(sample_name, contig_name, v_contig_digests[i].second);
+        }
+
+        collection_desc->add_segments_placed(v_segments_to_place);
+
+        if (++processed_samples % pack_cardinality == 0)
+            coll_v3->store_contig_batch(processed_samples - pack_cardinality, processed_samples);
+    }
+
+    out_archive->FlushOutBuffers();
+
+    no_samples_in_archive += v_samples.size();
+
+    if (verbosity > 0 && is_app_mode)
+        cerr << "Added " << v_samples.size() << " samples of " << src_name << ": " << no_new_groups << " groups created, " << v_merged_groups.size() - no_new_groups << " groups unified ("
+            << no_reused << " segments reused, " << no_reencoded << " segments reencoded)" << endl;
+
+    return true;
+}
+
+// *******************************************************************************************
+bool CAGCCompressor::MergeArchives(const vector<string>& v_archive_names, const uint32_t _no_threads)
+{
+    const uint32_t no_threads = thread_pool->LimitThreads(_no_threads);
+
+    if (working_mode != working_mode_t::appending || archive_version < 3000)
+        return false;
+
+    processed_samples = (uint32_t) collection_desc->get_no_samples();
+
+    bool r = true;
+
+    for (auto& archive_name : v_archive_names)
+    {
+        CAGCDecompressorLibrary src(false);
+
+        if (!src.Open(archive_name, false))
+        {
+            cerr << "Cannot open archive " << archive_name << endl;
+            r = false;
+            break;
+        }
+
+        if (!merge_archive(src, archive_name, {}, no_threads))
+        {
+            r = false;
+            break;
+        }
+    }
+
+    merge_finish();
+
+    return r;
+}
+
+// *******************************************************************************************
+void CAGCCompressor::merge_finish()
+{
+    if (processed_samples % pack_cardinality != 0)
+        dynamic_pointer_cast<CCollection_V3>(collection_desc)->store_contig_batch((processed_samples / pack_cardinality) * pack_cardinality, processed_samples);
+
+    out_archive->FlushOutBuffers();
+}
+
+// *******************************************************************************************
+bool CAGCCompressor::RemoveSamples(const string& archive_fn, const vector<string>& v_sample_names, const uint32_t _verbosity)
+{
+    if (working_mode != working_mode_t::none)
+        return false;
+
+    verbosity = _verbosity;
+
+    vector<uint8_t> v_data;
+    size_t no_removed;
+
+    {
+        CAGCDecompressorLibrary src(false);
+
+        if (!src.Open(archive_fn, false))
+        {
+            cerr << "Cannot open archive " << archive_fn << endl;
+            return false;
+        }
+
+        if (src.archive_version < 3000 || src.archive_version >= 4000)
+        {
+            cerr << "Samples can be removed only from archives in format 3.x" << endl;
+            return false;
+        }
+
+        for (auto& sample_name : v_sample_names)
+            if (!src.collection_desc->remove_sample(sample_name))
+            {
+                cerr << "There is no sample " << sample_name << " in archive " << archive_fn << endl;
+                return false;
+            }
+
+        dynamic_pointer_cast<CCollection_V3>(src.collection_desc)->serialize_removed_samples(v_data);
+        no_removed = src.collection_desc->get_no_removed_samples();
+    }
+
+    CArchive archive(false);
+
+    if (!archive.OpenForUpdate(archive_fn))
+    {
+        cerr << "Cannot open archive " << archive_fn << " for update" << endl;
+        return false;
+    }
+
+    archive.AddPart(archive.RegisterStream("collection-removed"), v_data, 0);
+
+    if (!archive.Close())
+        return false;
+
+    if (verbosity > 0 && is_app_mode)
+        cerr << "Removed samples: " << v_sample_names.size() << " (in total: " << no_removed << ")" << endl;
+
+    return true;
+}
+
+// *******************************************************************************************
+bool CAGCCompressor::Optimize(const string& _in_archive_fn, const string& _out_archive_fn, const uint32_t _verbosity, const uint32_t _no_threads)
+{
+    reselect_references = true;
+
+    if (!Subset(_in_archive_fn, _out_archive_fn, {}, _verbosity, _no_threads))
+        return false;
+
+    if (is_app_mode)
+    {
+        cerr << "Groups with new reference  : " << no_reselected_groups << " of " << no_segments - no_raw_groups << endl;
+        cerr << "Delta size in these groups : " << reselect_old_delta_size << " -> " << reselect_new_delta_size << " bytes (before ZSTD)" << endl;
+        cerr << "LZ decoding time of members: " << fixed << setprecision(3) << reselect_old_decode_ns / 1e6 << " -> " << reselect_new_decode_ns / 1e6 << " ms" << endl;
+    }
+
+    return true;
+}
+
+// *******************************************************************************************
+bool CAGCCompressor::Subset(const string& _in_archive_fn, const string& _out_archive_fn, const vector<string>& v_sample_names, const uint32_t _verbosity, const uint32_t _no_threads)
+{
+    const uint32_t no_threads = thread_pool->LimitThreads(_no_threads);
+
+    if (working_mode != working_mode_t::none)
+        return false;
+
+    verbosity = _verbosity;
+
+    CAGCDecompressorLibrary src(false);
+
+    if (!src.Open(_in_archive_fn, false))
+    {
+        cerr << "Cannot open archive " << _in_archive_fn << endl;
+        return false;
+    }
+
+    // Compression parameters of the input archive are kept
+    pack_cardinality = src.pack_cardinality;
+    kmer_length = src.kmer_length;
+    min_match_len = src.min_match_len;
+    segment_size = src.segment_size;
+    seekable_packs = src.seekable_packs;
+
+    out_archive = make_shared<CArchive>(false, 32 << 20);
+    if (!out_archive->Open(_out_archive_fn))
+        return false;
+
+    out_archive->SetPartChecksums(part_checksums || src.in_archive->HasPartChecksums());
+
+    working_mode = working_mode_t::compression;
+
+    if (seekable_packs)
+    {
+        archive_version = AGC_FILE_MAJOR * 1000 + AGC_FILE_MINOR_PACK_EXT;
+        m_file_type_info["file_version_minor"] = to_string(AGC_FILE_MINOR_PACK_EXT);
+    }
+
+    auto coll_v3 = dynamic_pointer_cast<CCollection_V3>(collection_desc);
+
+    coll_v3->set_thread_pool(thread_pool);
+    coll_v3->set_archives(nullptr, out_archive, no_threads, pack_cardinality, segment_size, kmer_length);
+
+    no_samples_in_archive = 0;
+    processed_samples = 0;
+
+    create_raw_groups();
+
+    bool r = merge_archive(src, _in_archive_fn, v_sample_names, no_threads);
+
+    merge_finish();
+
+    return r;
+}
+
+// *******************************************************************************************
+// Add sample files
+bool CAGCCompressor::AddSampleFiles(vector<pair<string, string>> _v_sample_file_name, const uint32_t _no_threads)
+{
+    const uint32_t no_threads = thread_pool->LimitThreads(_no_threads);
+
+    if (_v_sample_file_name.empty())
+        return true;
+
+    processed_bases = 0;
+
+    size_t queue_capacity = max(2ull << 30, no_threads * (192ull << 20));
+
+    if (max_memory)
+    {
+        size_t fixed_size = fixed_memory_usage();
+        size_t share = memory_share();
+
+        if (fixed_size >= max_memory && is_app_mode)
+            cerr << "Warning: memory budget is too small, candidate k-mers and splitters need " << (fixed_size >> 20) << " MB\n";
+
+        // Segments waiting for registration above their share are spilled to disk; hard contigs (adaptive mode) are limited by the synchronization
+        queue_capacity = min(queue_capacity, share);
+        sync_memory_limit = share / 2;
+        index_memory_limit = share;
+
+        buffered_seg_part.set_spill_threshold(sync_memory_limit);
+
+        if (verbosity > 0 && is_app_mode)
+            cerr << "Memory budget: " << (max_memory >> 20) << " MB (fixed: " << (fixed_size >> 20) << " MB, input queue: " << (queue_capacity >> 20)
+                << " MB, LZ indexes: " << (index_memory_limit >> 20) << " MB)\n";
+    }
+
+    pq_contigs_desc = make_shared<CBoundedPQueue<task_t>>(1, queue_capacity);
+    pq_contigs_desc_aux = make_shared<CBoundedPQueue<task_t>>(1, ~0ull);
+    pq_contigs_desc_working = pq_contigs_desc;
+
+    uint32_t no_workers = (no_threads < 8) ? no_threads : no_threads - 1;
+
+    CTaskGroup task_group;
+
+    my_barrier bar(no_workers);
+
+    start_compressing_threads(task_group, bar, no_workers);
+
+    // Reading Input
+    pair<string, string> sf;
+    CGenomeIO gio;
+    string id;
+    contig_t contig;
+    size_t sample_priority = ~0ull;
+    size_t cnt_contigs_in_sample = 0;
+    size_t size_since_synchronization = 0;
+
+    // Synchronization forced by the memory budget (it does not complete a sample)
+    auto send_partial_sync = [&] {
+        pq_contigs_desc->EmplaceManyNoCost(make_tuple(
+            adaptive_compression ? contig_processing_stage_t::new_splitters : contig_processing_stage_t::registration, partial_sync_name, "", contig_t()), sample_priority, no_workers);
+
+        size_since_synchronization = 0;
+        ++no_partial_syncs;
+        --sample_priority;
+    };
+
+    // Synchronization at the end of a sample (not used in the concatenated genomes mode)
+    size_t no_added_samples = 0;
+
+    auto send_sample_sync = [&] {
+        pq_contigs_desc->EmplaceManyNoCost(make_tuple(
+            adaptive_compression ? contig_processing_stage_t::new_splitters : contig_processing_stage_t::registration,
+            "", "", contig_t()), sample_priority, no_workers);
+
+        size_since_synchronization = 0;
+        ++no_added_samples;
+        --sample_priority;
+    };
+    const size_t max_no_contigs_before_synchronization = pack_cardinality;
+    const size_t min_size_before_synchronization = 1ull << 30;
+
+    if (archive_version >= 3000 && in_archive != nullptr)
+        processed_samples = (uint32_t) dynamic_pointer_cast<CCollection_V3>(collection_desc)->get_no_samples();
+    else
+        processed_samples = 0;
+
+    checkpoint_samples = processed_samples;
+
+    if (concatenated_genomes)
+        cnt_contigs_in_sample = processed_samples % pack_cardinality;
+
+    size_t num_empty_input = 0; 
+    
+    for(auto sf : _v_sample_file_name)
+    {
+        if (archive_version >= 3000)
+            dynamic_pointer_cast<CCollection_V3>(collection_desc)->reset_prev_sample_name();
+
+        if (!gio.Open(sf.second, false))
+        {
+            cerr << "Cannot open file: " << sf.second << endl;
+            continue;
+        }
+        else
+        {
+            ;
+        }
+
+        bool any_contigs_read = false;
+        bool any_contigs_added = false;
+        bool sample_contigs_added = false;
+        string cur_sample_name = sf.first;
+        
+        while (gio.ReadContigRaw(id, contig))
         {
             if (concatenated_genomes)
             {
@@ -2181,6 +3272,7 @@ bool CAGCCompressor::AddSampleFiles(vector<pair<string, string>> _v_sample_file_
                     auto cost = contig.size();
                     pq_contigs_desc->Emplace(make_tuple(contig_processing_stage_t::all_contigs, "", id, move(contig)), sample_priority, cost);
                     contig.clear();
+                    size_since_synchronization += cost;
 
                     if (++cnt_contigs_in_sample >= max_no_contigs_before_synchronization)
                     {
@@ -2189,23 +3281,51 @@ bool CAGCCompressor::AddSampleFiles(vector<pair<string, string>> _v_sample_file_
                             adaptive_compression ? contig_processing_stage_t::new_splitters : contig_processing_stage_t::registration, "", "", contig_t()), sample_priority, no_workers);
 
                         cnt_contigs_in_sample = 0;
+                        size_since_synchronization = 0;
                         --sample_priority;
                     }
+                    else if (adaptive_compression && size_since_synchronization >= sync_memory_limit)
+                        send_partial_sync();
 
                     any_contigs_added = true;
                 }
             }
             else
             {
-                if (collection_desc->register_sample_contig(sf.first, id))
+                if (pansn)
+                {
+                    string sample_name = pansn_sample_name(id, sf.first);
+
+                    if (sample_name != cur_sample_name)
+                    {
+                        if (sample_contigs_added)
+                            send_sample_sync();
+
+                        sample_contigs_added = false;
+                        cur_sample_name = sample_name;
+                    }
+
+                    if (s_skipped_samples.count(cur_sample_name))
+                    {
+                        any_contigs_read = true;
+                        continue;
+                    }
+                }
+
+                if (collection_desc->register_sample_contig(cur_sample_name, id))
                 {
                     auto cost = contig.size();
-                    pq_contigs_desc->Emplace(make_tuple(contig_processing_stage_t::all_contigs, sf.first, id, move(contig)), sample_priority, cost);
+                    pq_contigs_desc->Emplace(make_tuple(contig_processing_stage_t::all_contigs, cur_sample_name, id, move(contig)), sample_priority, cost);
                     contig.clear();
                     any_contigs_added = true;
+                    sample_contigs_added = true;
+
+                    size_since_synchronization += cost;
+                    if (adaptive_compression && size_since_synchronization >= sync_memory_limit)
+                        send_partial_sync();
                 }
                 else
-                    cerr << "Error: Pair sample_name:contig_name " << sf.first << ":" << id << " is already in the archive!\n";
+                    cerr << "Error: Pair sample_name:contig_name " << cur_sample_name << ":" << id << " is already in the archive!\n";
             }
 
             any_contigs_read = true;
@@ -2220,15 +3340,8 @@ bool CAGCCompressor::AddSampleFiles(vector<pair<string, string>> _v_sample_file_
             ++num_empty_input;
         }
 
-        if (!concatenated_genomes && any_contigs_added)
-        {
-            // Send synchronization tokens
-            pq_contigs_desc->EmplaceManyNoCost(make_tuple(
-                adaptive_compression ? contig_processing_stage_t::new_splitters : contig_processing_stage_t::registration,
-                "", "", contig_t()), sample_priority, no_workers);
-
-            --sample_priority;
-        }
+        if (!concatenated_genomes && sample_contigs_added)
+            send_sample_sync();
 
         gio.Close();
     }
@@ -2245,7 +3358,7 @@ bool CAGCCompressor::AddSampleFiles(vector<pair<string, string>> _v_sample_file_
 
     pq_contigs_desc->MarkCompleted();
 
-    join_threads(v_threads);
+    thread_pool->Wait(task_group);
 
     if(concatenated_genomes)
         processed_samples = (uint32_t) dynamic_pointer_cast<CCollection_V3>(collection_desc)->get_no_samples();
@@ -2259,15 +3372,31 @@ bool CAGCCompressor::AddSampleFiles(vector<pair<string, string>> _v_sample_file_
     pq_contigs_desc_aux.reset();
     pq_contigs_desc_working.reset();
 
-    no_samples_in_archive += _v_sample_file_name.size() - num_empty_input;
+    if (max_memory && verbosity > 0 && is_app_mode)
+        cerr << "Partial synchronizations: " << no_partial_syncs << ", releases of LZ indexes: " << no_index_releases
+            << ", spilled segments: " << (buffered_seg_part.get_spilled_size() >> 20) << " MB" << endl;
+
+    if (buffered_seg_part.is_spill_error())
+    {
+        if (is_app_mode)
+            cerr << "Error: cannot read segments from temporary file\n";
+        return false;
+    }
+
+    if (pansn)
+        no_samples_in_archive += no_added_samples;
+    else
+        no_samples_in_archive += _v_sample_file_name.size() - num_empty_input;
 
     return true;
 }
 
 // *******************************************************************************************
 bool CAGCCompressor::Create(const string& _file_name, const uint32_t _pack_cardinality, const uint32_t _kmer_length, const string& reference_file_name, const uint32_t _segment_size,
-    const uint32_t _min_match_len, const bool _concatenated_genomes, const bool _adaptive_compression, const uint32_t _verbosity, const uint32_t no_threads, double _fallback_frac)
+    const uint32_t _min_match_len, const bool _concatenated_genomes, const bool _adaptive_compression, const uint32_t _verbosity, const uint32_t _no_threads, double _fallback_frac)
 {
+    const uint32_t no_threads = thread_pool->LimitThreads(_no_threads);
+
     if (working_mode != working_mode_t::none)
         return false;
 
@@ -2287,33 +3416,34 @@ bool CAGCCompressor::Create(const string& _file_name, const uint32_t _pack_cardi
         return false;
     }
 
+    out_archive_name = _file_name;
+
     out_archive = make_shared<CArchive>(false, 32 << 20);
     if (!out_archive->Open(_file_name))
     {
         working_mode = working_mode_t::none;
         return false;
     }
+
+    out_archive->SetPartChecksums(part_checksums);
     
     working_mode = working_mode_t::compression;
 
+    if (seekable_packs || !hot_samples.empty())
+    {
+        archive_version = AGC_FILE_MAJOR * 1000 + AGC_FILE_MINOR_PACK_EXT;
+        m_file_type_info["file_version_minor"] = to_string(AGC_FILE_MINOR_PACK_EXT);
+    }
+
     if (archive_version >= 3000 && archive_version < 4000)
+    {
+        dynamic_pointer_cast<CCollection_V3>(collection_desc)->set_thread_pool(thread_pool);
         dynamic_pointer_cast<CCollection_V3>(collection_desc)->set_archives(nullptr, out_archive, no_threads, pack_cardinality, segment_size, kmer_length);
+    }
 
     no_samples_in_archive = 0;
 
-    map_segments[std::make_pair(~0ull, ~0ull)] = 0;
-
-    v_segments.resize(no_raw_groups);
-
-    for (no_segments = 0; no_segments < no_raw_groups; ++no_segments)
-    {
-        contig_t empty_ctg{ 0x7f };
-
-        out_archive->RegisterStream(ss_delta_name(archive_version, no_segments));
-
-        v_segments[no_segments] = make_shared<CSegment>(ss_base(archive_version, no_segments), nullptr, out_archive, pack_cardinality, min_match_len, concatenated_genomes, archive_version);
-        v_segments[no_segments]->add_raw(empty_ctg, nullptr, nullptr);		// To ensure that raw (special) segments are present in the archive
-    }
+    create_raw_groups();
 
     if (archive_version >= 3000)
         dynamic_pointer_cast<CCollection_V3>(collection_desc)->reset_prev_sample_name();
@@ -2323,8 +3453,10 @@ bool CAGCCompressor::Create(const string& _file_name, const uint32_t _pack_cardi
 
 // *******************************************************************************************
 bool CAGCCompressor::Append(const string& _in_archive_fn, const string& _out_archive_fn, const uint32_t _verbosity, const bool _prefetch_archive, const bool _concatenated_genomes, const bool _adaptive_compression,
-    const uint32_t no_threads, double _fallback_frac)
+    const uint32_t _no_threads, double _fallback_frac)
 {
+    const uint32_t no_threads = thread_pool->LimitThreads(_no_threads);
+
     if (working_mode != working_mode_t::none)
         return false;
 
@@ -2337,7 +3469,6 @@ bool CAGCCompressor::Append(const string& _in_archive_fn, const string& _out_arc
     fallback_filter.reset(fallback_frac);
 
     min_match_len = compression_params.min_match_len;
-    uint32_t segment_size = compression_params.segment_size;
     verbosity = _verbosity;
 
     if (!load_file_type_info(in_archive_name))
@@ -2349,14 +3480,28 @@ bool CAGCCompressor::Append(const string& _in_archive_fn, const string& _out_arc
         return false;
     working_mode = working_mode_t::appending;
 
+    // Non-uniform pack layout can be stored only in the extended format (v3 archives can be upgraded)
+    if (archive_version < 3000)
+        hot_samples.clear();
+    else if (!hot_samples.empty() && !has_pack_ext())
+    {
+        archive_version = AGC_FILE_MAJOR * 1000 + AGC_FILE_MINOR_PACK_EXT;
+        m_file_type_info["file_version_minor"] = to_string(AGC_FILE_MINOR_PACK_EXT);
+    }
+
     out_archive = make_shared<CArchive>(false, 32 << 20);
 
     if (!out_archive->Open(out_archive_name))
         return false;
 
+    out_archive->SetPartChecksums(part_checksums || in_archive->HasPartChecksums());
+
     // !!! TODO (future): Add moving part of archive to the new one
     if (archive_version >= 3000 && archive_version < 4000)
+    {
+        dynamic_pointer_cast<CCollection_V3>(collection_desc)->set_thread_pool(thread_pool);
         dynamic_pointer_cast<CCollection_V3>(collection_desc)->set_archives(in_archive, out_archive, no_threads, pack_cardinality, segment_size, kmer_length);
+    }
 
     no_samples_in_archive = collection_desc->get_no_samples();
 
@@ -2370,6 +3515,100 @@ bool CAGCCompressor::Append(const string& _in_archive_fn, const string& _out_arc
     return true;
 }
 
+// *******************************************************************************************
+void CAGCCompressor::SetCheckpoints(const uint32_t interval)
+{
+    checkpoint_interval = interval;
+}
+
+// *******************************************************************************************
+void CAGCCompressor::SetMaxMemory(const size_t _max_memory)
+{
+    max_memory = _max_memory;
+}
+
+// *******************************************************************************************
+void CAGCCompressor::SetPanSN(const bool _pansn, const vector<string>& _skipped_samples)
+{
+    pansn = _pansn;
+    s_skipped_samples.clear();
+    s_skipped_samples.insert(_skipped_samples.begin(), _skipped_samples.end());
+}
+
+// *******************************************************************************************
+// Sample name from PanSN contig name (sample#haplotype#contig or sample#contig); default_name if there is no '#'
+string CAGCCompressor::pansn_sample_name(const string& id, const string& default_name)
+{
+    string name = id.substr(0, id.find_first_of(" \t"));
+
+    auto p = name.find('#');
+
+    if (p == string::npos)
+        return default_name;
+
+    auto q = name.find('#', p + 1);
+
+    return name.substr(0, q == string::npos ? p : q);
+}
+
+// *******************************************************************************************
+bool CAGCCompressor::PrepareResume(const string& archive_fn, string& resume_fn)
+{
+    resume_fn = archive_fn + ".resume";
+
+    error_code ec;
+
+    // Archive could be already truncated and renamed by a previous (interrupted) run
+    if (!filesystem::exists(resume_fn, ec))
+    {
+        ifstream ifs(checkpoint_info_name(archive_fn));
+        size_t file_size = 0;
+        uint32_t no_samples = 0;
+
+        if (!(ifs >> file_size >> no_samples))
+        {
+            cerr << "There is no checkpoint of archive " << archive_fn << endl;
+            return false;
+        }
+
+        filesystem::resize_file(archive_fn, file_size, ec);
+
+        if (!ec)
+            filesystem::rename(archive_fn, resume_fn, ec);
+
+        if (ec)
+        {
+            cerr << "Cannot restore checkpoint of archive " << archive_fn << ": " << ec.message() << endl;
+            return false;
+        }
+    }
+
+    resume_archive_name = resume_fn;
+
+    return true;
+}
+
+// *******************************************************************************************
+void CAGCCompressor::SetSeekablePacks(const bool _seekable_packs)
+{
+    seekable_packs = _seekable_packs;
+}
+
+// *******************************************************************************************
+void CAGCCompressor::SetPartChecksums(const bool _part_checksums)
+{
+    part_checksums = _part_checksums;
+}
+
+// *******************************************************************************************
+void CAGCCompressor::SetHotSamples(const vector<string>& _hot_samples, const uint32_t _hot_pack_cardinality)
+{
+    hot_samples.clear();
+    hot_samples.insert(_hot_samples.begin(), _hot_samples.end());
+
+    hot_pack_cardinality = _hot_pack_cardinality;
+}
+
 // *******************************************************************************************
 void CAGCCompressor::AddCmdLine(const string& cmd_line)
 {
@@ -2380,8 +3619,10 @@ void CAGCCompressor::AddCmdLine(const string& cmd_line)
 }
 
 // *******************************************************************************************
-bool CAGCCompressor::Close(const uint32_t no_threads)
+bool CAGCCompressor::Close(const uint32_t _no_threads)
 {
+    const uint32_t no_threads = thread_pool->LimitThreads(_no_threads);
+
     bool r = true;
 
     if (working_mode == working_mode_t::none)
@@ -2391,6 +3632,17 @@ bool CAGCCompressor::Close(const uint32_t no_threads)
     else if (working_mode == working_mode_t::appending)
         r = close_compression(no_threads);
 
+    if (r && (checkpoint_interval || !resume_archive_name.empty()))
+    {
+        error_code ec;
+
+        r = out_archive->Close();
+
+        filesystem::remove(checkpoint_info_name(out_archive_name), ec);
+        if (!resume_archive_name.empty())
+            filesystem::remove(resume_archive_name, ec);
+    }
+
     working_mode = working_mode_t::none;
 
     return r;
@@ -12,6 +12,7 @@
 // *******************************************************************************************
 
 #include "../common/agc_basic.h"
+#include "../common/arena.h"
 #include "../core/genome_io.h"
 #include "../core/hs.h"
 #include "../core/kmer.h"
@@ -21,7 +22,7 @@
 #include <list>
 #include <set>
 #include <map>
-#include <future>
+#include <unordered_set>
 
 // *******************************************************************************************
 class CBufferedSegPart
@@ -34,16 +35,21 @@ class CBufferedSegPart
 		contig_t seg_data;
 		bool is_rev_comp;
 		uint32_t seg_part_no;
+		uint64_t spill_pos;				// ~0ull - data are in memory, otherwise seg_data is empty and the data are in the spill file
+		uint64_t spill_size;
 
 		seg_part_t(const uint64_t _kmer1, const uint64_t _kmer2,
-			const string& _sample_name, const string& _contig_name, contig_t& _seg_data, bool _is_rev_comp, uint32_t _seg_part_no) :
+			const string& _sample_name, const string& _contig_name, contig_t& _seg_data, bool _is_rev_comp, uint32_t _seg_part_no,
+			const uint64_t _spill_pos = ~0ull, const uint64_t _spill_size = 0) :
 			kmer1(_kmer1),
 			kmer2(_kmer2),
 			sample_name(_sample_name),
 			contig_name(_contig_name),
 			seg_data(move(_seg_data)),
 			is_rev_comp(_is_rev_comp),
-			seg_part_no(_seg_part_no)
+			seg_part_no(_seg_part_no),
+			spill_pos(_spill_pos),
+			spill_size(_spill_size)
 		{};
 
 		seg_part_t() :
@@ -53,7 +59,9 @@ class CBufferedSegPart
 			contig_name{},
 			seg_data{},
 			is_rev_comp(false),
-			seg_part_no{ 0 }
+			seg_part_no{ 0 },
+			spill_pos(~0ull),
+			spill_size(0)
 		{};
 
 		seg_part_t(const seg_part_t& rhs)
@@ -65,6 +73,8 @@ class CBufferedSegPart
 			seg_data = rhs.seg_data;
 			is_rev_comp = rhs.is_rev_comp;
 			seg_part_no = rhs.seg_part_no;
+			spill_pos = rhs.spill_pos;
+			spill_size = rhs.spill_size;
 		}
 
 		seg_part_t(seg_part_t&& rhs) noexcept
@@ -76,6 +86,8 @@ class CBufferedSegPart
 			seg_data = move(rhs.seg_data);
 			is_rev_comp = rhs.is_rev_comp;
 			seg_part_no = rhs.seg_part_no;
+			spill_pos = rhs.spill_pos;
+			spill_size = rhs.spill_size;
 		}
 
 		seg_part_t& operator=(const seg_part_t& rhs) {
@@ -89,6 +101,8 @@ class CBufferedSegPart
 			seg_data = rhs.seg_data;
 			is_rev_comp = rhs.is_rev_comp;
 			seg_part_no = rhs.seg_part_no;
+			spill_pos = rhs.spill_pos;
+			spill_size = rhs.spill_size;
 
 			return *this;
 		}
@@ -105,6 +119,8 @@ class CBufferedSegPart
 			seg_data = move(rhs.seg_data);
 			is_rev_comp = rhs.is_rev_comp;
 			seg_part_no = rhs.seg_part_no;
+			spill_pos = rhs.spill_pos;
+			spill_size = rhs.spill_size;
 
 			return *this;
 		}
@@ -129,15 +145,20 @@ public:
 		contig_t seg_data;
 		bool is_rev_comp;
 		uint32_t seg_part_no;
+		uint64_t spill_pos;
+		uint64_t spill_size;
 
-		kk_seg_part_t(const uint64_t _kmer1, const uint64_t _kmer2, const string& _sample_name, const string& _contig_name, contig_t& _seg_data, bool _is_rev_comp, uint32_t _seg_part_no) :
+		kk_seg_part_t(const uint64_t _kmer1, const uint64_t _kmer2, const string& _sample_name, const string& _contig_name, contig_t& _seg_data, bool _is_rev_comp, uint32_t _seg_part_no,
+			const uint64_t _spill_pos = ~0ull, const uint64_t _spill_size = 0) :
 			kmer1(_kmer1),
 			kmer2(_kmer2),
 			sample_name(_sample_name),
 			contig_name(_contig_name),
 			seg_data(move(_seg_data)),
 			is_rev_comp(_is_rev_comp),
-			seg_part_no(_seg_part_no)
+			seg_part_no(_seg_part_no),
+			spill_pos(_spill_pos),
+			spill_size(_spill_size)
 		{};
 
 		kk_seg_part_t() :
@@ -147,7 +168,9 @@ public:
 			contig_name{},
 			seg_data{},
 			is_rev_comp(false),
-			seg_part_no{ 0 }
+			seg_part_no{ 0 },
+			spill_pos(~0ull),
+			spill_size(0)
 		{};
 
 		kk_seg_part_t(kk_seg_part_t&&) = default;
@@ -221,10 +244,11 @@ private:
 			l_seg_part.emplace_back(move(seg_part));
 		}
 
-		void emplace(uint64_t kmer1, uint64_t kmer2, const string& sample_name, const string& contig_name, contig_t& seg_data, bool is_rev_comp, uint32_t seg_part_no)
+		void emplace(uint64_t kmer1, uint64_t kmer2, const string& sample_name, const string& contig_name, contig_t& seg_data, bool is_rev_comp, uint32_t seg_part_no,
+			uint64_t spill_pos, uint64_t spill_size)
 		{
 			lock_guard<mutex> lck(mtx);
-			l_seg_part.emplace_back(kmer1, kmer2, sample_name, contig_name, seg_data, is_rev_comp, seg_part_no);
+			l_seg_part.emplace_back(kmer1, kmer2, sample_name, contig_name, seg_data, is_rev_comp, seg_part_no, spill_pos, spill_size);
 		}
 
 		void append_no_lock(seg_part_t& seg_part)
@@ -264,7 +288,8 @@ private:
 			return true;
 		}
 
-		bool pop(uint64_t& kmer1, uint64_t& kmer2, string& sample_name, string& contig_name, contig_t& seg_data, bool& is_rev_comp, uint32_t& seg_part_no)
+		bool pop(uint64_t& kmer1, uint64_t& kmer2, string& sample_name, string& contig_name, contig_t& seg_data, bool& is_rev_comp, uint32_t& seg_part_no,
+			uint64_t& spill_pos, uint64_t& spill_size)
 		{
 			if (virt_begin >= l_seg_part.size())
 			{
@@ -283,6 +308,8 @@ private:
 			seg_data = move(x.seg_data);
 			is_rev_comp = x.is_rev_comp;
 			seg_part_no = x.seg_part_no;
+			spill_pos = x.spill_pos;
+			spill_size = x.spill_size;
 
 			++virt_begin;
 
@@ -302,6 +329,46 @@ private:
 
 	atomic<int32_t> a_v_part_id;
 
+	CThreadPool* thread_pool = nullptr;
+
+	// Data of segments above the threshold are moved to the spill file until the parts are cleared
+	CSpillFile spill_file;
+	size_t spill_threshold = ~0ull;
+	atomic<size_t> buffered_size{ 0 };
+	atomic<uint64_t> spilled_size{ 0 };
+	atomic<bool> spill_error{ false };
+
+	// *******************************************************************************************
+	// Data are kept in memory if the spill file cannot be written
+	void spill(contig_t& seg_data, uint64_t& spill_pos, uint64_t& spill_size)
+	{
+		spill_pos = ~0ull;
+		spill_size = seg_data.size();
+
+		if (buffered_size.fetch_add(spill_size) + spill_size <= spill_threshold)
+			return;
+
+		spill_pos = spill_file.Write(seg_data.data(), spill_size);
+
+		if (spill_pos == ~0ull)
+			return;
+
+		buffered_size -= spill_size;
+		spilled_size += spill_size;
+
+		seg_data.clear();
+		seg_data.shrink_to_fit();
+	}
+
+	// *******************************************************************************************
+	void run_parallel(uint32_t nt, const function<void()>& job)
+	{
+		if (thread_pool)
+			thread_pool->ParallelRun(nt, job);
+		else
+			job();
+	}
+
 public:
 	static const int32_t part_id_step = 1;
 
@@ -312,6 +379,26 @@ public:
 
 	~CBufferedSegPart() = default;
 
+	void set_thread_pool(CThreadPool* _thread_pool)
+	{
+		thread_pool = _thread_pool;
+	}
+
+	void set_spill_threshold(const size_t _spill_threshold)
+	{
+		spill_threshold = _spill_threshold;
+	}
+
+	uint64_t get_spilled_size() const
+	{
+		return spilled_size;
+	}
+
+	bool is_spill_error() const
+	{
+		return spill_error;
+	}
+
 	void resize(uint32_t no_groups)
 	{
 		vl_seg_part.resize(no_groups);
@@ -319,15 +406,23 @@ public:
 
 	void add_known(uint32_t group_id, uint64_t kmer1, uint64_t kmer2, const string& sample_name, const string& contig_name, contig_t&& seg_data, bool is_rev_comp, uint32_t seg_part_no)
 	{
+		uint64_t spill_pos, spill_size;
+
+		spill(seg_data, spill_pos, spill_size);
+
 		// !!! TODO: use move() here?
-		vl_seg_part[group_id].emplace(kmer1, kmer2, sample_name, contig_name, seg_data, is_rev_comp, seg_part_no);		// internal mutex
+		vl_seg_part[group_id].emplace(kmer1, kmer2, sample_name, contig_name, seg_data, is_rev_comp, seg_part_no, spill_pos, spill_size);		// internal mutex
 	}
 
 	void add_new(uint64_t kmer1, uint64_t kmer2, const string& sample_name, const string& contig_name, contig_t& seg_data, bool is_rev_comp, uint32_t seg_part_no)
 	{
+		uint64_t spill_pos, spill_size;
+
+		spill(seg_data, spill_pos, spill_size);
+
 		lock_guard<mutex> lck(mtx);
 		// !!! TODO: use move() here?
-		s_seg_part.emplace(kmer1, kmer2, sample_name, contig_name, seg_data, is_rev_comp, seg_part_no);
+		s_seg_part.emplace(kmer1, kmer2, sample_name, contig_name, seg_data, is_rev_comp, seg_part_no, spill_pos, spill_size);
 	}
 
 	void sort_known(uint32_t nt)
@@ -363,17 +458,7 @@ public:
 			}
 			};
 
-		vector<future<void>> v_fut;
-
-		v_fut.reserve(nt);
-
-		for (uint64_t i = 0; i < nt - 1; ++i)
-			v_fut.emplace_back(async(job));
-
-		job();
-
-		for (auto& f : v_fut)
-			f.wait();
+		run_parallel(nt, job);
 	}
 
 	const set<kk_seg_part_t>& get_seg_parts() const
@@ -403,10 +488,11 @@ public:
 			vl_seg_part.reserve((uint64_t)(group_id * 1.2));
 		vl_seg_part.resize(group_id);
 
+		// Data are already accounted for (or spilled)
 		for (auto& x : s_seg_part)
 		{
-			add_known(m_kmers[make_pair(x.kmer1, x.kmer2)], x.kmer1, x.kmer2,
-				x.sample_name, x.contig_name, const_cast<contig_t&&>(x.seg_data), x.is_rev_comp, x.seg_part_no);
+			vl_seg_part[m_kmers[make_pair(x.kmer1, x.kmer2)]].emplace(x.kmer1, x.kmer2,
+				x.sample_name, x.contig_name, const_cast<contig_t&>(x.seg_data), x.is_rev_comp, x.seg_part_no, x.spill_pos, x.spill_size);
 		}
 
 		s_seg_part.clear();
@@ -492,18 +578,12 @@ public:
 			}
 			};
 
-		vector<future<void>> v_fut;
-
-		v_fut.reserve(nt);
-
-		for (uint64_t i = 0; i < nt - 1; ++i)
-			v_fut.emplace_back(async(job));
-
 		s_seg_part.clear();
-		job();
 
-		for (auto& f : v_fut)
-			f.wait();
+		run_parallel(nt, job);
+
+		buffered_size = 0;
+		spill_file.Rewind();
 	}
 
 	void restart_read_vec()
@@ -531,10 +611,25 @@ public:
 
 	bool get_part(int group_id, uint64_t &kmer1, uint64_t &kmer2, string& sample_name, string& contig_name, contig_t& seg_data, bool& is_rev_comp, uint32_t& seg_part_no)
 	{
-		return vl_seg_part[group_id].pop(kmer1, kmer2, sample_name, contig_name, seg_data, is_rev_comp, seg_part_no);
+		uint64_t spill_pos, spill_size;
+
+		if (!vl_seg_part[group_id].pop(kmer1, kmer2, sample_name, contig_name, seg_data, is_rev_comp, seg_part_no, spill_pos, spill_size))
+			return false;
+
+		if (spill_pos != ~0ull)
+		{
+			seg_data.resize(spill_size);
+
+			if (!spill_file.Read(spill_pos, seg_data.data(), spill_size))
+				spill_error = true;
+		}
+
+		return true;
 	}
 };
 
+class CAGCDecompressorLibrary;
+
 // *******************************************************************************************
 // Class supporting decompression and compresion of AGC files
 class CAGCCompressor : public CAGCBasic
@@ -616,6 +711,12 @@ class CAGCCompressor : public CAGCBasic
 	bool concatenated_genomes;
 	bool adaptive_compression;
 
+	unordered_set<string> hot_samples;															// only reads during compression - no need to lock
+	uint32_t hot_pack_cardinality = 1;
+
+	bool part_checksums = false;
+	vector<vector<uint32_t>> vv_pack_layouts;													// taken from segments when they are finished
+
 	shared_ptr<CArchive> out_archive;															// internal mutexes
 
 	vector<uint64_t> v_candidate_kmers;
@@ -647,6 +748,7 @@ class CAGCCompressor : public CAGCBasic
 	uint32_t processed_samples{ 0 };
 
 	vector<vector<uint64_t>> vv_splitters;
+	vector<unique_ptr<CArena>> v_arenas;			// per compressing thread; temporaries of a single task only
 
 	vector<tuple<string, string, contig_t>> v_raw_contigs;
 	mutex mtx_raw_contigs;
@@ -674,12 +776,14 @@ class CAGCCompressor : public CAGCBasic
 	void register_segments(uint32_t n_t);
 	void store_segments(ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx);
 
-	pair<pair<uint64_t, uint64_t>, bool> find_cand_segment_with_one_splitter(CKmer kmer, contig_t& segment_dir, contig_t& segment_rc, ZSTD_DCtx* zstd_dctx, my_barrier& bar);
-	pair<uint64_t, uint32_t> find_cand_segment_with_missing_middle_splitter(CKmer kmer_front, CKmer kmer_back, contig_t& segment_dir, contig_t& segment_rc, ZSTD_DCtx* zstd_dctx, my_barrier& bar);
-	pair<pair<uint64_t, uint64_t>, bool> find_cand_segment_using_fallback_minimizers(contig_t& segment, uint64_t max_val);
+	pair<pair<uint64_t, uint64_t>, bool> find_cand_segment_with_one_splitter(CKmer kmer, contig_t& segment_dir, contig_t& segment_rc, ZSTD_DCtx* zstd_dctx, my_barrier& bar, CArena& arena);
+	pair<uint64_t, uint32_t> find_cand_segment_with_missing_middle_splitter(CKmer kmer_front, CKmer kmer_back, contig_t& segment_dir, contig_t& segment_rc, ZSTD_DCtx* zstd_dctx, my_barrier& bar, CArena& arena);
+	pair<pair<uint64_t, uint64_t>, bool> find_cand_segment_using_fallback_minimizers(contig_t& segment, uint64_t max_val, CArena& arena);
 
 	contig_t get_part(const contig_t& contig, uint64_t pos, uint64_t len);
 	void preprocess_raw_contig(contig_t& ctg);
+	contig_stats_t count_contig_stats(const contig_t& ctg) const;
+	contig_digest_t compute_contig_digest(const contig_t& ctg) const;
 	void find_new_splitters(contig_t& ctg, uint32_t thread_id);
 
 	void add_fallback_kmers(vector<uint64_t>::iterator first, vector<uint64_t>::iterator last);
@@ -723,17 +827,21 @@ class CAGCCompressor : public CAGCBasic
 	void compressing_stage1_job(uint32_t thread_id, uint32_t n_t);
 	void compressing_stage2_job(uint32_t thread_id, uint32_t n_t);
 
-	void start_compressing_threads(vector<thread> &v_threads, my_barrier &bar, const uint32_t n_t);
-	void start_finalizing_threads(vector<thread>& v_threads, const uint32_t n_t);
-	void start_splitter_finding_threads(vector<thread>& v_threads, const uint32_t n_t, const vector<uint64_t>::iterator v_begin, const vector<uint64_t>::iterator v_end, vector<vector<uint64_t>>& v_splitters);
-	void start_kmer_collecting_threads(vector<thread>& v_threads, const uint32_t n_t, vector<uint64_t>& v_kmers, const size_t extra_items);
+	void start_compressing_threads(CTaskGroup &task_group, my_barrier &bar, const uint32_t n_t);
+	void start_finalizing_threads(CTaskGroup& task_group, const uint32_t n_t);
+	void start_splitter_finding_threads(CTaskGroup& task_group, const uint32_t n_t, const vector<uint64_t>::iterator v_begin, const vector<uint64_t>::iterator v_end, vector<vector<uint64_t>>& v_splitters);
+	void start_kmer_collecting_threads(CTaskGroup& task_group, const uint32_t n_t, vector<uint64_t>& v_kmers, const size_t extra_items);
 
 	void store_metadata_impl_v1(uint32_t no_threads);
 	void store_metadata_impl_v2(uint32_t no_threads);
 	void store_metadata_impl_v3(uint32_t no_threads);
 
-	void store_metadata(uint32_t no_threads);
+	void store_metadata(uint32_t no_threads, const bool print_stats = true);
+	void store_pack_layouts();
+	shared_ptr<CSegment> make_segment(const uint32_t group_id, shared_ptr<CArchive> _in_archive);
+	void create_raw_groups();
 	void appending_init();
+	void allocate_candidate_kmers(const size_t size);
 	bool determine_splitters(const string& reference_file_name, const size_t segment_size, const uint32_t no_threads);
 	bool count_kmers(vector<pair<string, vector<uint8_t>>>& v_contig_data, const uint32_t no_threads);
 
@@ -747,6 +855,67 @@ class CAGCCompressor : public CAGCBasic
 
 	void build_candidate_kmers_from_archive(const uint32_t n_t);
 
+	// Checkpoints (made at sample registration boundaries)
+	uint32_t checkpoint_interval = 0;															// in samples (0 - no checkpoints)
+	uint32_t checkpoint_samples = 0;															// no. of processed samples at the last checkpoint
+	string resume_archive_name;
+
+	void store_checkpoint_segments(ZSTD_CCtx* zstd_cctx);
+	bool store_checkpoint();
+	static string checkpoint_info_name(const string& archive_fn);
+
+	// Memory budget (0 - no limit). What is left after the structures that cannot be limited (candidate k-mers, splitters)
+	// is split between the input queue, the contigs waiting for synchronization and the LZ indexes of groups
+	const size_t min_memory_share = 1ull << 20;
+	const string partial_sync_name = "*";														// sample name in tokens of synchronizations forced by the budget
+
+	size_t max_memory = 0;
+	size_t sync_memory_limit = ~0ull;
+	size_t index_memory_limit = ~0ull;
+	uint64_t no_partial_syncs = 0;
+	uint64_t no_index_releases = 0;
+
+	size_t fixed_memory_usage();
+	size_t memory_share();
+	void limit_index_memory();
+
+	// Samples of PanSN-named contigs in input files
+	bool pansn = false;
+	set<string> s_skipped_samples;
+
+	static string pansn_sample_name(const string& id, const string& default_name);
+
+	// Merging of archives
+	struct merged_group_origin_t
+	{
+		shared_ptr<CArchive> archive;
+		uint32_t group_id;
+	};
+
+	map<uint32_t, merged_group_origin_t> m_merged_group_origins;								// groups created from groups of merged archives
+
+	// Reselection of group references (optimization of archive)
+	const uint32_t reselect_max_candidates = 8;
+	const uint32_t reselect_max_evaluated = 32;
+	const double reselect_min_gain = 0.02;
+
+	bool reselect_references = false;
+	atomic<uint64_t> no_reselected_groups{ 0 };
+	atomic<uint64_t> reselect_old_delta_size{ 0 };
+	atomic<uint64_t> reselect_new_delta_size{ 0 };
+	atomic<uint64_t> reselect_old_decode_ns{ 0 };
+	atomic<uint64_t> reselect_new_decode_ns{ 0 };
+
+	bool merge_check_compatibility(CAGCDecompressorLibrary& src, const string& src_name);
+	bool merge_load_group_keys(CAGCDecompressorLibrary& src, unordered_map<uint32_t, pair<uint64_t, uint64_t>>& m_group_keys);
+	bool merge_get_group_reference(const uint32_t group_id, contig_t& ref, ZSTD_DCtx* zstd_dctx);
+	bool merge_group(CAGCDecompressorLibrary& src, const uint32_t src_group_id, const uint32_t group_id, const bool new_group, vector<uint32_t>& v_remap,
+		ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx, uint64_t& no_reused, uint64_t& no_reencoded);
+	bool merge_group_reselect(const contig_t& src_ref, const vector<contig_t>& v_members, vector<uint32_t>& v_remap, shared_ptr<CSegment> segment,
+		ZSTD_CCtx* zstd_cctx, ZSTD_DCtx* zstd_dctx, uint64_t& no_reencoded);
+	bool merge_archive(CAGCDecompressorLibrary& src, const string& src_name, const vector<string>& v_sample_names, const uint32_t no_threads);
+	void merge_finish();
+
 public:
 	CAGCCompressor();
 	~CAGCCompressor();
@@ -756,11 +925,55 @@ public:
 	bool Append(const string& _in_archive_fn, const string& _out_archive_fn, const uint32_t _verbosity, const bool _prefetch_archive, const bool _concatenated_genomes, const bool _adaptive_compression,
 		const uint32_t no_threads, double _fallback_frac);
 
+	// Mark samples as removed (in place, only the collection metadata are updated). Segments of removed samples are kept until Subset()
+	bool RemoveSamples(const string& archive_fn, const vector<string>& v_sample_names, const uint32_t _verbosity);
+
 	void AddCmdLine(const string& cmd_line);
 
+	// Must be called before Create(); in the appending mode the pack format of the input archive is kept
+	void SetSeekablePacks(const bool _seekable_packs);
+
+	// Segments of hot samples are stored in separate packs of (at most) given cardinality, to make their extraction cheap.
+	// Must be called before Create() or Append()
+	void SetHotSamples(const vector<string>& _hot_samples, const uint32_t _hot_pack_cardinality);
+
+	// Checksums of archive parts (for fast integrity verification) are stored in the output archive.
+	// Must be called before Create() or Append(); in the appending mode checksums are also stored if the input archive contains them
+	void SetPartChecksums(const bool _part_checksums);
+
+	// After every interval samples the output file is made a complete archive and its size is stored in <archive>.ckpt.
+	// Must be called before Create() or Append()
+	void SetCheckpoints(const uint32_t interval);
+
+	// Memory budget (in bytes) of compression; 0 means no limit.
+	// Must be called before Create() or Append()
+	void SetMaxMemory(const size_t _max_memory);
+
+	// Input files contain many samples of contigs named according to PanSN (sample#haplotype#contig); contigs of a sample
+	// must be consecutive in a single file. Contigs of skipped samples (e.g., already stored when resuming) are ignored.
+	// Must be called before AddSampleFiles()
+	void SetPanSN(const bool _pansn, const vector<string>& _skipped_samples = {});
+
+	// Archive is truncated to the last checkpoint and renamed to resume_fn, which should be the input of Append().
+	// The file is removed after the next checkpoint or successful Close()
+	bool PrepareResume(const string& archive_fn, string& resume_fn);
+
 	bool Close(const uint32_t no_threads = 1);
 
 	bool AddSampleFiles(vector<pair<string, string>> _v_sample_file_name, const uint32_t _no_threads);
+
+	// Add samples of other archives (of the same k-mer length, min. match length, batch size and pack format).
+	// Groups of segments with the same splitters are unified. Must be called after Append()
+	bool MergeArchives(const vector<string>& v_archive_names, const uint32_t _no_threads);
+
+	// Create archive containing only given samples (all not removed samples if v_sample_names is empty) of other archive 
+	// (compression parameters of the input archive are kept). Only the segments referenced by the samples are transferred 
+	// (without LZ decoding); used instead of Create()
+	bool Subset(const string& _in_archive_fn, const string& _out_archive_fn, const vector<string>& v_sample_names, const uint32_t _verbosity, const uint32_t _no_threads);
+
+	// Subset() of all samples, in which the reference of each group is replaced by the member of the lowest total (estimated) 
+	// LZ cost of encoding the other members, if the gain is significant
+	bool Optimize(const string& _in_archive_fn, const string& _out_archive_fn, const uint32_t _verbosity, const uint32_t _no_threads);
 };
 
 // EOF
@@ -12,6 +12,8 @@
 #include "genome_io.h"
 #include <filesystem>
 #include <chrono>
+#include <fstream>
+#include <sstream>
 
 using namespace std::filesystem;
 
@@ -54,6 +56,8 @@ void CAGCDecompressor::start_decompressing_threads(vector<thread>& v_threads, co
 			if (!q_contig_tasks->Pop(contig_desc))
 				break;
 
+			no_started_tasks.fetch_add(1);
+
 			size_t priority = contig_desc.priority;
 
 			if (!decompress_contig(contig_desc, zstd_ctx, ctg, fast))
@@ -79,6 +83,101 @@ void CAGCDecompressor::start_decompressing_threads(vector<thread>& v_threads, co
 		});
 }
 
+// *******************************************************************************************
+void CAGCDecompressor::SetReadaheadDepth(const uint32_t _readahead_depth)
+{
+	readahead_depth = _readahead_depth;
+}
+
+// *******************************************************************************************
+int CAGCDecompressor::pack_of_member(const uint32_t group_id, const uint32_t member_id) const
+{
+	auto p = m_pack_layouts.find(group_id);
+
+	if (p == m_pack_layouts.end())
+		return (int)(member_id / compression_params.pack_cardinality);
+
+	return (int)(upper_bound(p->second.begin(), p->second.end(), member_id) - p->second.begin());
+}
+
+// *******************************************************************************************
+// Parts needed to decompress the segments: reference and the pack of the member (delta groups) or the pack only (raw groups)
+void CAGCDecompressor::readahead_segments(const vector<segment_desc_t>& segments, vector<pair<string, int>>& v_stream_parts)
+{
+	v_stream_parts.clear();
+
+	for (const auto& seg : segments)
+	{
+		string base = ss_base(archive_version, seg.group_id);
+		uint32_t member_id = seg.in_group_id;
+
+		if (seg.group_id >= no_raw_groups)
+		{
+			v_stream_parts.emplace_back(base + ss_ref_ext(archive_version), 0);
+
+			if (seg.in_group_id == 0)
+				continue;
+
+			--member_id;
+		}
+
+		v_stream_parts.emplace_back(base + ss_delta_ext(archive_version), pack_of_member(seg.group_id, member_id));
+	}
+
+	in_archive->Readahead(v_stream_parts);
+}
+
+// *******************************************************************************************
+// The thread follows the order of tasks in q_contig_tasks and stays at most readahead_depth tasks ahead of decompressing threads
+void CAGCDecompressor::start_readahead_thread(thread& ra_thread)
+{
+	no_started_tasks = 0;
+
+	if (readahead_depth == 0 || prefetch_archive)
+		return;
+
+	q_readahead = make_unique<CBoundedQueue<vector<segment_desc_t>>>(1, 1);
+
+	ra_thread = thread([&] {
+		vector<segment_desc_t> segments;
+		vector<pair<string, int>> v_stream_parts;
+		uint64_t task_id = 0;
+
+		while (!q_readahead->IsCompleted())
+		{
+			if (!q_readahead->Pop(segments))
+				break;
+
+			while (task_id >= no_started_tasks.load() + readahead_depth)
+				this_thread::sleep_for(std::chrono::microseconds(100));
+
+			readahead_segments(segments, v_stream_parts);
+			++task_id;
+		}
+		});
+}
+
+// *******************************************************************************************
+void CAGCDecompressor::stop_readahead_thread(thread& ra_thread)
+{
+	if (!q_readahead)
+		return;
+
+	q_readahead->MarkCompleted();
+	ra_thread.join();
+
+	q_readahead.reset();
+}
+
+// *******************************************************************************************
+void CAGCDecompressor::push_contig_task(contig_task_t& task)
+{
+	if (q_readahead)
+		q_readahead->Push(task.segments, 0);
+
+	q_contig_tasks->Push(task, 0);
+}
+
 // *******************************************************************************************
 // Assign archive from already opened one
 bool CAGCDecompressor::AssignArchive(const CAGCBasic& agc_basic)
@@ -101,8 +200,13 @@ bool CAGCDecompressor::AssignArchive(const CAGCBasic& agc_basic)
 
 	compression_params = agc_basic.compression_params;
 
+	seekable_packs = agc_basic.seekable_packs;
+	m_pack_layouts = agc_basic.m_pack_layouts;
+
 	verbosity = agc_basic.verbosity;
 
+	thread_pool = agc_basic.thread_pool;
+
 	return true;
 }
 
@@ -196,6 +300,9 @@ bool CAGCDecompressor::GetCollectionFiles(const string& _path, const uint32_t _l
 
 	q_contig_tasks->Restart(1);
 
+	thread ra_thread;
+	start_readahead_thread(ra_thread);
+
 	start_decompressing_threads(v_threads, no_threads, gzip_level, _line_length, fast);
 
 	sample_desc_t sample_desc;
@@ -227,10 +334,11 @@ bool CAGCDecompressor::GetCollectionFiles(const string& _path, const uint32_t _l
 		prev_no_contigs = sample_desc.size();
 
 		for (auto& task : v_tasks)
-			q_contig_tasks->Push(task, 0);
+			push_contig_task(task);
 	}
 
 	q_contig_tasks->MarkCompleted();
+	stop_readahead_thread(ra_thread);
 
 	join_threads(v_threads);
 
@@ -314,11 +422,15 @@ bool CAGCDecompressor::GetSampleFile(const string& _file_name, const vector<stri
 
 		q_contig_tasks->Restart(1);
 
+		thread ra_thread;
+		start_readahead_thread(ra_thread);
+
 		start_decompressing_threads(v_threads, no_threads, gzip_level, _line_length);
 
 		for (auto& task : v_tasks)
-			q_contig_tasks->Push(task, 0);
+			push_contig_task(task);
 		q_contig_tasks->MarkCompleted();
+		stop_readahead_thread(ra_thread);
 
 		join_threads(v_threads);
 
@@ -567,6 +679,186 @@ bool CAGCDecompressor::GetContigFile(const string& _file_name, const vector<stri
 	return true;
 }
 
+// *******************************************************************************************
+// Regions in BED format: contig, start (0-based), end (exclusive) and optional sample name
+bool CAGCDecompressor::load_regions(const string& regions_file_name, vector<pair<string, name_range_t>>& v_sample_contig)
+{
+	ifstream inf(regions_file_name);
+
+	if (!inf.is_open())
+	{
+		cerr << "Cannot open file: " << regions_file_name << endl;
+		return false;
+	}
+
+	string line;
+	uint64_t line_no = 0;
+
+	while (getline(inf, line))
+	{
+		++line_no;
+
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line.empty() || line[0] == '#' || line.compare(0, 5, "track") == 0 || line.compare(0, 7, "browser") == 0)
+			continue;
+
+		istringstream iss(line);
+		string contig;
+		string sample;
+		int64_t start, end;
+
+		if (!(iss >> contig >> start >> end) || start < 0 || end <= start)
+		{
+			cerr << "Wrong region in line " << line_no << ": " << line << endl;
+			return false;
+		}
+
+		iss >> sample;
+
+		if (!sample.empty())
+		{
+			if (!collection_desc->is_contig_desc(sample, contig))
+			{
+				cerr << "There is no sample:contig pair: " << sample << " : " << contig << endl;
+				return false;
+			}
+		}
+		else
+		{
+			auto v_cand_samples = collection_desc->get_samples_for_contig(contig);
+			if (v_cand_samples.size() == 0)
+			{
+				cerr << "There is no contig: " << contig << endl;
+				return false;
+			}
+			if (v_cand_samples.size() > 1)
+			{
+				cerr << "There are " << v_cand_samples.size() << " samples with conting: " << contig << endl;
+				return false;
+			}
+
+			sample = v_cand_samples.front();
+		}
+
+		v_sample_contig.emplace_back(sample, name_range_t(contig, start, end - 1));
+	}
+
+	return true;
+}
+
+// *******************************************************************************************
+// Group and in-group id of the first segment needed to extract a range starting at position from
+// (members of a group are stored in packs in the order of in-group ids, so this also determines the pack)
+pair<uint32_t, uint32_t> CAGCDecompressor::region_first_segment(const vector<segment_desc_t>& segments, const int64_t from) const
+{
+	int64_t curr_pos = 0;
+
+	for (const auto& seg : segments)
+	{
+		if (curr_pos + (int64_t)seg.raw_length >= from)
+			return make_pair(seg.group_id, seg.in_group_id);
+
+		curr_pos += (int64_t)seg.raw_length - kmer_length;
+	}
+
+	return make_pair(~0u, ~0u);
+}
+
+// *******************************************************************************************
+// Extraction of many regions: regions are taken in batches (in the input order) and inside a batch they are sorted by
+// the segments they start at, so regions sharing packs are extracted one after another in the fast mode and each pack
+// is decompressed once; the output keeps the input order
+bool CAGCDecompressor::GetRegionsFile(const string& _file_name, const string& regions_file_name, const uint32_t _line_length, const uint32_t no_threads, const uint32_t gzip_level, uint32_t verbosity)
+{
+	if (working_mode != working_mode_t::decompression)
+		return false;
+
+	vector<pair<string, name_range_t>> v_sample_contig;
+
+	if (!load_regions(regions_file_name, v_sample_contig))
+		return false;
+
+	if (verbosity > 0)
+		cerr << "No. regions: " << v_sample_contig.size() << endl;
+
+	q_contig_tasks = make_unique<CBoundedQueue<contig_task_t>>(1, 1);
+	pq_contigs_to_save = make_unique<CPriorityQueue<sample_contig_data_t>>(no_threads);
+
+	// Saving thread
+	thread gio_thread([&] {
+		CGenomeIO gio;
+		sample_contig_data_t ctg;
+
+		gio.Open(_file_name, true);
+
+		while (!pq_contigs_to_save->IsCompleted())
+		{
+			if (!pq_contigs_to_save->Pop(ctg))
+				break;
+			gio.SaveContigDirectly(ctg.contig_name, ctg.contig_data, gzip_level);
+		}
+
+		gio.Close();
+		});
+
+	vector<thread> v_threads;
+	v_threads.reserve(no_threads);
+
+	start_decompressing_threads(v_threads, no_threads, gzip_level, _line_length, true);
+
+	vector<pair<pair<uint32_t, uint32_t>, contig_task_t>> v_batch;
+	uint64_t batch_symbols = 0;
+
+	auto process_batch = [&] {
+		stable_sort(v_batch.begin(), v_batch.end(), [](const auto& x, const auto& y) {
+			return x.first < y.first;
+			});
+
+		for (auto& task : v_batch)
+			q_contig_tasks->Push(task.second, 0);
+
+		v_batch.clear();
+		batch_symbols = 0;
+
+		// Cached segments (references and recently used packs) are not needed by the next batch
+		unique_lock<shared_mutex> lck(mtx_segment);
+		v_segment.clear();
+	};
+
+	uint32_t id = 0;
+	vector<segment_desc_t> contig_desc;
+
+	for (auto& p_sc : v_sample_contig)
+	{
+		collection_desc->get_contig_desc(p_sc.first, p_sc.second.name, contig_desc);
+
+		v_batch.emplace_back(region_first_segment(contig_desc, p_sc.second.from), contig_task_t(id++, "", p_sc.second, contig_desc));
+		batch_symbols += (uint64_t)(p_sc.second.to - p_sc.second.from + 1);
+
+		if (batch_symbols >= region_batch_max_symbols || v_batch.size() >= region_batch_max_regions)
+			process_batch();
+	}
+
+	process_batch();
+
+	q_contig_tasks->MarkCompleted();
+
+	join_threads(v_threads);
+	gio_thread.join();
+
+	q_contig_tasks.release();
+	pq_contigs_to_save.release();
+
+	{
+		unique_lock<shared_mutex> lck(mtx_segment);
+		v_segment.clear();
+	}
+
+	return true;
+}
+
 // *******************************************************************************************
 bool CAGCDecompressor::GetContigForStreaming(const string& _file_name, const vector<string>& contig_names, const uint32_t _line_length, const uint32_t no_threads, const uint32_t gzip_level, uint32_t verbosity)
 {
@@ -662,4 +954,301 @@ bool CAGCDecompressor::GetContigForStreaming(const string& _file_name, const vec
 	return true;
 }
 
+// *******************************************************************************************
+// Parts are read under the archive lock, but checksums are computed in parallel
+bool CAGCDecompressor::verify_part_checksums(const uint32_t no_threads, vector<string>& v_issues, uint32_t verbosity)
+{
+	vector<pair<int, int>> v_parts;
+
+	for (int i = 0; i < (int) in_archive->GetNoStreams(); ++i)
+		for (int j = 0; j < (int) in_archive->GetNoParts(i); ++j)
+			v_parts.emplace_back(i, j);
+
+	atomic<size_t> next_part{ 0 };
+	atomic<size_t> no_checked{ 0 };
+	mutex mtx_issues;
+	bool ok = true;
+
+	vector<thread> v_threads;
+	v_threads.reserve(no_threads);
+
+	for (uint32_t i = 0; i < no_threads; ++i)
+		v_threads.emplace_back([&] {
+			for (size_t id = next_part++; id < v_parts.size(); id = next_part++)
+			{
+				int r = in_archive->VerifyPart(v_parts[id].first, v_parts[id].second);
+
+				if (r < 0)
+					continue;
+
+				++no_checked;
+
+				if (r == 0)
+				{
+					lock_guard<mutex> lck(mtx_issues);
+					v_issues.emplace_back("Checksum mismatch in part " + to_string(v_parts[id].second) + " of stream " + in_archive->GetStreamName(v_parts[id].first));
+					ok = false;
+				}
+			}
+		});
+
+	for (auto& t : v_threads)
+		t.join();
+
+	if (verbosity > 0)
+		cerr << "Part checksums verified: " << no_checked << endl;
+
+	return ok;
+}
+
+// *******************************************************************************************
+// Lengths of all segments referenced by the collection (indexed by group and in-group id; 0 - not referenced)
+bool CAGCDecompressor::collect_referenced_segments(vector<vector<uint32_t>>& vv_group_lengths, vector<string>& v_issues, uint32_t verbosity)
+{
+	vector<string> v_samples;
+	vector<pair<string, vector<segment_desc_t>>> sample_desc;
+	vector<pair<string, contig_stats_t>> v_contig_stats;
+	vector<pair<string, contig_digest_t>> v_contig_digests;
+
+	// Upper bounds of no. of group members (protect from allocating memory for corrupted ids)
+	unordered_map<uint32_t, uint32_t> m_group_limits;
+	const uint32_t max_group_id = (uint32_t) in_archive->GetNoStreams();
+
+	auto group_limit = [&](uint32_t group_id) -> uint32_t {
+		auto p = m_group_limits.find(group_id);
+		if (p != m_group_limits.end())
+			return p->second;
+
+		uint64_t no_parts = in_archive->GetNoParts(in_archive->GetStreamId(ss_delta_name(archive_version, group_id)));
+		uint64_t limit = no_parts * compression_params.pack_cardinality;
+
+		auto p_layout = m_pack_layouts.find(group_id);
+		if (p_layout != m_pack_layouts.end() && !p_layout->second.empty())
+			limit = max<uint64_t>(limit, p_layout->second.back());
+
+		limit = min<uint64_t>(limit + 1, ~0u);		// reference of LZ-coded groups
+
+		m_group_limits[group_id] = (uint32_t) limit;
+
+		return (uint32_t) limit;
+	};
+
+	collection_desc->get_samples_list(v_samples, false);
+
+	bool has_stats = collection_desc->has_contig_stats();
+	bool ok = true;
+	uint64_t no_references = 0;
+
+	for (auto& sample_name : v_samples)
+	{
+		if (!collection_desc->get_sample_desc(sample_name, sample_desc))
+		{
+			v_issues.emplace_back("Cannot load description of sample " + sample_name);
+			ok = false;
+			continue;
+		}
+
+		if (has_stats && (!collection_desc->get_sample_stats(sample_name, v_contig_stats) || v_contig_stats.size() != sample_desc.size()))
+		{
+			v_issues.emplace_back("Inconsistent contig stats of sample " + sample_name);
+			ok = false;
+			v_contig_stats.clear();
+		}
+
+		if (collection_desc->has_contig_digests() && (!collection_desc->get_sample_digests(sample_name, v_contig_digests) || v_contig_digests.size() != sample_desc.size()))
+		{
+			v_issues.emplace_back("Inconsistent contig digests of sample " + sample_name);
+			ok = false;
+		}
+
+		for (size_t i = 0; i < sample_desc.size(); ++i)
+		{
+			auto& contig_name = sample_desc[i].first;
+			uint64_t contig_len = 0;
+
+			for (auto& seg : sample_desc[i].second)
+			{
+				++no_references;
+				contig_len += seg.raw_length;
+
+				if (seg.group_id >= max_group_id || seg.in_group_id >= group_limit(seg.group_id))
+				{
+					v_issues.emplace_back("Wrong segment (" + to_string(seg.group_id) + ", " + to_string(seg.in_group_id) + ") in contig " + sample_name + " : " + contig_name);
+					ok = false;
+					continue;
+				}
+
+				if (vv_group_lengths.size() <= seg.group_id)
+					vv_group_lengths.resize(seg.group_id + 1);
+
+				auto& v_lengths = vv_group_lengths[seg.group_id];
+
+				if (v_lengths.size() <= seg.in_group_id)
+					v_lengths.resize(seg.in_group_id + 1, 0);
+
+				if (v_lengths[seg.in_group_id] == 0)
+					v_lengths[seg.in_group_id] = seg.raw_length;
+				else if (v_lengths[seg.in_group_id] != seg.raw_length)
+				{
+					v_issues.emplace_back("Different lengths of segment (" + to_string(seg.group_id) + ", " + to_string(seg.in_group_id) + ") recorded in contig " + sample_name + " : " + contig_name);
+					ok = false;
+				}
+			}
+
+			if (!sample_desc[i].second.empty())
+				contig_len -= (sample_desc[i].second.size() - 1) * kmer_length;
+
+			if (i < v_contig_stats.size() && v_contig_stats[i].second.length != contig_len)
+			{
+				v_issues.emplace_back("Contig length in stats differs from segments in contig " + sample_name + " : " + contig_name);
+				ok = false;
+			}
+		}
+	}
+
+	if (verbosity > 0)
+		cerr << "Samples: " << v_samples.size() << ", segment references: " << no_references << endl;
+
+	return ok;
+}
+
+// *******************************************************************************************
+// Each thread processes whole groups, so only a single group (and a few of its packs) per thread is in memory
+bool CAGCDecompressor::verify_segments(const uint32_t no_threads, vector<vector<uint32_t>>& vv_group_lengths, vector<string>& v_issues, uint32_t verbosity)
+{
+	atomic<size_t> next_group{ 0 };
+	atomic<uint64_t> no_decoded{ 0 };
+	mutex mtx_issues;
+	bool ok = true;
+
+	vector<thread> v_threads;
+	v_threads.reserve(no_threads);
+
+	for (uint32_t i = 0; i < no_threads; ++i)
+		v_threads.emplace_back([&] {
+			auto zstd_ctx = ZSTD_createDCtx();
+			contig_t ctg;
+
+			for (size_t group_id = next_group++; group_id < vv_group_lengths.size(); group_id = next_group++)
+			{
+				auto& v_lengths = vv_group_lengths[group_id];
+
+				if (v_lengths.empty())
+					continue;
+
+				CSegment segment(ss_base(archive_version, (uint32_t) group_id), in_archive, nullptr, compression_params.pack_cardinality, compression_params.min_match_len, false, archive_version, seekable_packs, true);
+
+				auto p_layout = m_pack_layouts.find((uint32_t) group_id);
+				if (p_layout != m_pack_layouts.end())
+					segment.set_pack_layout(p_layout->second);
+
+				for (uint32_t in_group_id = 0; in_group_id < v_lengths.size(); ++in_group_id)
+				{
+					if (v_lengths[in_group_id] == 0)
+						continue;
+
+					bool r;
+
+					try
+					{
+						if (group_id < no_raw_groups)
+							r = segment.get_raw(in_group_id, ctg, zstd_ctx);
+						else
+							r = segment.get(in_group_id, ctg, zstd_ctx);
+					}
+					catch (...)
+					{
+						r = false;
+					}
+
+					++no_decoded;
+
+					if (!r || ctg.size() != v_lengths[in_group_id])
+					{
+						lock_guard<mutex> lck(mtx_issues);
+						v_issues.emplace_back("Segment (" + to_string(group_id) + ", " + to_string(in_group_id) + ") " +
+							(r ? "decodes to " + to_string(ctg.size()) + " symbols instead of " + to_string(v_lengths[in_group_id]) : "cannot be decoded"));
+						ok = false;
+					}
+				}
+
+				// Release memory of the group as soon as possible
+				v_lengths.clear();
+				v_lengths.shrink_to_fit();
+			}
+
+			ZSTD_freeDCtx(zstd_ctx);
+		});
+
+	for (auto& t : v_threads)
+		t.join();
+
+	if (verbosity > 0)
+		cerr << "Segments decoded: " << no_decoded << endl;
+
+	return ok;
+}
+
+// *******************************************************************************************
+bool CAGCDecompressor::Verify(const uint32_t no_threads, const bool full, uint32_t verbosity)
+{
+	if (working_mode != working_mode_t::decompression)
+		return false;
+
+	vector<string> v_issues;
+	bool ok = true;
+
+	auto report = [&] {
+		for (size_t i = 0; i < v_issues.size() && i < verify_max_reported_issues; ++i)
+			cerr << "Error: " << v_issues[i] << endl;
+
+		if (v_issues.size() > verify_max_reported_issues)
+			cerr << "... and " << v_issues.size() - verify_max_reported_issues << " more errors" << endl;
+
+		cerr << (ok ? "Archive is OK" : "Archive is corrupted") << endl;
+
+		return ok;
+	};
+
+	// Wrong layout means that decoding could read random data
+	if (!in_archive->VerifyLayout(v_issues))
+	{
+		ok = false;
+		return report();
+	}
+
+	if (verbosity > 0)
+		cerr << "Archive layout: OK" << endl;
+
+	bool checksums_verified = false;
+
+	if (in_archive->LoadPartChecksums())
+	{
+		if (!verify_part_checksums(no_threads, v_issues, verbosity))
+		{
+			// Corrupted parts are not decoded
+			ok = false;
+			return report();
+		}
+
+		checksums_verified = true;
+	}
+	else if (in_archive->HasPartChecksums())
+	{
+		v_issues.emplace_back("Table of part checksums is corrupted");
+		ok = false;
+	}
+	else if (verbosity > 0)
+		cerr << "No part checksums in archive" << endl;
+
+	vector<vector<uint32_t>> vv_group_lengths;
+
+	ok &= collect_referenced_segments(vv_group_lengths, v_issues, verbosity);
+
+	if (!checksums_verified || full)
+		ok &= verify_segments(no_threads, vv_group_lengths, v_issues, verbosity);
+
+	return report();
+}
+
 // EOF
@@ -20,8 +20,33 @@ class CAGCDecompressor : public CAGCDecompressorLibrary
 {
 	void start_decompressing_threads(vector<thread>& v_threads, const uint32_t n_t, uint32_t gzip_level = 0, uint32_t line_len = 0, bool fast = false);
 
+	// Readahead of archive parts for tasks waiting in q_contig_tasks (makes sense only if the archive is not prefetched)
+	uint32_t readahead_depth = 0;
+	unique_ptr<CBoundedQueue<vector<segment_desc_t>>> q_readahead;
+	atomic<uint64_t> no_started_tasks{ 0 };
+
+	void start_readahead_thread(thread& ra_thread);
+	void stop_readahead_thread(thread& ra_thread);
+	void push_contig_task(contig_task_t& task);
+	int pack_of_member(const uint32_t group_id, const uint32_t member_id) const;
+	void readahead_segments(const vector<segment_desc_t>& segments, vector<pair<string, int>>& v_stream_parts);
+
 	void gzip_contig(contig_t& ctg, contig_t& working_space, refresh::gz_in_memory& gzip_compressor);
 
+	// Limits of a single batch of regions (sorted by the segments they need)
+	static const uint64_t region_batch_max_symbols = 1ull << 28;
+	static const uint32_t region_batch_max_regions = 1u << 16;
+
+	bool load_regions(const string& regions_file_name, vector<pair<string, name_range_t>>& v_sample_contig);
+	pair<uint32_t, uint32_t> region_first_segment(const vector<segment_desc_t>& segments, const int64_t from) const;
+
+	// Integrity verification
+	static const size_t verify_max_reported_issues = 100;
+
+	bool verify_part_checksums(const uint32_t no_threads, vector<string>& v_issues, uint32_t verbosity);
+	bool collect_referenced_segments(vector<vector<uint32_t>>& vv_group_lengths, vector<string>& v_issues, uint32_t verbosity);
+	bool verify_segments(const uint32_t no_threads, vector<vector<uint32_t>>& vv_group_lengths, vector<string>& v_issues, uint32_t verbosity);
+
 public:
 	CAGCDecompressor(bool _is_app_mode);
 	~CAGCDecompressor();
@@ -30,11 +55,19 @@ public:
 	bool GetSampleFile(const string& _file_name, const vector<string>& sample_names, const uint32_t _line_length, const uint32_t no_threads, const uint32_t gzip_level, uint32_t verbosity);
 	bool GetContigFile(const string& _file_name, const vector<string>& contig_names, const uint32_t _line_length, const uint32_t no_threads, const uint32_t gzip_level, uint32_t verbosity);
 	bool GetSampleForStreaming(const string& _file_name, const vector<string>& sample_names, const uint32_t _line_length, const uint32_t no_threads, const uint32_t gzip_level, uint32_t verbosity);
+	bool GetRegionsFile(const string& _file_name, const string& regions_file_name, const uint32_t _line_length, const uint32_t no_threads, const uint32_t gzip_level, uint32_t verbosity);
 	bool GetContigForStreaming(const string& _file_name, const vector<string>& contig_names, const uint32_t _line_length, const uint32_t no_threads, const uint32_t gzip_level, uint32_t verbosity);
 
 	bool GetSampleSequences(const string& sample_name, vector<pair<string, vector<uint8_t>>> &v_contig_seq, const uint32_t no_threads);
 
+	// No. of tasks (contigs) for which archive parts are read in advance (0 - no readahead)
+	void SetReadaheadDepth(const uint32_t _readahead_depth);
+
 	bool AssignArchive(const CAGCBasic &agc_basic);
+
+	// Check archive integrity (layout, part checksums, decoding of segments); issues are reported to stderr
+	// If the archive contains valid part checksums, segments are decoded only if full is set
+	bool Verify(const uint32_t no_threads, const bool full, uint32_t verbosity);
 };
 
 // EOF
@@ -0,0 +1,343 @@
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include "agc_server.h"
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <csignal>
+#include <cerrno>
+#endif
+
+// *******************************************************************************************
+CAGCServer::CAGCServer(bool _is_app_mode) : CAGCDecompressorLibrary(_is_app_mode)
+{
+}
+
+// *******************************************************************************************
+CAGCServer::~CAGCServer()
+{
+}
+
+// *******************************************************************************************
+bool CAGCServer::send_lines(CSocketStream& stream, const vector<string>& v_lines)
+{
+	string header = "OK\t" + to_string(v_lines.size()) + "\n";
+
+	if (!stream.Write(header))
+		return false;
+
+	for (const auto& line : v_lines)
+		if (!stream.Write(line) || !stream.Write("\n", 1))
+			return false;
+
+	return true;
+}
+
+// *******************************************************************************************
+bool CAGCServer::send_error(CSocketStream& stream, const int code, const string& msg)
+{
+	return stream.Write("ERR\t" + to_string(code) + "\t" + msg + "\n");
+}
+
+// *******************************************************************************************
+// Return 0 for success, -1 if there is no such contig, -2 if contig name is not unique
+int CAGCServer::find_sample(const string& contig_name, string& sample_name)
+{
+	auto v_cand_samples = collection_desc->get_samples_for_contig(contig_name);
+
+	if (v_cand_samples.size() == 0)
+		return -1;
+	if (v_cand_samples.size() > 1)
+		return -2;
+
+	sample_name = v_cand_samples.front();
+
+	return 0;
+}
+
+// *******************************************************************************************
+// Return false if connection should be closed
+bool CAGCServer::process_request(const vector<string>& v_fields, CSocketStream& stream, ZSTD_DCtx* zstd_ctx, contig_t& ctg)
+{
+	const string& cmd = v_fields.front();
+	vector<string> v_lines;
+
+	if (cmd == "PING")
+		return send_lines(stream, v_lines);
+
+	if (cmd == "REF")
+	{
+		string ref_name;
+		GetReferenceSample(ref_name);
+		v_lines.emplace_back(ref_name);
+
+		return send_lines(stream, v_lines);
+	}
+
+	if (cmd == "SAMPLES")
+	{
+		ListSamples(v_lines);
+
+		return send_lines(stream, v_lines);
+	}
+
+	if (cmd == "CONTIGS" && v_fields.size() == 2)
+	{
+		if (!ListContigs(v_fields[1], v_lines))
+			return send_error(stream, -1, "There is no sample: " + v_fields[1]);
+
+		return send_lines(stream, v_lines);
+	}
+
+	if ((cmd == "LEN" && v_fields.size() == 3) || (cmd == "SEQ" && v_fields.size() == 5))
+	{
+		string sample_name = v_fields[1];
+		string contig_name = v_fields[2];
+		vector<segment_desc_t> contig_desc;
+
+		if (sample_name.empty())
+		{
+			int r = find_sample(contig_name, sample_name);
+
+			if (r == -2)
+				return send_error(stream, r, "Contig name is not unique: " + contig_name);
+			if (r < 0)
+				return send_error(stream, r, "There is no contig: " + contig_name);
+		}
+
+		contig_stats_t stats;
+
+		// Metadata-only answer if contig stats are stored in the archive
+		if (cmd == "LEN" && collection_desc->get_contig_stats(sample_name, contig_name, stats))
+		{
+			v_lines.emplace_back(to_string(stats.length));
+
+			return send_lines(stream, v_lines);
+		}
+
+		if (!collection_desc->get_contig_desc(sample_name, contig_name, contig_desc))
+			return send_error(stream, -1, "There is no sample:contig pair: " + sample_name + " : " + contig_name);
+
+		if (cmd == "LEN")
+		{
+			int64_t len = 0;
+			for (auto& x : contig_desc)
+				len += x.raw_length;
+
+			v_lines.emplace_back(to_string(len - (int64_t)(contig_desc.size() - 1) * kmer_length));
+
+			return send_lines(stream, v_lines);
+		}
+
+		int64_t from, to;
+
+		try
+		{
+			from = stoll(v_fields[3]);
+			to = stoll(v_fields[4]);
+		}
+		catch (...)
+		{
+			return send_error(stream, -3, "Wrong range: " + v_fields[3] + "-" + v_fields[4]);
+		}
+
+		contig_task_t task{ 0, "", name_range_t(contig_name, from, to), contig_desc };
+
+		decompress_contig(task, zstd_ctx, ctg, true);
+		CNumAlphaConverter::convert_to_alpha(ctg);
+
+		// Sequence is sent directly from the decompression buffer
+		string header = "OK\t1\n";
+
+		return stream.Write(header) && stream.Write((const char*)ctg.data(), ctg.size()) && stream.Write("\n", 1);
+	}
+
+	if (cmd == "SAMPLE" && v_fields.size() == 2)
+	{
+		vector<segment_desc_t> contig_desc;
+		vector<string> v_contig_names;
+
+		if (!collection_desc->get_contig_list_in_sample(v_fields[1], v_contig_names))
+			return send_error(stream, -1, "There is no sample: " + v_fields[1]);
+
+		if (!stream.Write("OK\t" + to_string(2 * v_contig_names.size()) + "\n"))
+			return false;
+
+		for (auto& contig_name : v_contig_names)
+		{
+			collection_desc->get_contig_desc(v_fields[1], contig_name, contig_desc);
+
+			contig_task_t task{ 0, "", name_range_t(contig_name), contig_desc };
+
+			decompress_contig(task, zstd_ctx, ctg, true);
+			CNumAlphaConverter::convert_to_alpha(ctg);
+
+			if (!stream.Write(contig_name + "\n") || !stream.Write((const char*)ctg.data(), ctg.size()) || !stream.Write("\n", 1))
+				return false;
+		}
+
+		return true;
+	}
+
+	if (cmd == "SHUTDOWN")
+	{
+		send_lines(stream, v_lines);
+		request_stop();
+
+		return false;
+	}
+
+	return send_error(stream, -3, "Unknown request: " + cmd);
+}
+
+// *******************************************************************************************
+void CAGCServer::serve_connection(const int fd)
+{
+#ifndef _WIN32
+	{
+		lock_guard<mutex> lck(mtx_connections);
+		s_connections.insert(fd);
+	}
+
+	CSocketStream stream(fd);
+	auto zstd_ctx = ZSTD_createDCtx();
+
+	string line;
+	vector<string> v_fields;
+	contig_t ctg;
+
+	while (!stop_requested && stream.ReadLine(line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		CSocketStream::SplitFields(line, v_fields);
+
+		if (!process_request(v_fields, stream, zstd_ctx, ctg))
+			break;
+	}
+
+	ZSTD_freeDCtx(zstd_ctx);
+
+	{
+		lock_guard<mutex> lck(mtx_connections);
+		s_connections.erase(fd);
+	}
+
+	close(fd);
+#endif
+}
+
+// *******************************************************************************************
+// Wake up the accepting thread by a dummy connection (portable way of interrupting accept())
+// and the threads waiting for requests of connected clients
+void CAGCServer::request_stop()
+{
+	stop_requested = true;
+
+	CAGCClient client;
+	client.Connect(socket_name);
+
+#ifndef _WIN32
+	lock_guard<mutex> lck(mtx_connections);
+	for (auto fd : s_connections)
+		shutdown(fd, SHUT_RD);
+#endif
+}
+
+// *******************************************************************************************
+bool CAGCServer::Run(const string& _socket_name, const uint32_t no_threads, uint32_t verbosity)
+{
+#ifndef _WIN32
+	if (working_mode != working_mode_t::decompression)
+		return false;
+
+	socket_name = _socket_name;
+
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+
+	if (socket_name.size() >= sizeof(addr.sun_path))
+	{
+		cerr << "Too long socket name: " << socket_name << endl;
+		return false;
+	}
+
+	strcpy(addr.sun_path, socket_name.c_str());
+
+	// Socket file left by a previous (killed) instance
+	unlink(socket_name.c_str());
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (listen_fd < 0 || bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0)
+	{
+		cerr << "Cannot create socket: " << socket_name << endl;
+		if (listen_fd >= 0)
+			close(listen_fd);
+		listen_fd = -1;
+		return false;
+	}
+
+	// Clients closing connections must not terminate the server
+	signal(SIGPIPE, SIG_IGN);
+
+	thread_pool->SetMaxThreads(no_threads);
+	thread_pool->Reserve(no_threads);
+
+	if (verbosity > 0)
+		cerr << "Listening at: " << socket_name << endl;
+
+	CTaskGroup connections;
+
+	while (!stop_requested)
+	{
+		int fd = accept(listen_fd, nullptr, nullptr);
+
+		if (fd < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			break;
+		}
+
+		if (stop_requested)
+		{
+			close(fd);
+			break;
+		}
+
+		thread_pool->Launch(connections, [this, fd] { serve_connection(fd); });
+	}
+
+	close(listen_fd);
+	listen_fd = -1;
+	unlink(socket_name.c_str());
+
+	thread_pool->Wait(connections);
+
+	{
+		unique_lock<shared_mutex> lck(mtx_segment);
+		v_segment.clear();
+	}
+
+	return true;
+#else
+	cerr << "Unix domain sockets are not supported on this platform\n";
+	return false;
+#endif
+}
+
+// EOF
@@ -0,0 +1,49 @@
+#ifndef _AGC_SERVER_H
+#define _AGC_SERVER_H
+
+// *******************************************************************************************
+// This file is a part of AGC software distributed under MIT license.
+// The homepage of the AGC project is https://github.com/refresh-bio/agc
+//
+// Copyright(C) 2021-2024, S.Deorowicz, A.Danek, H.Li
+//
+// Version: 3.2
+// Date   : 2024-11-21
+// *******************************************************************************************
+
+#include "../common/agc_decompressor_lib.h"
+#include "../common/agc_client.h"
+#include <atomic>
+#include <mutex>
+#include <set>
+
+// *******************************************************************************************
+// Long-running query server: the archive is opened once and the collection metadata, decompressed references
+// and recently used packs (fast mode of segments) are kept between queries.
+// Queries are answered over a Unix domain socket (protocol is described in agc_client.h).
+// Each connection is served by a single worker of the thread pool, so no. of threads limits no. of clients served at once.
+class CAGCServer : public CAGCDecompressorLibrary
+{
+	string socket_name;
+	int listen_fd = -1;
+	atomic<bool> stop_requested{ false };
+
+	mutex mtx_connections;
+	set<int> s_connections;
+
+	void serve_connection(const int fd);
+	bool process_request(const vector<string>& v_fields, CSocketStream& stream, ZSTD_DCtx* zstd_ctx, contig_t& ctg);
+	int find_sample(const string& contig_name, string& sample_name);
+	bool send_lines(CSocketStream& stream, const vector<string>& v_lines);
+	bool send_error(CSocketStream& stream, const int code, const string& msg);
+	void request_stop();
+
+public:
+	CAGCServer(bool _is_app_mode);
+	~CAGCServer();
+
+	bool Run(const string& _socket_name, const uint32_t no_threads, uint32_t verbosity);
+};
+
+// EOF
+#endif
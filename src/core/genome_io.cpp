@@ -71,9 +71,16 @@ bool CGenomeIO::Open(const string& _file_name, const bool _writing)
 	}
 	else
 	{
-		sif = new refresh::stream_in_file(_file_name);
-		if (!sif->is_open())
-			return false;
+		if (_file_name == "-")
+			sif = new refresh::stream_in_stdin();
+		else
+		{
+			auto sif_file = new refresh::stream_in_file(_file_name);
+			sif = sif_file;
+
+			if (!sif_file->is_open())
+				return false;
+		}
 
 		sdf = new refresh::stream_decompression(sif);
 
@@ -118,12 +125,13 @@ bool CGenomeIO::Close()
 }
 
 // *******************************************************************************************
-// Can be used only just after opening the file, i.e., prior to any reads
+// Can be used only just after opening the file, i.e., prior to any reads. Size of stdin is unknown (0 is returned)
 size_t CGenomeIO::FileSize() 
 {
 	size_t s = 0;
+	auto sif_file = dynamic_cast<refresh::stream_in_file*>(sif);
 
-	if (!writing)
+	if (!writing && sif_file)
 	{
 		const size_t loc_buf_size = 1 << 25;
 		char* loc_buf = new char[loc_buf_size];
@@ -140,8 +148,8 @@ size_t CGenomeIO::FileSize()
 
 		delete[] loc_buf;
 
-		sif->restart();
-		sdf->restart(sif);
+		sif_file->restart();
+		sdf->restart(sif_file);
 	}
 
 	return s;
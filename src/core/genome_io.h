@@ -52,7 +52,7 @@ class CGenomeIO
 	bool is_gzipped;
 	bool use_stdout;
 
-	refresh::stream_in_file *sif = nullptr;
+	refresh::stream_in_base *sif = nullptr;
 	refresh::stream_decompression* sdf = nullptr;
 
 	refresh::gz_in_memory gzip_zero_compressor{ 1 };
@@ -84,6 +84,7 @@ public:
 	CGenomeIO();
 	~CGenomeIO();
 
+	// Empty name - stdout (writing), "-" - stdin (reading)
 	bool Open(const string &_file_name, const bool _writing);
 	bool Close();
 	size_t FileSize();
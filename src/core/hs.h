@@ -24,6 +24,7 @@
 #include <vector>
 #include <utility>
 #include <iterator>
+#include <functional>
 
 #if defined(_MSC_VER)  /* Visual Studio */
 #define FORCE_INLINE __forceinline
@@ -201,6 +202,8 @@ template<typename Key_t,
 		size_t size_when_restruct;
 		size_t allocated_mask;
 
+		std::function<void(void*, size_t)> memory_advisor;		// called for newly allocated (not yet touched) memory
+
 	public:
 		friend class hash_set_lp_iterator<hash_set_lp_type>;
 		friend class const_hash_set_lp_iterator<hash_set_lp_type>;
@@ -314,6 +317,13 @@ template<typename Key_t,
 			swap(empty_key, x.empty_key);
 		}
 
+		// *******************************************************************************************
+		// Set function called for each new (not yet touched) memory block, e.g., to set NUMA policy for it
+		void set_memory_advisor(std::function<void(void*, size_t)> _memory_advisor)
+		{
+			memory_advisor = _memory_advisor;
+		}
+
 		// *******************************************************************************************
 		void clear()
 		{
@@ -567,6 +577,12 @@ template<typename Key_t,
 			if (size_when_restruct == allocated)
 				--size_when_restruct;
 
+			if (memory_advisor && data.empty())
+			{
+				data.reserve(allocated);
+				memory_advisor(data.data(), allocated * sizeof(key_type));
+			}
+
 			data.resize(allocated, empty_key);
 
 			no_elements = 0;
@@ -192,6 +192,8 @@ class bloom_set_t {
 	size_t mask;
 	uint32_t mask_shift;
 
+	function<void(void*, size_t)> memory_advisor;		// called for newly allocated (not yet touched) memory
+
 	uint64_t normalize_size(uint64_t size)
 	{
 		size *= no_hashes;
@@ -218,6 +220,9 @@ class bloom_set_t {
 		while (((uint64_t)arr) % 64 != 0)
 			++arr;
 
+		if (memory_advisor)
+			memory_advisor(arr, allocated / 8);
+
 		fill_n(arr, allocated / 64, 0ull);
 
 		mask_shift = 6 * no_hashes;
@@ -253,6 +258,11 @@ public:
 		allocate(size);
 	}
 
+	void set_memory_advisor(function<void(void*, size_t)> _memory_advisor)
+	{
+		memory_advisor = _memory_advisor;
+	}
+
 	template<typename Iter>
 	void insert(Iter begin, Iter end)
 	{
@@ -30,7 +30,7 @@ public:
 	~CAGCFile();
 
 	/**
-	 * @param file_name		file name
+	 * @param file_name		file name or http:// URL (remote archives are read by range requests and never prefetched)
 	 * @param prefetching	true to preload whole file into memory (faster if you plan series of sequence queries), false otherwise
 	 *
 	 * @return false for error
@@ -97,12 +97,113 @@ public:
 	 * @return number of contigs in the sample
 	 */
 	int ListCtg(const std::string& sample, std::vector<std::string>& names) const;
+
+	/**
+	 * Get content digests of a contig (stored in archives created by recent releases)
+	 *
+	 * @param sample   sample name; can be an empty string
+	 * @param name     contig name
+	 * @param md5      MD5 as 32 hex digits (returned value)
+	 * @param sq       refget identifier (SQ. followed by SHA512t24u) (returned value)
+	 *
+	 * @return 0 for success, or <0 for errors
+	 */
+	int GetCtgDigest(const std::string& sample, const std::string& name, std::string& md5, std::string& sq) const;
+
+	/**
+	 * Find contigs of given content without decompression
+	 *
+	 * @param digest   MD5 (32 hex digits, optionally prefixed by md5:) or SHA512t24u (optionally prefixed by SQ. or ga4gh:SQ.)
+	 * @param ctgs     vector of (sample name, contig name) pairs (returned value)
+	 *
+	 * @return number of contigs found, or <0 for errors
+	 */
+	int FindCtgByDigest(const std::string& digest, std::vector<std::pair<std::string, std::string>>& ctgs) const;
+};
+
+// *******************************************************************************************
+// Client of the query server (agc serve); the queries are the same as in CAGCFile
+class CAGCRemote
+{
+	std::unique_ptr<class CAGCClient> client;
+
+public:
+	CAGCRemote();
+	~CAGCRemote();
+
+	/**
+	 * @param socket_name	Unix domain socket of the server
+	 *
+	 * @return false for error
+	 */
+	bool Connect(const std::string& socket_name);
+
+	/**
+	 * @return true for success and false for error
+	 */
+	bool Close();
+
+	/**
+	 * @param sample   sample name; can be an empty string
+	 * @param name     contig name
+	 *
+	 * @return contig length, or <0 for errors
+	 */
+	int GetCtgLen(const std::string& sample, const std::string& name) const;
+
+	/**
+	 * @param sample   sample name; can be an empty string
+	 * @param name     contig name
+	 * @param start    start offset
+	 * @param end      end offset
+	 * @param buf      sequence to be written (returned value)
+	 *
+	 * @return 0 for success, or <0 for errors
+	 */
+	int GetCtgSeq(const std::string& sample, const std::string& name, int start, int end, std::string& buffer) const;
+
+	/**
+	 * @return the number of samples, or <0 for errors
+	 */
+	int NSample() const;
+
+	/**
+	 * @param sample   sample name
+	 *
+	 * @return the number of contigs in sample, or <0 for errors
+	 */
+	int NCtg(const std::string& sample) const;
+
+	/**
+	 * @param samples  vector of strings with sample names (returned value)
+	 *
+	 * @return 0 for success, or <0 for errors
+	 */
+	int ListSample(std::vector<std::string>& samples) const;
+
+	/**
+	 * @param sample   reference sample name (returned value)
+	 *
+	 * @return 0 for success, or <0 for errors
+	 */
+	int GetReferenceSample(std::string& sample) const;
+
+	/**
+	 * @param sample    sample name
+	 * @param names     vector of strings with contig names (returned value)
+	 *
+	 * @return 0 for success, or <0 for errors
+	 */
+	int ListCtg(const std::string& sample, std::vector<std::string>& names) const;
 };
 
 typedef CAGCFile agc_t;
+struct agc_fai_t;
 #define EXTERNC extern "C"
 #else
+#include <stdint.h>
 typedef struct agc_t agc_t;
+typedef struct agc_fai_t agc_fai_t;
 #define EXTERNC
 #endif
 
@@ -202,6 +303,80 @@ EXTERNC int agc_list_destroy(char **list) noexcept;
  */
 EXTERNC int agc_string_destroy(char *sample) noexcept;
 
+// *******************************************************************************************
+// faidx-compatible API (mirrors fai_* and faidx_* functions of htslib)
+// Sequences are named sample#contig (PanSN style); contig names already starting with sample# are used as they are.
+// Plain contig names are also accepted if they are unique in the archive.
+// Decompressed references and packs are cached, so series of queries are fast. The functions can be called
+// from many threads for the same handle.
+// *******************************************************************************************
+
+/**
+ * @param fn			file name
+ *
+ * @return NULL for error
+ */
+EXTERNC agc_fai_t* agc_fai_load(const char* fn) noexcept;
+
+/**
+ * @param fai      faidx handle
+ */
+EXTERNC void agc_fai_destroy(agc_fai_t* fai) noexcept;
+
+/**
+ * @param fai      faidx handle
+ * @param reg      region in format name, name:beg or name:beg-end (1-based, inclusive; name can be given in braces: {name}:beg-end)
+ * @param len      length of returned sequence; -2 if sequence is not present, -1 for other errors (returned value)
+ *
+ * @return NULL-terminated sequence or NULL for errors. Use free() to deallocate.
+ */
+EXTERNC char* agc_fai_fetch(const agc_fai_t* fai, const char* reg, int* len) noexcept;
+EXTERNC char* agc_fai_fetch64(const agc_fai_t* fai, const char* reg, int64_t* len) noexcept;
+
+/**
+ * @param fai      faidx handle
+ * @param c_name   sequence name
+ * @param p_beg_i  start position (0-based)
+ * @param p_end_i  end position (0-based, inclusive); range is truncated to the sequence length
+ * @param len      length of returned sequence; -2 if sequence is not present, -1 for other errors (returned value)
+ *
+ * @return NULL-terminated sequence or NULL for errors. Use free() to deallocate.
+ */
+EXTERNC char* agc_faidx_fetch_seq(const agc_fai_t* fai, const char* c_name, int p_beg_i, int p_end_i, int* len) noexcept;
+EXTERNC char* agc_faidx_fetch_seq64(const agc_fai_t* fai, const char* c_name, int64_t p_beg_i, int64_t p_end_i, int64_t* len) noexcept;
+
+/**
+ * @param fai      faidx handle
+ *
+ * @return the number of sequences (contigs of all samples)
+ */
+EXTERNC int agc_faidx_nseq(const agc_fai_t* fai) noexcept;
+
+/**
+ * @param fai      faidx handle
+ * @param i        sequence id
+ *
+ * @return name of i-th sequence or NULL if i is out of range. The string is owned by the handle.
+ */
+EXTERNC const char* agc_faidx_iseq(const agc_fai_t* fai, int i) noexcept;
+
+/**
+ * @param fai      faidx handle
+ * @param seq      sequence name
+ *
+ * @return sequence length or -1 if sequence is not present
+ */
+EXTERNC int agc_faidx_seq_len(const agc_fai_t* fai, const char* seq) noexcept;
+EXTERNC int64_t agc_faidx_seq_len64(const agc_fai_t* fai, const char* seq) noexcept;
+
+/**
+ * @param fai      faidx handle
+ * @param seq      sequence name
+ *
+ * @return 1 if sequence is present, 0 otherwise
+ */
+EXTERNC int agc_faidx_has_seq(const agc_fai_t* fai, const char* seq) noexcept;
+
 #endif
 
 // EOF
@@ -9,8 +9,11 @@
 // *******************************************************************************************
 
 #include "../common/agc_decompressor_lib.h"
+#include "../common/agc_client.h"
+#include "../common/digest.h"
 #include "agc-api.h"
 #include <cstring>
+#include <unordered_map>
 
 // *******************************************************************************************
 char** agc_internal_cnv_vec2list(vector<string>& vec);
@@ -120,6 +123,110 @@ int CAGCFile::ListCtg(const std::string& sample, std::vector<std::string>& names
 	return 0;
 }
 
+// *******************************************************************************************
+int CAGCFile::GetCtgDigest(const std::string& sample, const std::string& name, std::string& md5, std::string& sq) const
+{
+	if (!is_opened)
+		return -1;
+
+	contig_digest_t digest;
+
+	if (!agc->GetContigDigest(sample, name, digest))
+		return -1;
+
+	md5 = digest_to_hex(digest.md5.data(), digest.md5.size());
+	sq = "SQ." + digest_to_base64url(digest.sha512t24.data(), digest.sha512t24.size());
+
+	return 0;
+}
+
+// *******************************************************************************************
+int CAGCFile::FindCtgByDigest(const std::string& digest, std::vector<std::pair<std::string, std::string>>& ctgs) const
+{
+	if (!is_opened)
+		return -1;
+
+	if (!agc->FindContigsByDigest(digest, ctgs))
+		return -1;
+
+	return (int) ctgs.size();
+}
+
+// *******************************************************************************************
+CAGCRemote::CAGCRemote()
+{
+	client = std::make_unique<CAGCClient>();
+}
+
+// *******************************************************************************************
+CAGCRemote::~CAGCRemote()
+{
+}
+
+// *******************************************************************************************
+bool CAGCRemote::Connect(const std::string& socket_name)
+{
+	return client->Connect(socket_name);
+}
+
+// *******************************************************************************************
+bool CAGCRemote::Close()
+{
+	return client->Close();
+}
+
+// *******************************************************************************************
+int CAGCRemote::GetCtgLen(const std::string& sample, const std::string& name) const
+{
+	return (int) client->GetContigLength(sample, name);
+}
+
+// *******************************************************************************************
+int CAGCRemote::GetCtgSeq(const std::string& sample, const std::string& name, int start, int end, std::string& buffer) const
+{
+	return client->GetContigString(sample, name, start, end, buffer);
+}
+
+// *******************************************************************************************
+int CAGCRemote::NSample() const
+{
+	std::vector<std::string> samples;
+
+	if (!client->ListSamples(samples))
+		return -1;
+
+	return (int) samples.size();
+}
+
+// *******************************************************************************************
+int CAGCRemote::NCtg(const std::string& sample) const
+{
+	std::vector<std::string> names;
+
+	if (!client->ListContigs(sample, names))
+		return -1;
+
+	return (int) names.size();
+}
+
+// *******************************************************************************************
+int CAGCRemote::GetReferenceSample(std::string& sample) const
+{
+	return client->GetReferenceSample(sample) ? 0 : -1;
+}
+
+// *******************************************************************************************
+int CAGCRemote::ListSample(std::vector<std::string>& samples) const
+{
+	return client->ListSamples(samples) ? 0 : -1;
+}
+
+// *******************************************************************************************
+int CAGCRemote::ListCtg(const std::string& sample, std::vector<std::string>& names) const
+{
+	return client->ListContigs(sample, names) ? 0 : -1;
+}
+
 // *******************************************************************************************
 // C part
 // *******************************************************************************************
@@ -349,4 +456,328 @@ int agc_string_destroy(char *sample) noexcept
 	return 0;
 }
 
+// *******************************************************************************************
+// faidx-compatible part
+// *******************************************************************************************
+struct agc_fai_t
+{
+	mutable CAGCDecompressorLibrary agc{ false };
+
+	vector<string> v_names;
+	vector<pair<string, string>> v_sample_contig;
+	unordered_map<string, uint32_t> m_name_ids;
+
+	// *******************************************************************************************
+	bool load(const string& file_name)
+	{
+		if (!agc.Open(file_name, false))
+			return false;
+
+		vector<string> v_samples;
+		vector<string> v_contigs;
+
+		agc.ListSamples(v_samples);
+
+		for (auto& sample : v_samples)
+		{
+			agc.ListContigs(sample, v_contigs);
+
+			for (auto& contig : v_contigs)
+			{
+				string prefix = sample + "#";
+				string name = contig.compare(0, prefix.size(), prefix) == 0 ? contig : prefix + contig;
+
+				m_name_ids.emplace(name, (uint32_t)v_names.size());
+				v_names.emplace_back(name);
+				v_sample_contig.emplace_back(sample, contig);
+			}
+		}
+
+		return true;
+	}
+
+	// *******************************************************************************************
+	// Return contig length or -1 if there is no such sequence
+	int64_t resolve(const string& name, string& sample, string& contig) const
+	{
+		auto p = m_name_ids.find(name);
+
+		if (p != m_name_ids.end())
+		{
+			sample = v_sample_contig[p->second].first;
+			contig = v_sample_contig[p->second].second;
+		}
+		else
+		{
+			sample.clear();
+			contig = name;
+		}
+
+		int64_t len = agc.GetContigLength(sample, contig);
+
+		return len < 0 ? -1 : len;
+	}
+
+	// *******************************************************************************************
+	// htslib semantics: 0-based inclusive range truncated to the sequence
+	char* fetch(const string& name, int64_t p_beg_i, int64_t p_end_i, int64_t* len) const
+	{
+		string sample, contig, seq;
+		int64_t seq_len = resolve(name, sample, contig);
+
+		if (seq_len < 0)
+		{
+			*len = -2;
+			return NULL;
+		}
+
+		if (p_beg_i < 0)
+			p_beg_i = 0;
+		else if (seq_len <= p_beg_i)
+			p_beg_i = seq_len;
+		if (p_end_i < 0)
+			p_end_i = 0;
+		else if (seq_len <= p_end_i)
+			p_end_i = seq_len - 1;
+
+		if (p_beg_i <= p_end_i && agc.GetContigString(sample, contig, p_beg_i, p_end_i, seq, true) < 0)
+		{
+			*len = -1;
+			return NULL;
+		}
+
+		char* buf = (char*)malloc(seq.size() + 1);
+		if (!buf)
+		{
+			*len = -1;
+			return NULL;
+		}
+
+		memcpy(buf, seq.data(), seq.size());
+		buf[seq.size()] = 0;
+		*len = (int64_t)seq.size();
+
+		return buf;
+	}
+
+	// *******************************************************************************************
+	// Region: name, name:beg or name:beg-end (1-based, inclusive); name can be given in braces
+	char* fetch_region(const string& reg, int64_t* len) const
+	{
+		string name = reg;
+		string range;
+
+		if (!reg.empty() && reg.front() == '{')
+		{
+			auto p = reg.find('}');
+			if (p == string::npos)
+			{
+				*len = -1;
+				return NULL;
+			}
+
+			name = reg.substr(1, p - 1);
+			if (p + 1 < reg.size())
+			{
+				if (reg[p + 1] != ':')
+				{
+					*len = -1;
+					return NULL;
+				}
+				range = reg.substr(p + 2);
+			}
+		}
+		else if (m_name_ids.find(reg) == m_name_ids.end())
+		{
+			auto p = reg.rfind(':');
+			if (p != string::npos)
+			{
+				name = reg.substr(0, p);
+				range = reg.substr(p + 1);
+			}
+		}
+
+		int64_t beg = 0;
+		int64_t end = INT64_MAX - 1;
+
+		if (!range.empty())
+		{
+			string digits;
+			for (auto c : range)
+				if (c != ',')
+					digits.push_back(c);
+
+			char* p_end;
+			beg = strtoll(digits.c_str(), &p_end, 10) - 1;
+
+			if (*p_end == '-')
+			{
+				if (*(p_end + 1))
+					end = strtoll(p_end + 1, &p_end, 10) - 1;
+				else
+					++p_end;
+			}
+
+			if (*p_end != 0 || beg < 0)
+			{
+				*len = -1;
+				return NULL;
+			}
+		}
+
+		if (end < beg)
+		{
+			*len = 0;
+			return (char*)calloc(1, 1);
+		}
+
+		return fetch(name, beg, end, len);
+	}
+};
+
+// *******************************************************************************************
+agc_fai_t* agc_fai_load(const char* fn) noexcept
+{
+	try {
+		agc_fai_t* fai = new agc_fai_t;
+
+		if (!fai->load(fn))
+		{
+			delete fai;
+			return NULL;
+		}
+
+		return fai;
+	}
+	catch (...) {
+		fprintf(stderr, "AGC error in %s: exception caught\n", __FUNCTION__);
+		return NULL;
+	}
+}
+
+// *******************************************************************************************
+void agc_fai_destroy(agc_fai_t* fai) noexcept
+{
+	if (!fai)
+		return;
+
+	try {
+		fai->agc.Close();
+	}
+	catch (...) {
+		fprintf(stderr, "AGC error in %s: exception caught\n", __FUNCTION__);
+	}
+
+	delete fai;
+}
+
+// *******************************************************************************************
+char* agc_fai_fetch64(const agc_fai_t* fai, const char* reg, int64_t* len) noexcept
+{
+	if (!fai || !reg)
+	{
+		*len = -1;
+		return NULL;
+	}
+
+	try {
+		return fai->fetch_region(reg, len);
+	}
+	catch (...) {
+		fprintf(stderr, "AGC error in %s: exception caught\n", __FUNCTION__);
+		*len = -1;
+		return NULL;
+	}
+}
+
+// *******************************************************************************************
+char* agc_fai_fetch(const agc_fai_t* fai, const char* reg, int* len) noexcept
+{
+	int64_t len64;
+	char* seq = agc_fai_fetch64(fai, reg, &len64);
+
+	*len = (int)len64;
+
+	return seq;
+}
+
+// *******************************************************************************************
+char* agc_faidx_fetch_seq64(const agc_fai_t* fai, const char* c_name, int64_t p_beg_i, int64_t p_end_i, int64_t* len) noexcept
+{
+	if (!fai || !c_name)
+	{
+		*len = -1;
+		return NULL;
+	}
+
+	try {
+		return fai->fetch(c_name, p_beg_i, p_end_i, len);
+	}
+	catch (...) {
+		fprintf(stderr, "AGC error in %s: exception caught\n", __FUNCTION__);
+		*len = -1;
+		return NULL;
+	}
+}
+
+// *******************************************************************************************
+char* agc_faidx_fetch_seq(const agc_fai_t* fai, const char* c_name, int p_beg_i, int p_end_i, int* len) noexcept
+{
+	int64_t len64;
+	char* seq = agc_faidx_fetch_seq64(fai, c_name, p_beg_i, p_end_i, &len64);
+
+	*len = (int)len64;
+
+	return seq;
+}
+
+// *******************************************************************************************
+int agc_faidx_nseq(const agc_fai_t* fai) noexcept
+{
+	if (!fai)
+		return -1;
+
+	return (int)fai->v_names.size();
+}
+
+// *******************************************************************************************
+const char* agc_faidx_iseq(const agc_fai_t* fai, int i) noexcept
+{
+	if (!fai || i < 0 || (size_t)i >= fai->v_names.size())
+		return NULL;
+
+	return fai->v_names[i].c_str();
+}
+
+// *******************************************************************************************
+int64_t agc_faidx_seq_len64(const agc_fai_t* fai, const char* seq) noexcept
+{
+	if (!fai || !seq)
+		return -1;
+
+	try {
+		string sample, contig;
+
+		return fai->resolve(seq, sample, contig);
+	}
+	catch (...) {
+		fprintf(stderr, "AGC error in %s: exception caught\n", __FUNCTION__);
+		return -1;
+	}
+}
+
+// *******************************************************************************************
+int agc_faidx_seq_len(const agc_fai_t* fai, const char* seq) noexcept
+{
+	int64_t len = agc_faidx_seq_len64(fai, seq);
+
+	return len > INT32_MAX ? -2 : (int)len;
+}
+
+// *******************************************************************************************
+int agc_faidx_has_seq(const agc_fai_t* fai, const char* seq) noexcept
+{
+	return agc_faidx_seq_len64(fai, seq) >= 0 ? 1 : 0;
+}
+
 // EOF